@@ -20,13 +20,18 @@
 #ifndef __MODULE__
 #define __MODULE__
 
+#include <cstdint>
 #include <function.h>
+#include <future>
+#include <memory>
 #include <tuple>
 #include <type_traits>
 #include <utility>
+#include <vector>
 #include <iostream>
 #include <variable.h>
 #include <runtime_context.h>
+#include <channel.h>
 #include <tokens.h>
 
 namespace Gisel
@@ -44,9 +49,13 @@ namespace Gisel
 				using next_unpacker = unpacker<R, std::tuple<Unpacked..., Left0>, std::tuple<Left...>>;
 				if constexpr(std::is_convertible<const std::string&, Left0>::value)
 					return next_unpacker()(ctx, f, std::tuple_cat(std::move(t), std::tuple<Left0>(*ctx.local(-1 - int(sizeof...(Unpacked)))->static_pointer_downcast<lstring>()->value)));
+				else if constexpr(std::is_same<typename std::decay<Left0>::type, string>::value)
+					return next_unpacker()(ctx, f, std::tuple_cat(std::move(t), std::tuple<Left0>(ctx.local(-1 - int(sizeof...(Unpacked)))->static_pointer_downcast<lstring>()->value)));
+				else if constexpr(std::is_same<typename std::decay<Left0>::type, integer>::value)
+					return next_unpacker()(ctx, f, std::tuple_cat(std::move(t), std::tuple<Left0>(ctx.local(-1 - int(sizeof...(Unpacked)))->static_pointer_downcast<linteger>()->value)));
 				else
 				{
-					static_assert(std::is_convertible<number, Left0>::value);
+					static_assert(std::is_convertible<number, typename std::decay<Left0>::type>::value);
 					return next_unpacker()(ctx, f, std::tuple_cat(std::move(t), std::tuple<Left0>(ctx.local(-1 - int(sizeof...(Unpacked)))->static_pointer_downcast<lnumber>()->value)));
 				}
 			}
@@ -69,11 +78,13 @@ namespace Gisel
 				{
 					R retval = unpacker<R, std::tuple<>, std::tuple<Args...>>()(ctx, f, std::tuple<>());
 					if constexpr(std::is_convertible<R, std::string>::value)
-						ctx.retval() = std::make_shared<variable_impl<string>>(std::make_shared<std::string>(std::move(retval)));
+						ctx.retval() = ctx.make_variable<string>(ctx.make_string(std::move(retval)));
+					else if constexpr(std::is_same<R, integer>::value)
+						ctx.retval() = ctx.make_variable<integer>(retval);
 					else
 					{
 						static_assert(std::is_convertible<R, number>::value);
-						ctx.retval() = std::make_shared<variable_impl<number>>(retval);
+						ctx.retval() = ctx.make_variable<number>(retval);
 					}
 				}
 			};
@@ -88,6 +99,8 @@ namespace Gisel
 					return Token::kw_tokens[Tokens::type_void].c_str();
 				else if constexpr(std::is_convertible<T, std::string>::value)
 					return Token::kw_tokens[Tokens::type_string].c_str();
+				else if constexpr(std::is_same<T, integer>::value)
+					return Token::kw_tokens[Tokens::type_int].c_str();
 				else
 				{
 					static_assert(std::is_convertible<T, number>::value);
@@ -96,16 +109,21 @@ namespace Gisel
 			}
 		};
 		
+		// the arguments taken by non-const reference, number&, integer& or string&, are passed by reference
 		template<typename T>
 		struct argument_declaration
 		{
+			static constexpr const bool by_ref = std::is_lvalue_reference<T>::value && !std::is_const<typename std::remove_reference<T>::type>::value;
+			
 			static constexpr const char* result()
 			{
-				if constexpr(std::is_convertible<const std::string&, T>::value)
+				if constexpr(std::is_convertible<const std::string&, T>::value || std::is_same<typename std::decay<T>::type, string>::value)
 					return Token::kw_tokens[Tokens::type_string].c_str();
+				else if constexpr(std::is_same<typename std::decay<T>::type, integer>::value)
+					return Token::kw_tokens[Tokens::type_int].c_str();
 				else
 				{
-					static_assert(std::is_convertible<number, T>::value);
+					static_assert(std::is_convertible<number, typename std::decay<T>::type>::value);
 					return Token::kw_tokens[Tokens::type_number].c_str();
 				}
 			}
@@ -114,11 +132,11 @@ namespace Gisel
 		struct function_argument_string
 		{
 			std::string str;
-			function_argument_string(const char* p) : str(p) {}
+			function_argument_string(const char* p, bool by_ref) : str(std::string(by_ref ? "var& arg : " : "var arg : ") + p) {}
 			
 			function_argument_string& operator+=(const function_argument_string& oth)
 			{
-				str += ", var arg : ";
+				str += ", ";
 				str += oth.str;
 				return *this;
 			}
@@ -130,26 +148,52 @@ namespace Gisel
 			if constexpr(sizeof...(Args) == 0)
 				return std::string("fn ") + name + "() -> " + retval_declaration<R>::result();
 			else
-				return std::string("fn ") + name + "(var arg : " + (function_argument_string(argument_declaration<Args>::result()) += ...).str + ") -> " + retval_declaration<R>::result();
+				return std::string("fn ") + name + "(" + (function_argument_string(argument_declaration<Args>::result(), argument_declaration<Args>::by_ref) += ...).str + ") -> " + retval_declaration<R>::result();
 		}
 		
-		inline variable_ptr to_variable(number n) { return std::make_shared<variable_impl<number>>(n); }
-		inline variable_ptr to_variable(std::string str) { return std::make_shared<variable_impl<string>>(std::make_shared<std::string>(std::move(str))); }
+		template <typename T>
+		variable_ptr to_variable(runtime_context& ctx, T value)
+		{
+			if constexpr(std::is_convertible<T, std::string>::value)
+				return ctx.make_variable<string>(ctx.make_string(std::move(value)));
+			else if constexpr(std::is_same<T, integer>::value)
+				return ctx.make_variable<integer>(value);
+			else
+				return ctx.make_variable<number>(value);
+		}
 		
 		template <typename T>
 		T move_from_variable(const variable_ptr& v)
 		{
 			if constexpr (std::is_same<T, std::string>::value)
-				return std::move(*v->static_pointer_downcast<lstring>()->value);
+			{
+				// the string may still be the value of a global
+				const string& s = v->static_pointer_downcast<lstring>()->value;
+				return s.use_count() == 1 ? std::move(*s) : *s;
+			}
+			else if constexpr (std::is_same<T, integer>::value)
+				return v->static_pointer_downcast<linteger>()->value;
 			else
 			{
 				static_assert(std::is_same<number, T>::value);
 				return v->static_pointer_downcast<lnumber>()->value;
 			}
 		}
+		
+		template<typename R, typename... Args>
+		R call_function(runtime_context& ctx, const function& f, Args... args)
+		{
+			if constexpr(std::is_same<R, void>::value)
+				ctx.call(f, {to_variable<Args>(ctx, std::move(args))...});
+			else
+				return move_from_variable<R>(ctx.call(f, {to_variable<Args>(ctx, std::move(args))...}));
+		}
 	}
 
 	class Module_impl;
+	
+	template<typename R, typename... Args>
+	class function_caller;
 
 	class Module
 	{
@@ -166,19 +210,133 @@ namespace Gisel
 				std::string decl = details::create_function_declaration<R, Args...>(name.c_str());
 				add_public_function_declaration(std::move(decl), std::move(name), fptr);
 				
-				return [this, fptr](Args... args)
-				{
-					if constexpr(std::is_same<R, void>::value)
-						get_runtime_context()->call(*fptr, {details::to_variable(std::move(args))...});
-					else
-						return details::move_from_variable<R>(get_runtime_context()->call(*fptr, {details::to_variable(args)...}));
-				};
+				return function_caller<R, Args...>(this, std::move(fptr));
 			}
 			
+			// numeric functions are compiled to machine code by the next load, where supported
+			void set_jit_enabled(bool enabled);
+			
+			// functions are first loaded without the loops pass and the JIT, and rebuilt with them once they get hot;
+			// the rebuild runs on the calling thread, and a call already running finishes in the first tier
+			void set_tiering_enabled(bool enabled);
+			
+			// release mode: the next load drops the run-time checks of global reads and calls the compiler proves redundant;
+			// they are kept by default, to report the read of a global before its initialization
+			void set_unchecked(bool unchecked);
+			
+			// the globals of the next load are initialized on their first access, in the order their values
+			// are needed, rather than all at load time and on every reset_globals; cycles are reported
+			void set_lazy_globals(bool lazy);
+			
+			// the next load counts the branches taken by every if statement, write_branch_profile saves the counts;
+			// once read back, they let the next load test the most taken branches of elif chains first. The jit does
+			// not count branches, the functions are not compiled by it while profiling, tiering included
+			void set_branch_profiling(bool enabled);
+			void write_branch_profile(std::ostream& out) const;
+			void read_branch_profile(std::istream& in);
+			
+			// 0 runs no optional pass, 1 the cheap ones, 2 (the default) all of them
+			void set_optimization_level(int level);
+			
+			// switches a single pass of the next load: arithmetic, dispatch, loops, reorder or flatten
+			void set_pass_enabled(const char* name, bool enabled);
+			
+			// the time spent so far in every pass
+			void write_pass_timings(std::ostream& out) const;
+			
+			// the flattened expressions of the next load count the nodes they evaluate, read by get_evaluated_nodes
+			void set_node_counting(bool enabled);
+			std::uint64_t get_evaluated_nodes() const;
+			
 			void load(const char* path);
 			
+			// loads a shared object built from the C++ written by emit_cpp instead of a script
+			void load_native(const char* path);
+			
+			// translates the script at path to C++, against the functions declared so far
+			void emit_cpp(const char* path, std::ostream& out);
+			
+			// restores the globals written since the load
 			void reset_globals();
 			
+			// writes the globals of the loaded script to a file, as a warm start for the next processes
+			void save_state(const char* path) const;
+			
+			// the next load reads its globals from a file written by save_state instead of running their
+			// initializers; it initializes them as usual when the file is missing or saved by another program
+			void restore_state(const char* path);
+			
+			// an isolated context, with the globals as they were after the load: the values it does not write are
+			// shared with the module; it runs the compiled program of the module, and must not outlive it.
+			// The script is compiled once, and every thread can run it in a context of its own
+			std::unique_ptr<runtime_context> clone_context() const;
+			
+			// call_async runs its calls on that many threads, each one in a context cloned from the module; at most
+			// queue_capacity calls wait for a thread, and the next ones block the caller until there is room
+			void start_workers(size_t threads, size_t queue_capacity = 1024);
+			
+			// runs the calls still queued, then joins the threads
+			void stop_workers();
+			
+			// calls a public function of the script on a worker; strings are passed as std::string
+			template<typename R, typename... Args>
+			std::future<R> call_async(const char* name, Args... args)
+			{
+				std::vector<std::future<R> > results = call_async_batch<R, Args...>(name, {std::tuple<Args...>(std::move(args)...)});
+				return std::move(results.front());
+			}
+			
+			// the calls of a batch are queued at once, the function is looked up once for all of them
+			template<typename R, typename... Args>
+			std::vector<std::future<R> > call_async_batch(const char* name, std::vector<std::tuple<Args...> > args)
+			{
+				const function& f = find_public_function(details::create_function_declaration<R, Args...>(name));
+				std::vector<std::future<R> > results;
+				std::vector<function> tasks;
+				results.reserve(args.size());
+				tasks.reserve(args.size());
+				
+				for(std::tuple<Args...>& a : args)
+				{
+					auto task = std::make_shared<std::packaged_task<R(runtime_context&)> >([&f, a = std::move(a)](runtime_context& ctx) mutable
+					{
+						return std::apply([&](Args&... args) { return details::call_function<R, Args...>(ctx, f, std::move(args)...); }, a);
+					});
+					results.push_back(task->get_future());
+					tasks.push_back([task = std::move(task)](runtime_context& ctx) { (*task)(ctx); });
+				}
+				submit_async(std::move(tasks));
+				
+				return results;
+			}
+			
+			// the threads running the parallel loops of the scripts, the one running a loop included; they are
+			// shared by every module of the process, and as many as the hardware threads by default
+			static void set_parallel_threads(size_t threads);
+			
+			// channels carry numbers or strings between the scripts and the host, whatever module or thread they run on;
+			// the scripts know a channel by the int open_*_channel returns, and use it through the channel builtins
+			static integer open_number_channel(size_t capacity);
+			static integer open_string_channel(size_t capacity);
+			
+			// waits while the channel is full; sending to a closed channel is a runtime error
+			static void send(integer channel, number value);
+			static void send(integer channel, std::string value);
+			
+			// waits for a message, false once the channel is closed and all of its messages are received
+			static bool recv(integer channel, number& value);
+			static bool recv(integer channel, std::string& value);
+			
+			// the same without waiting
+			static channel_status try_recv(integer channel, number& value);
+			static channel_status try_recv(integer channel, std::string& value);
+			
+			// the messages already sent are still received
+			static void close_channel(integer channel);
+			
+			// how many locals of every function are boxed because they are passed by reference
+			void dump_storage_stats(std::ostream& out) const;
+			
 			~Module();
 
 		private:
@@ -186,6 +344,27 @@ namespace Gisel
 			void add_external_function_impl(std::string declaration, function f);
 			void add_public_function_declaration(std::string declaration, std::string name, std::shared_ptr<function> fptr);
 			runtime_context* get_runtime_context();
+			const function& find_public_function(const std::string& declaration) const;
+			void submit_async(std::vector<function> tasks);
+			
+			template<typename R, typename... Args>
+			friend class function_caller;
+	};
+	
+	// calls a public function of the script, in the context of its module or in one cloned from it
+	template<typename R, typename... Args>
+	class function_caller
+	{
+		public:
+			function_caller(Module* module, std::shared_ptr<function> fptr) : _module(module), _fptr(std::move(fptr)) {}
+			
+			inline R operator()(Args... args) const { return (*this)(*_module->get_runtime_context(), std::move(args)...); }
+			
+			inline R operator()(runtime_context& ctx, Args... args) const { return details::call_function<R, Args...>(ctx, *_fptr, std::move(args)...); }
+			
+		private:
+			Module* _module;
+			std::shared_ptr<function> _fptr;
 	};
 }
 
@@ -18,18 +18,176 @@
  */
 
 #include <gisel.h>
+#include <algorithm>
 #include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <thread>
+#include <vector>
 
 int main(int argc, char** argv)
 {
-	if(argc < 2)
+	bool storage_stats = false;
+	bool jit = false;
+	bool tiering = false;
+	bool unchecked = false;
+	bool lazy_globals = false;
+	bool native = false;
+	const char* emit_cpp = nullptr;
+	const char* profile_out = nullptr;
+	const char* profile_in = nullptr;
+	const char* save_state = nullptr;
+	const char* restore_state = nullptr;
+	int optimization_level = 2;
+	int threads = 0;
+	int async_calls = 0;
+	std::vector<std::pair<const char*, bool> > passes;
+	bool time_passes = false;
+	bool bench = false;
+	int arg = 1;
+	
+	for(; arg < argc && argv[arg][0] == '-'; ++arg)
+	{
+		if(argv[arg][1] == 'O' && std::isdigit(argv[arg][2]) && argv[arg][3] == '\0')
+			optimization_level = argv[arg][2] - '0';
+		else if(std::strcmp(argv[arg], "--storage-stats") == 0)
+			storage_stats = true;
+		else if(std::strcmp(argv[arg], "--jit") == 0)
+			jit = true;
+		else if(std::strcmp(argv[arg], "--tiered") == 0)
+			tiering = true;
+		else if(std::strcmp(argv[arg], "--unchecked") == 0)
+			unchecked = true;
+		else if(std::strcmp(argv[arg], "--lazy-globals") == 0)
+			lazy_globals = true;
+		else if(std::strcmp(argv[arg], "--native") == 0)
+			native = true;
+		else if(std::strcmp(argv[arg], "--profile-branches") == 0 && arg + 1 < argc)
+			profile_out = argv[++arg];
+		else if(std::strcmp(argv[arg], "--branch-profile") == 0 && arg + 1 < argc)
+			profile_in = argv[++arg];
+		else if(std::strcmp(argv[arg], "--save-state") == 0 && arg + 1 < argc)
+			save_state = argv[++arg];
+		else if(std::strcmp(argv[arg], "--restore-state") == 0 && arg + 1 < argc)
+			restore_state = argv[++arg];
+		else if(std::strcmp(argv[arg], "--emit-cpp") == 0 && arg + 1 < argc)
+			emit_cpp = argv[++arg];
+		else if(std::strcmp(argv[arg], "--enable-pass") == 0 && arg + 1 < argc)
+			passes.emplace_back(argv[++arg], true);
+		else if(std::strcmp(argv[arg], "--disable-pass") == 0 && arg + 1 < argc)
+			passes.emplace_back(argv[++arg], false);
+		else if(std::strcmp(argv[arg], "--threads") == 0 && arg + 1 < argc && std::atoi(argv[arg + 1]) > 0)
+			threads = std::atoi(argv[++arg]);
+		else if(std::strcmp(argv[arg], "--async") == 0 && arg + 1 < argc && std::atoi(argv[arg + 1]) > 0)
+			async_calls = std::atoi(argv[++arg]);
+		else if(std::strcmp(argv[arg], "--time-passes") == 0)
+			time_passes = true;
+		else if(std::strcmp(argv[arg], "--bench") == 0)
+			bench = true;
+		else
+			Gisel::Error(std::string("unknown option ") + argv[arg], -2).expose();
+	}
+	
+	if(arg >= argc)
 		Gisel::Error("no input file given", -2).expose();
 	
+	if(threads)
+		Gisel::Module::set_parallel_threads(threads);
+	
 	Gisel::Module m;
 	Gisel::add_standard_functions(m);
+	m.set_jit_enabled(jit);
+	m.set_tiering_enabled(tiering);
+	m.set_unchecked(unchecked);
+	m.set_lazy_globals(lazy_globals);
+	m.set_branch_profiling(profile_out != nullptr);
+	m.set_node_counting(bench);
+	m.set_optimization_level(optimization_level);
+	for(const auto& [name, enabled] : passes)
+		m.set_pass_enabled(name, enabled);
+	
+	if(profile_in)
+	{
+		std::ifstream in(profile_in);
+		if(!in)
+			Gisel::file_not_found(profile_in).expose();
+		m.read_branch_profile(in);
+	}
 	auto Gisel_main = m.create_external_function_caller<void>("main");
-	m.load(argv[1]);
-	Gisel_main();
+	
+	if(emit_cpp)
+	{
+		std::ofstream out(emit_cpp);
+		if(!out)
+			Gisel::Error(std::string("cannot write ") + emit_cpp, -2).expose();
+		m.emit_cpp(argv[arg], out);
+		return 0;
+	}
+	
+	if(native)
+		m.load_native(argv[arg]);
+	else
+	{
+		if(restore_state)
+			m.restore_state(restore_state);
+		m.load(argv[arg]);
+		if(save_state)
+			m.save_state(save_state);
+	}
+	if(storage_stats)
+		m.dump_storage_stats(std::cerr);
+	if(bench)
+	{
+		using event = Gisel::perf_counters::event;
+		Gisel::perf_counters counters;
+		
+		auto start = std::chrono::steady_clock::now();
+		counters.start();
+		Gisel_main();
+		counters.stop();
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		
+		std::cerr << std::left << std::setw(24) << "time (ms)" << elapsed.count() << std::endl;
+		for(event e : {event::cycles, event::instructions, event::cache_references, event::cache_misses})
+		{
+			std::cerr << std::setw(24) << Gisel::perf_counters::name(e);
+			if(std::optional<std::uint64_t> value = counters.get(e))
+				std::cerr << *value << std::endl;
+			else
+				std::cerr << "unavailable" << std::endl;
+		}
+		
+		std::uint64_t nodes = m.get_evaluated_nodes();
+		std::cerr << std::setw(24) << "flattened nodes" << nodes << std::endl;
+		if(std::optional<std::uint64_t> misses = counters.get(event::cache_misses); misses && nodes)
+			std::cerr << std::setw(24) << "cache misses per node" << double(*misses) / nodes << std::endl;
+	}
+	else if(async_calls)
+	{
+		// one batch of calls of task on the workers, as many as the threads
+		m.start_workers(threads ? threads : std::max(1u, std::thread::hardware_concurrency()));
+		std::vector<std::tuple<Gisel::number> > args;
+		for(int i = 0; i < async_calls; ++i)
+			args.emplace_back(Gisel::number(i));
+		for(std::future<Gisel::number>& result : m.call_async_batch<Gisel::number, Gisel::number>("task", std::move(args)))
+			std::cout << result.get() << std::endl;
+		m.stop_workers();
+	}
+	else
+		Gisel_main();
+	if(time_passes)
+		m.write_pass_timings(std::cerr);
+	
+	if(profile_out)
+	{
+		std::ofstream out(profile_out);
+		if(!out)
+			Gisel::Error(std::string("cannot write ") + profile_out, -2).expose();
+		m.write_branch_profile(out);
+	}
 
     return 0;
 }
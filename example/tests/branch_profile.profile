@@ -0,0 +1,2 @@
+6 235 91 91 91 948 546
+22 1 1 1 12
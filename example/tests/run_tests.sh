@@ -0,0 +1,54 @@
+#!/bin/sh
+# Runs every test script of this directory with the given interpreter, under every mode that
+# must not change what it prints, and compares the output with the .expected file of the script.
+# A .modes file next to a script replaces the default modes, one set of options per line. The
+# --native mode translates the script to C++, builds it with $CXX and runs the shared object.
+# @work@ in a mode names a scratch directory, which the modes of a script share in their order.
+#
+#   sh example/tests/run_tests.sh build/linux_x86_64/giseli
+
+giseli=${1:-giseli}
+dir=$(cd "$(dirname "$0")" && pwd)
+src="$dir/../../src"
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+failures=0
+
+# runs the script as a native module: giseli --emit-cpp, then a shared object built from the C++
+run_native() {
+	"$giseli" --emit-cpp "$work/$1.cpp" "$2" &&
+	${CXX:-c++} -std=c++17 -O2 -w -shared -fPIC -I"$src" "$work/$1.cpp" -o "$work/$1.so" &&
+	"$giseli" --native "$work/$1.so"
+}
+
+# run <mode> <name> <script>
+run() {
+	if [ "$1" = "--native" ]; then
+		run_native "$2" "$3"
+	else
+		# shellcheck disable=SC2086
+		"$giseli" $1 "$3"
+	fi
+}
+
+for script in "$dir"/*.gisel; do
+	name=$(basename "$script" .gisel)
+	if [ -f "$dir/$name.modes" ]; then
+		modes=$(cat "$dir/$name.modes")
+	else
+		modes=$(printf '%s\n' "-O2" "-O0" "--jit" "--tiered" "--unchecked" "--lazy-globals")
+	fi
+	
+	echo "$modes" | sed "s#@work@#$work#g" | while IFS= read -r mode; do
+		if ! (cd "$dir" && run "$mode" "$name" "$script") 2>&1 | cmp -s - "$dir/$name.expected"; then
+			echo "FAIL $name ($mode)"
+			exit 1
+		fi
+	done || failures=$((failures + 1))
+done
+
+if [ $failures -ne 0 ]; then
+	echo "$failures test scripts failed"
+	exit 1
+fi
+echo "all test scripts passed"
@@ -0,0 +1,69 @@
+/**
+ * This file is a part of the Gisel Interpreter
+ *
+ * Copyright (C) 2022 @kbz_8
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef __ARITHMETIC__
+#define __ARITHMETIC__
+
+#include <cstdint>
+#include "variable.h"
+#include "errors.h"
+
+namespace Gisel
+{
+	// the semantics of the operators, shared by the interpreter and the emitted C++
+	inline number lt(number n1, number n2) { return n1 < n2; }
+	inline number lt(integer i1, integer i2) { return i1 < i2; }
+	inline number lt(string s1, string s2) { return *s1 < *s2; }
+
+	// int arithmetic wraps around instead of overflowing
+	inline number neg(number n) { return -n; }
+	inline integer neg(integer i) { return integer(0 - std::uint64_t(i)); }
+	inline number add(number n1, number n2) { return n1 + n2; }
+	inline integer add(integer i1, integer i2) { return integer(std::uint64_t(i1) + std::uint64_t(i2)); }
+	inline number sub(number n1, number n2) { return n1 - n2; }
+	inline integer sub(integer i1, integer i2) { return integer(std::uint64_t(i1) - std::uint64_t(i2)); }
+	inline number mul(number n1, number n2) { return n1 * n2; }
+	inline integer mul(integer i1, integer i2) { return integer(std::uint64_t(i1) * std::uint64_t(i2)); }
+	inline number div(number n1, number n2) { return n1 / n2; }
+	inline number mod(number n1, number n2) { return n1 - n2 * int(n1/n2); }
+
+	inline integer div(integer i1, integer i2)
+	{
+		if(i2 == 0)
+			runtime_error("integer division by zero").expose();
+		return i2 == -1 ? neg(i1) : i1 / i2;
+	}
+
+	inline integer mod(integer i1, integer i2)
+	{
+		if(i2 == 0)
+			runtime_error("integer division by zero").expose();
+		return i2 == -1 ? 0 : i1 % i2;
+	}
+
+	inline integer to_integer(integer i) { return i; }
+
+	inline integer to_integer(number n)
+	{
+		if(!(n >= -9223372036854775808.0 && n < 9223372036854775808.0))
+			runtime_error("number out of int range").expose();
+		return integer(n);
+	}
+}
+
+#endif // __ARITHMETIC__
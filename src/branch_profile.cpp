@@ -0,0 +1,73 @@
+/**
+ * This file is a part of the Gisel Interpreter
+ *
+ * Copyright (C) 2022 @kbz_8
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "branch_profile.h"
+#include "errors.h"
+#include <sstream>
+#include <string>
+
+namespace Gisel
+{
+	std::vector<size_t>& branch_profile::counters(size_t line, size_t branches)
+	{
+		std::vector<size_t>& ret = _hits[std::make_pair(line, branches)];
+		ret.resize(branches);
+		return ret;
+	}
+
+	const std::vector<size_t>* branch_profile::find(size_t line, size_t branches) const
+	{
+		auto it = _hits.find(std::make_pair(line, branches));
+		return it == _hits.end() ? nullptr : &it->second;
+	}
+
+	void branch_profile::write(std::ostream& out) const
+	{
+		for(const auto& [key, hits] : _hits)
+		{
+			out << key.first + 1;
+			for(size_t h : hits)
+				out << ' ' << h;
+			out << '\n';
+		}
+	}
+
+	void branch_profile::read(std::istream& in)
+	{
+		std::string line;
+		while(std::getline(in, line))
+		{
+			std::istringstream fields(line);
+			size_t line_number;
+			if(!(fields >> line_number) || line_number == 0)
+				continue;
+
+			std::vector<size_t> hits;
+			for(size_t h; fields >> h;)
+				hits.push_back(h);
+
+			if(!fields.eof() || hits.size() < 2)
+				Error("malformed branch profile entry : " + line, -2).expose();
+
+			std::vector<size_t>& counters = _hits[std::make_pair(line_number - 1, hits.size())];
+			counters.resize(hits.size());
+			for(size_t i = 0; i < hits.size(); ++i)
+				counters[i] += hits[i];
+		}
+	}
+}
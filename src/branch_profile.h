@@ -0,0 +1,46 @@
+/**
+ * This file is a part of the Gisel Interpreter
+ *
+ * Copyright (C) 2022 @kbz_8
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef __BRANCH_PROFILE__
+#define __BRANCH_PROFILE__
+
+#include <istream>
+#include <map>
+#include <ostream>
+#include <vector>
+
+namespace Gisel
+{
+	// how many times every branch of the if statements of a program was taken, the last
+	// branch being the else; statements are told apart by their line and branch count
+	class branch_profile
+	{
+		public:
+			std::vector<size_t>& counters(size_t line, size_t branches);
+			const std::vector<size_t>* find(size_t line, size_t branches) const;
+
+			// one line per statement : its line, counted from 1 as in error messages, followed by the hits of each branch
+			void write(std::ostream& out) const;
+			void read(std::istream& in);
+
+		private:
+			std::map<std::pair<size_t, size_t>, std::vector<size_t> > _hits;
+	};
+}
+
+#endif // __BRANCH_PROFILE__
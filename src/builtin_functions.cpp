@@ -19,6 +19,7 @@
 
 #include "builtin_functions.h"
 #include "errors.h"
+#include "channel.h"
 #include <gisel_api.h>
 
 #include <iostream>
@@ -49,7 +50,16 @@ namespace Gisel
 		m.add_external_function("to_str", func::function<std::string(number)>(
 			[](number num)
 			{
-				return num == (int)num ? std::to_string((int)num) : std::to_string(num);
+				// integral values within the range of int64 print without decimals
+				if(num == std::trunc(num) && num >= -9223372036854775808.0 && num < 9223372036854775808.0)
+					return std::to_string(std::int64_t(num));
+				return std::to_string(num);
+			}
+		));
+		m.add_external_function("int_to_str", func::function<std::string(integer)>(
+			[](integer num)
+			{
+				return std::to_string(num);
 			}
 		));
 		m.add_external_function("to_num", func::function<number(const std::string&)>(
@@ -88,15 +98,117 @@ namespace Gisel
 		));
 	}
 
+	namespace
+	{
+		// what the receiving builtins return
+		inline integer status_code(channel_status status)
+		{
+			switch(status)
+			{
+				case channel_status::received: return 1;
+				case channel_status::empty: return 0;
+				default: return -1;
+			}
+		}
+	}
+
+	void add_channel_functions(Module& m)
+	{
+		m.add_external_function("channel", func::function<integer(number)>(
+			[](number capacity)
+			{
+				return open_channel<number>(size_t(capacity));
+			}
+		));
+		m.add_external_function("str_channel", func::function<integer(number)>(
+			[](number capacity)
+			{
+				return open_channel<std::string>(size_t(capacity));
+			}
+		));
+
+		m.add_external_function("send", func::function<void(integer, number)>(
+			[](integer ch, number value)
+			{
+				send_to_channel<number>(ch, value);
+			}
+		));
+		m.add_external_function("send_str", func::function<void(integer, const std::string&)>(
+			[](integer ch, const std::string& value)
+			{
+				send_to_channel<std::string>(ch, value);
+			}
+		));
+
+		// 1 when a message is received, -1 once the channel is closed and all of its messages received
+		m.add_external_function("recv", func::function<integer(integer, number&)>(
+			[](integer ch, number& value)
+			{
+				return status_code(recv_from_channel<number>(ch, value));
+			}
+		));
+		m.add_external_function("recv_str", func::function<integer(integer, string&)>(
+			[](integer ch, string& value)
+			{
+				std::string received;
+				channel_status status = recv_from_channel<std::string>(ch, received);
+				if(status == channel_status::received)
+					value = std::make_shared<std::string>(std::move(received));
+				return status_code(status);
+			}
+		));
+
+		// the same, or 0 without waiting when there is no message yet
+		m.add_external_function("try_recv", func::function<integer(integer, number&)>(
+			[](integer ch, number& value)
+			{
+				return status_code(try_recv_from_channel<number>(ch, value));
+			}
+		));
+		m.add_external_function("try_recv_str", func::function<integer(integer, string&)>(
+			[](integer ch, string& value)
+			{
+				std::string received;
+				channel_status status = try_recv_from_channel<std::string>(ch, received);
+				if(status == channel_status::received)
+					value = std::make_shared<std::string>(std::move(received));
+				return status_code(status);
+			}
+		));
+
+		m.add_external_function("close", func::function<void(integer)>(
+			[](integer ch)
+			{
+				close_channel(ch);
+			}
+		));
+	}
+
 	void add_standard_functions(Module& m)
 	{
 		add_string_functions(m);
 		add_io_functions(m);
+		add_channel_functions(m);
 
-		m.add_external_function("int", func::function<number(number)>(
-			[](number x)
+		// Same algorithm as the former Gisel implementation from maths.gisel. The compiler
+		// expands calls with a small constant exponent to the same chain of operations.
+		m.add_external_function("pow", func::function<number(number, number)>(
+			[](number x, number p)
 			{
-				return int(x);
+				if(p == 0)
+					return number(1);
+				number res = x;
+				if(p > 1)
+				{
+					for(; p > 1; p--)
+						res = res * x;
+				}
+				else
+				{
+					for(; p < 1; p++)
+						res = res / x;
+				}
+				return res;
 			}
 		));
 
@@ -28,6 +28,8 @@ namespace Gisel
 		
 	void add_string_functions(Module& m);
 	void add_io_functions(Module& m);
+	// channel, str_channel, send, send_str, recv, recv_str, try_recv, try_recv_str and close
+	void add_channel_functions(Module& m);
 
 	void add_standard_functions(Module& m);
 }
@@ -0,0 +1,293 @@
+/**
+ * This file is a part of the Gisel Interpreter
+ *
+ * Copyright (C) 2022 @kbz_8
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <shared_mutex>
+#include <unordered_map>
+#include <utility>
+#include "channel.h"
+#include "errors.h"
+#include "sleepers.h"
+
+namespace Gisel
+{
+	void channel_base::close()
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_enqueue_pos.fetch_or(closed_bit, std::memory_order_acq_rel);
+		}
+		_not_full.notify_all();
+		_not_empty.notify_all();
+	}
+
+	template <class P>
+	void channel_base::park(std::condition_variable& cv, std::atomic<size_t>& waiting, P ready)
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		sleep_until(lock, cv, waiting, ready);
+	}
+
+	namespace
+	{
+		inline size_t round_capacity(size_t capacity)
+		{
+			size_t rounded = 2;
+			while(rounded < capacity)
+				rounded *= 2;
+			return rounded;
+		}
+	}
+
+	template <typename T>
+	channel<T>::channel(size_t capacity) : channel_base(round_capacity(capacity)), _cells(new cell[_capacity]), _mask(_capacity - 1)
+	{
+		for(size_t i = 0; i < _capacity; ++i)
+			_cells[i].sequence.store(i, std::memory_order_relaxed);
+	}
+
+	// a cell is free for the position p when its sequence is p, and holds the message of p when it is p + 1;
+	// the position of a closed channel has the closed bit, no cell can be claimed for it
+	template <typename T>
+	bool channel<T>::push(T& value)
+	{
+		size_t pos = _enqueue_pos.load(std::memory_order_relaxed);
+		for(;;)
+		{
+			if(pos & closed_bit)
+				return false;
+			cell& c = _cells[pos & _mask];
+			const size_t sequence = c.sequence.load(std::memory_order_acquire);
+			const std::ptrdiff_t diff = std::ptrdiff_t(sequence) - std::ptrdiff_t(pos);
+			if(diff == 0)
+			{
+				if(_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				{
+					c.value = std::move(value);
+					c.sequence.store(pos + 1, std::memory_order_release);
+					return true;
+				}
+			}
+			else if(diff < 0)
+				return false;
+			else
+				pos = _enqueue_pos.load(std::memory_order_relaxed);
+		}
+	}
+
+	template <typename T>
+	bool channel<T>::pop(T& value)
+	{
+		size_t pos = _dequeue_pos.load(std::memory_order_relaxed);
+		for(;;)
+		{
+			cell& c = _cells[pos & _mask];
+			const size_t sequence = c.sequence.load(std::memory_order_acquire);
+			const std::ptrdiff_t diff = std::ptrdiff_t(sequence) - std::ptrdiff_t(pos + 1);
+			if(diff == 0)
+			{
+				if(_dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				{
+					value = std::move(c.value);
+					c.sequence.store(pos + _mask + 1, std::memory_order_release);
+					return true;
+				}
+			}
+			else if(diff < 0)
+				return false;
+			else
+				pos = _dequeue_pos.load(std::memory_order_relaxed);
+		}
+	}
+
+	template <typename T>
+	bool channel<T>::try_send(T& value)
+	{
+		if(!push(value))
+			return false;
+		wake_one(_mutex, _not_empty, _waiting_receivers);
+		return true;
+	}
+
+	template <typename T>
+	bool channel<T>::send(T value)
+	{
+		while(!try_send(value))
+		{
+			if(closed())
+				return false;
+			park(_not_full, _waiting_senders, [this]() { return closed() || !full(); });
+		}
+		return true;
+	}
+
+	template <typename T>
+	channel_status channel<T>::try_recv(T& value)
+	{
+		if(pop(value))
+		{
+			wake_one(_mutex, _not_full, _waiting_senders);
+			return channel_status::received;
+		}
+		
+		// the position of a closed channel no longer moves, a message claimed before and not published yet keeps it
+		// ahead of the dequeue position
+		const size_t pos = _enqueue_pos.load(std::memory_order_acquire);
+		return (pos & closed_bit) && (pos & ~closed_bit) == _dequeue_pos.load(std::memory_order_acquire) ? channel_status::closed : channel_status::empty;
+	}
+
+	template <typename T>
+	channel_status channel<T>::recv(T& value)
+	{
+		for(;;)
+		{
+			const channel_status status = try_recv(value);
+			if(status != channel_status::empty)
+				return status;
+			park(_not_empty, _waiting_receivers, [this]() { return closed() || !empty(); });
+		}
+	}
+
+	template class channel<number>;
+	template class channel<std::string>;
+
+	namespace
+	{
+		// never destroyed, as the scheduler: the threads of the process may use it until they exit
+		struct channel_registry
+		{
+			std::shared_mutex mutex;
+			std::unordered_map<integer, std::shared_ptr<channel_base> > channels;
+			integer next_id = 1;
+		};
+
+		channel_registry& registry()
+		{
+			static channel_registry* r = new channel_registry();
+			return *r;
+		}
+
+		// a thread mostly talks through the same channel, which it finds again without a lock
+		thread_local std::pair<integer, std::shared_ptr<channel_base> > last_found;
+
+		std::shared_ptr<channel_base> find_any_channel(integer id)
+		{
+			if(last_found.first == id && last_found.second)
+				return last_found.second;
+			
+			channel_registry& r = registry();
+			std::shared_lock<std::shared_mutex> lock(r.mutex);
+			auto it = r.channels.find(id);
+			if(it == r.channels.end())
+			{
+				if(id <= 0 || id >= r.next_id)
+					runtime_error("there is no channel " + std::to_string(id)).expose();
+				return nullptr;
+			}
+			last_found = {id, it->second};
+			return it->second;
+		}
+
+		// the number of a channel closed and drained is not given again, its operations find it closed
+		void forget_channel(integer id)
+		{
+			channel_registry& r = registry();
+			std::unique_lock<std::shared_mutex> lock(r.mutex);
+			r.channels.erase(id);
+		}
+	}
+
+	template <typename T>
+	integer open_channel(size_t capacity)
+	{
+		if(capacity == 0)
+			runtime_error("a channel needs room for a message").expose();
+		
+		auto c = std::make_shared<channel<T> >(capacity);
+		channel_registry& r = registry();
+		std::unique_lock<std::shared_mutex> lock(r.mutex);
+		const integer id = r.next_id++;
+		r.channels.emplace(id, std::move(c));
+		return id;
+	}
+
+	template <typename T>
+	std::shared_ptr<channel<T> > find_channel(integer id)
+	{
+		std::shared_ptr<channel_base> c = find_any_channel(id);
+		if(!c)
+			return nullptr;
+		std::shared_ptr<channel<T> > ret = std::dynamic_pointer_cast<channel<T> >(c);
+		if(!ret)
+			runtime_error("the channel " + std::to_string(id) + " carries another type of messages").expose();
+		return ret;
+	}
+
+	void close_channel(integer id)
+	{
+		if(std::shared_ptr<channel_base> c = find_any_channel(id))
+		{
+			c->close();
+			if(c->empty())
+				forget_channel(id);
+		}
+	}
+
+	template <typename T>
+	void send_to_channel(integer id, T value)
+	{
+		std::shared_ptr<channel<T> > c = find_channel<T>(id);
+		if(!c || !c->send(std::move(value)))
+			runtime_error("send to the closed channel " + std::to_string(id)).expose();
+	}
+
+	template <typename T>
+	channel_status recv_from_channel(integer id, T& value)
+	{
+		std::shared_ptr<channel<T> > c = find_channel<T>(id);
+		if(!c)
+			return channel_status::closed;
+		const channel_status status = c->recv(value);
+		if(status == channel_status::closed)
+			forget_channel(id);
+		return status;
+	}
+
+	template <typename T>
+	channel_status try_recv_from_channel(integer id, T& value)
+	{
+		std::shared_ptr<channel<T> > c = find_channel<T>(id);
+		if(!c)
+			return channel_status::closed;
+		const channel_status status = c->try_recv(value);
+		if(status == channel_status::closed)
+			forget_channel(id);
+		return status;
+	}
+
+	template integer open_channel<number>(size_t);
+	template integer open_channel<std::string>(size_t);
+	template std::shared_ptr<channel<number> > find_channel<number>(integer);
+	template std::shared_ptr<channel<std::string> > find_channel<std::string>(integer);
+	template void send_to_channel<number>(integer, number);
+	template void send_to_channel<std::string>(integer, std::string);
+	template channel_status recv_from_channel<number>(integer, number&);
+	template channel_status recv_from_channel<std::string>(integer, std::string&);
+	template channel_status try_recv_from_channel<number>(integer, number&);
+	template channel_status try_recv_from_channel<std::string>(integer, std::string&);
+}
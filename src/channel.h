@@ -0,0 +1,127 @@
+/**
+ * This file is a part of the Gisel Interpreter
+ *
+ * Copyright (C) 2022 @kbz_8
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef __CHANNEL__
+#define __CHANNEL__
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "variable.h"
+
+namespace Gisel
+{
+	enum class channel_status
+	{
+		received,
+		empty,
+		closed // and empty
+	};
+
+	// what the channels of every type of message share: their positions, and where their threads sleep
+	class channel_base
+	{
+		public:
+			virtual ~channel_base() = default;
+
+			// the messages sent before are still received, sending after is an error
+			void close();
+			inline bool closed() const noexcept { return (_enqueue_pos.load(std::memory_order_acquire) & closed_bit) != 0; }
+			inline bool empty() const noexcept { return _dequeue_pos.load(std::memory_order_acquire) == enqueue_position(); }
+
+		protected:
+			explicit channel_base(size_t capacity) : _capacity(capacity), _enqueue_pos(0), _dequeue_pos(0), _waiting_senders(0), _waiting_receivers(0) {}
+
+			// set in the enqueue position once the channel is closed, so that a sender cannot claim a cell after it
+			static constexpr const size_t closed_bit = ~(~size_t(0) >> 1);
+
+			size_t _capacity;
+			alignas(64) std::atomic<size_t> _enqueue_pos;
+			alignas(64) std::atomic<size_t> _dequeue_pos;
+			alignas(64) std::mutex _mutex;
+			std::condition_variable _not_full;
+			std::condition_variable _not_empty;
+			std::atomic<size_t> _waiting_senders;
+			std::atomic<size_t> _waiting_receivers;
+
+			inline size_t enqueue_position() const noexcept { return _enqueue_pos.load(std::memory_order_acquire) & ~closed_bit; }
+			inline bool full() const noexcept { return enqueue_position() - _dequeue_pos.load(std::memory_order_acquire) >= _capacity; }
+			// blocks until ready returns true; the thread runs no task meanwhile, which could
+			// wait in turn for what this thread would do once woken
+			template <class P>
+			void park(std::condition_variable& cv, std::atomic<size_t>& waiting, P ready);
+
+		private:
+			channel_base(const channel_base&) = delete;
+			void operator=(const channel_base&) = delete;
+	};
+
+	// a bounded queue of messages for any number of threads on both sides, after the ring buffer of Vyukov: a thread
+	// claims a cell by a compare and swap of the position, and the sequence number of the cell publishes its message;
+	// the threads only take a lock to sleep while the channel is full or empty, or to wake the ones sleeping
+	template <typename T>
+	class channel: public channel_base
+	{
+		public:
+			// the capacity is rounded up to a power of 2
+			explicit channel(size_t capacity);
+
+			// false when the channel is closed, after waiting for room while it is full
+			bool send(T value);
+			// false without moving the value when the channel is full or closed
+			bool try_send(T& value);
+			// waits for a message, until the channel is closed
+			channel_status recv(T& value);
+			channel_status try_recv(T& value);
+
+		private:
+			struct cell
+			{
+				std::atomic<size_t> sequence;
+				T value;
+			};
+
+			std::unique_ptr<cell[]> _cells;
+			size_t _mask;
+
+			bool push(T& value);
+			bool pop(T& value);
+	};
+
+	// the channels are known to the scripts by a number, and shared by every module and thread of the process;
+	// messages are numbers or std::strings
+	template <typename T>
+	integer open_channel(size_t capacity);
+	// null once the channel is closed and all of its messages are received; a runtime error when
+	// no channel has that number, or when it carries other messages
+	template <typename T>
+	std::shared_ptr<channel<T> > find_channel(integer id);
+	void close_channel(integer id);
+	// the host and the builtins send to a closed channel as a runtime error
+	template <typename T>
+	void send_to_channel(integer id, T value);
+	template <typename T>
+	channel_status recv_from_channel(integer id, T& value);
+	template <typename T>
+	channel_status try_recv_from_channel(integer id, T& value);
+}
+
+#endif // __CHANNEL__
@@ -18,6 +18,9 @@
  */
 
 #include "gisel.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
 
 namespace Gisel
 {
@@ -26,9 +29,13 @@ namespace Gisel
         size_t break_level;
         bool can_continue;
         type_handle return_type_id;
+        bool can_return;
         
-        inline possible_flow add_loop() { return possible_flow{break_level+1, true, return_type_id}; }
-        inline static possible_flow in_function(type_handle return_type_id) { return possible_flow{0, false, return_type_id}; }
+        inline possible_flow add_loop() { return possible_flow{break_level+1, true, return_type_id, can_return}; }
+        inline possible_flow add_switch() { return possible_flow{break_level+1, can_continue, return_type_id, can_return}; }
+        // the iterations of a parallel loop can only end early by a continue
+        inline possible_flow add_parallel_loop() { return possible_flow{0, true, return_type_id, false}; }
+        inline static possible_flow in_function(type_handle return_type_id) { return possible_flow{0, false, return_type_id, true}; }
     };
 
     bool is_typename(const compiler_context&, const tk_iterator& it)
@@ -41,6 +48,7 @@ namespace Gisel
                 {
                     case Tokens::type_number:
                     case Tokens::type_string:
+                    case Tokens::type_int:
                     case Tokens::type_void:
                     default: return false;
                 }
@@ -51,12 +59,17 @@ namespace Gisel
 
     inline Error unexpected_syntax(const tk_iterator& it) { return unexpected_syntax_error(std::to_string(it->get_value()).c_str(), it->get_line_number()); }
     
-    std::vector<expression<lvalue>::ptr> compile_variable_declaration(compiler_context& ctx, tk_iterator& it)
+    struct variable_declaration
+    {
+        const identifier_info* info = nullptr;
+        node_ptr initializer;
+    };
+    
+    std::string parse_variable_declaration(compiler_context& ctx, tk_iterator& it, type_handle& type_id, node_ptr& initializer)
     {
         parse_token_value(ctx, it, Tokens::kw_var);
         std::string name = parse_declaration_name(ctx, it);
 
-        type_handle type_id = nullptr;
         if(it->has_value(Tokens::type_specifier))
         {
             parse_token_value(ctx, it, Tokens::type_specifier);
@@ -65,30 +78,141 @@ namespace Gisel
             if(type_id == type_registry::get_void_handle())
                 syntax_error("cannot declare void variable", it->get_line_number()).expose();
         }
-    
-        std::vector<expression<lvalue>::ptr> ret;
         
         if(it->has_value(Tokens::assign))
         {
             ++it;
-            ret.emplace_back(build_initialization_expression(ctx, it, type_id, false));
+            initializer = parse_expression(ctx, it, type_id, false);
         }
-        else
-            ret.emplace_back(build_default_initialization(type_id));
+        
+        return name;
+    }
+    
+    bool has_call(const node_ptr& np)
+    {
+        if(np->is_node_operation() && np->get_node_operation() == node_operation::call)
+            return true;
+        return std::any_of(np->get_children().begin(), np->get_children().end(), has_call);
+    }
+    
+    expression<lvalue>::ptr compile_global_declaration(compiler_context& ctx, tk_iterator& it)
+    {
+        type_handle type_id = nullptr;
+        node_ptr initializer;
+        std::string name = parse_variable_declaration(ctx, it, type_id, initializer);
+        
+        if(initializer && has_call(initializer))
+            ctx.log_initializer_call();
+        
+        expression<lvalue>::ptr ret = initializer ? build_initialization_expression(ctx, initializer, type_id) : build_default_initialization(type_id);
         
         ctx.create_identifier(std::move(name), type_id);
         
         return ret;
     }
     
+    // trees of literals that evaluate the same at compile time as they would at run time
+    bool is_constant_tree(const node_ptr& np)
+    {
+        if(np->is_number() || np->is_string())
+            return true;
+        if(!np->is_node_operation())
+            return false;
+        
+        switch(np->get_node_operation())
+        {
+            case node_operation::positive: case node_operation::negative: case node_operation::bnot: case node_operation::lnot:
+            case node_operation::to_integer: case node_operation::to_number:
+            case node_operation::add: case node_operation::sub: case node_operation::mul: case node_operation::div: case node_operation::mod:
+            case node_operation::band: case node_operation::bor: case node_operation::bxor: case node_operation::shl: case node_operation::shr:
+            case node_operation::eq: case node_operation::ne: case node_operation::lt: case node_operation::gt: case node_operation::le: case node_operation::ge:
+            case node_operation::land: case node_operation::lor: case node_operation::ternary:
+                return std::all_of(np->get_children().begin(), np->get_children().end(), is_constant_tree);
+            
+            default: return false;
+        }
+    }
+    
+    std::optional<constant_value> evaluate_constant(compiler_context& ctx, const node_ptr& np, type_handle type_id)
+    {
+        if(!is_constant_tree(np))
+            return std::nullopt;
+        
+        runtime_context context(std::make_shared<const program>(std::vector<expression<lvalue>::ptr>(), std::vector<function>(), std::unordered_map<std::string, program::public_function>()));
+        
+        if(type_id == type_registry::get_string_handle())
+            return std::string(*build_string_expression(ctx, np)->evaluate(context));
+        
+        if(type_id == type_registry::get_integer_handle())
+        {
+            // the value of an int constant is kept as a double
+            integer value = build_integer_expression(ctx, np)->evaluate(context);
+            if(value >= (integer(1) << 53) || value <= -(integer(1) << 53))
+                return std::nullopt;
+            return double(value);
+        }
+        
+        return build_number_expression(ctx, np)->evaluate(context);
+    }
+    
+    void compile_constant_declaration(compiler_context& ctx, tk_iterator& it)
+    {
+        parse_token_value(ctx, it, Tokens::kw_const);
+        std::string name = parse_declaration_name(ctx, it);
+        type_handle type_id = nullptr;
+        
+        if(it->has_value(Tokens::type_specifier))
+        {
+            parse_token_value(ctx, it, Tokens::type_specifier);
+            type_id = parse_type(ctx, it);
+        }
+        
+        parse_token_value(ctx, it, Tokens::assign);
+        node_ptr initializer = parse_expression(ctx, it, type_id ? type_id : type_registry::get_void_handle(), false);
+        
+        if(!type_id)
+            type_id = initializer->get_type_id();
+        if(type_id != type_registry::get_number_handle() && type_id != type_registry::get_integer_handle() && type_id != type_registry::get_string_handle())
+            semantic_error("a constant must be a num, an int or a str", initializer->get_line_number()).expose();
+        
+        std::optional<constant_value> value = evaluate_constant(ctx, initializer, type_id);
+        if(!value)
+            semantic_error(("the value of constant '" + name + "' is not known at compile time").c_str(), initializer->get_line_number()).expose();
+        
+        ctx.create_constant(std::move(name), type_id, std::move(*value));
+    }
+    
+    std::vector<expression<void>::ptr> compile_variable_declaration(compiler_context& ctx, tk_iterator& it, variable_declaration* declaration = nullptr)
+    {
+        size_t line_number = it->get_line_number();
+        type_handle type_id = nullptr;
+        node_ptr initializer;
+        std::string name = parse_variable_declaration(ctx, it, type_id, initializer);
+        
+        bool boxed = ctx.is_referenced(name);
+        ctx.log_local_storage(name, line_number, boxed);
+    
+        std::vector<expression<void>::ptr> ret;
+        ret.emplace_back(build_local_declaration(ctx, initializer, type_id, boxed));
+        
+        const identifier_info* info = ctx.create_identifier(std::move(name), type_id);
+        
+        if(declaration)
+            *declaration = variable_declaration{info, std::move(initializer)};
+        
+        return ret;
+    }
+    
     statement_ptr compile_simple_statement(compiler_context& ctx, tk_iterator& it);
     statement_ptr compile_block_statement(compiler_context& ctx, tk_iterator& it, possible_flow pf);
     statement_ptr compile_for_statement(compiler_context& ctx, tk_iterator& it, possible_flow pf);
+    statement_ptr compile_parallel_for_statement(compiler_context& ctx, tk_iterator& it, possible_flow pf);
     statement_ptr compile_while_statement(compiler_context& ctx, tk_iterator& it, possible_flow pf);
     statement_ptr compile_do_statement(compiler_context& ctx, tk_iterator& it, possible_flow pf);
     statement_ptr compile_if_statement(compiler_context& ctx, tk_iterator& it, possible_flow pf);
     statement_ptr compile_switch_statement(compiler_context& ctx, tk_iterator& it, possible_flow pf);
     statement_ptr compile_var_statement(compiler_context& ctx, tk_iterator& it);
+    statement_ptr compile_const_statement(compiler_context& ctx, tk_iterator& it);
     statement_ptr compile_break_statement(compiler_context& ctx, tk_iterator& it, possible_flow pf);
     statement_ptr compile_continue_statement(compiler_context& ctx, tk_iterator& it, possible_flow pf);
     statement_ptr compile_return_statement(compiler_context& ctx, tk_iterator& it, possible_flow pf);
@@ -100,10 +224,13 @@ namespace Gisel
             switch(it->get_token())
             {
                 case Tokens::kw_var:       return compile_var_statement(ctx, it);
+                case Tokens::kw_const:     return compile_const_statement(ctx, it);
                 case Tokens::kw_for:       return compile_for_statement(ctx, it, pf.add_loop());
+                case Tokens::kw_parallel:  return compile_parallel_for_statement(ctx, it, pf.add_parallel_loop());
                 case Tokens::kw_while:     return compile_while_statement(ctx, it, pf.add_loop());
                 case Tokens::kw_do:        return compile_do_statement(ctx, it, pf.add_loop());
                 case Tokens::statement_if: return compile_if_statement(ctx, it, pf);
+                case Tokens::statement_switch: return compile_switch_statement(ctx, it, pf.add_switch());
                 case Tokens::kw_break:     return compile_break_statement(ctx, it, pf);
                 case Tokens::kw_continue:  return compile_continue_statement(ctx, it, pf);
                 case Tokens::kw_return:    return compile_return_statement(ctx, it, pf);
@@ -123,38 +250,207 @@ namespace Gisel
         return ret;
     }
     
+    // every iteration of a loop is a back edge of the profiled function
+    statement_ptr count_back_edges(compiler_context& ctx, statement_ptr block)
+    {
+        if(std::atomic<size_t>* counter = ctx.get_back_edge_counter())
+            return create_counting_statement(std::move(block), *counter);
+        return block;
+    }
+    
+    // a counted loop is fully unrolled when it runs at most max_unrolled_trips times
+    // and the copies of its body take no more than max_unrolled_tokens tokens
+    constexpr const size_t max_unrolled_trips = 16;
+    constexpr const size_t max_unrolled_tokens = 256;
+    
     statement_ptr compile_for_statement(compiler_context& ctx, tk_iterator& it, possible_flow pf)
     {
-        ctx.scope();
+        auto _ = ctx.scope();
     
         parse_token_value(ctx, it, Tokens::kw_for);
         parse_token_value(ctx, it, Tokens::bracket_b);
         
-        std::vector<expression<lvalue>::ptr> decls;
+        std::vector<expression<void>::ptr> decls;
         expression<void>::ptr expr1;
+        variable_declaration initialized;
         
         if(it->has_value(Tokens::kw_var))
-            decls = compile_variable_declaration(ctx, it);
+            decls = compile_variable_declaration(ctx, it, &initialized);
         else
-            expr1 = build_void_expression(ctx, it);
+        {
+            node_ptr init = parse_expression(ctx, it, type_registry::get_void_handle(), true);
+            expr1 = build_void_expression(ctx, init);
+            
+            if(init && init->is_node_operation() && init->get_node_operation() == node_operation::assign && init->get_children()[0]->is_identifier())
+            {
+                initialized.info = ctx.find(std::string(init->get_children()[0]->get_identifier()));
+                initialized.initializer = std::move(init->get_children()[1]);
+            }
+        }
     
         parse_token_value(ctx, it, Tokens::semicolon);
         
-        expression<number>::ptr expr2 = build_number_expression(ctx, it);
+        node_ptr condition = parse_expression(ctx, it, type_registry::get_number_handle(), true);
+        expression<number>::ptr expr2 = build_number_expression(ctx, condition);
 
         parse_token_value(ctx, it, Tokens::semicolon);
         
-        expression<void>::ptr expr3 = build_void_expression(ctx, it);
+        node_ptr step = parse_expression(ctx, it, type_registry::get_void_handle(), true);
+        expression<void>::ptr expr3 = build_void_expression(ctx, step);
 
         parse_token_value(ctx, it, Tokens::bracket_e);
         
+        // without the loops pass, as at -O0 and in the first tier, every loop is a plain for statement
+        std::optional<counted_loop> loop;
+        if(ctx.passes().is_enabled(pass::loops))
+            loop = recognize_counted_loop(ctx, condition, step);
+        if(loop && loop->counter == initialized.info && initialized.initializer)
+            loop->start = get_constant(initialized.initializer);
+        
+        // the body is compiled knowing the values the counter takes, unless it turns out to write it
+        std::optional<value_range> range;
+        if(loop)
+        {
+            auto timing = ctx.passes().time(pass::loops);
+            range = get_counter_range(*loop);
+        }
+        if(range)
+            ctx.set_range(loop->counter, *range);
+        
+        const size_t writes = ctx.writes_mark();
+        std::deque<Token> body;
+        
+        it.start_recording(body);
         statement_ptr block = compile_block_statement(ctx, it, pf);
+        it.stop_recording();
+        
+        if(range)
+            ctx.clear_range(loop->counter);
+        
+        if(loop && (ctx.is_written_since(writes, loop->counter) || (loop->bound_variable && ctx.is_written_since(writes, loop->bound_variable))))
+        {
+            if(range)
+            {
+                auto timing = ctx.passes().time(pass::loops);
+                std::deque<Token> tokens = body;
+                tk_iterator body_it(tokens);
+                block = compile_block_statement(ctx, body_it, pf);
+            }
+            loop.reset();
+        }
+        
+        block = count_back_edges(ctx, std::move(block));
+        
+        if(loop)
+        {
+            std::optional<size_t> trips = get_trip_count(*loop, max_unrolled_trips);
+            
+            if(trips && *trips * body.size() <= max_unrolled_tokens)
+            {
+                auto timing = ctx.passes().time(pass::loops);
+                
+                // every copy of the body is compiled with the counter bound to its value
+                std::vector<statement_ptr> copies;
+                double value = *loop->start;
+                
+                for(size_t i = 0; i < *trips; ++i, value += loop->step)
+                {
+                    auto _ = ctx.scope();
+                    ctx.create_constant(loop->name, type_registry::get_number_handle(), value);
+                    
+                    std::deque<Token> tokens = body;
+                    tk_iterator copy_it(tokens);
+                    copies.push_back(compile_block_statement(ctx, copy_it, pf));
+                }
+                
+                return create_unrolled_for_statement(std::move(decls), std::move(expr1), *loop, std::move(copies));
+            }
+            
+            return create_counted_for_statement(std::move(decls), std::move(expr1), *loop, std::move(block));
+        }
         
         if(!decls.empty())
             return create_for_statement(std::move(decls), std::move(expr2), std::move(expr3), std::move(block));
         return create_for_statement(std::move(expr1), std::move(expr2), std::move(expr3), std::move(block));
     }
     
+    // parallel(reduction, ...) for(var counter ...) body
+    statement_ptr compile_parallel_for_statement(compiler_context& ctx, tk_iterator& it, possible_flow pf)
+    {
+        auto _ = ctx.scope();
+        
+        size_t line_number = it->get_line_number();
+        parse_token_value(ctx, it, Tokens::kw_parallel);
+        
+        std::vector<const identifier_info*> reductions;
+        
+        if(it->has_value(Tokens::bracket_b))
+        {
+            parse_token_value(ctx, it, Tokens::bracket_b);
+            for(bool first = true; !it->has_value(Tokens::bracket_e); first = false)
+            {
+                if(!first)
+                    parse_token_value(ctx, it, Tokens::comma);
+                if(!it->is_identifier())
+                    unexpected_syntax(it).expose();
+                
+                const std::string& name = it->get_identifier().name;
+                const identifier_info* info = ctx.find(name);
+                if(!info)
+                    undeclared_error(name.c_str(), it->get_line_number()).expose();
+                if(info->get_scope() != identifier_scope::local_variable || (info->type_id() != type_registry::get_number_handle() && info->type_id() != type_registry::get_integer_handle()))
+                    semantic_error(("the reduction " + name + " of a parallel loop must be a local num or int").c_str(), it->get_line_number()).expose();
+                reductions.push_back(info);
+                ++it;
+            }
+            parse_token_value(ctx, it, Tokens::bracket_e);
+        }
+        
+        parse_token_value(ctx, it, Tokens::kw_for);
+        parse_token_value(ctx, it, Tokens::bracket_b);
+        
+        if(!it->has_value(Tokens::kw_var))
+            syntax_error("a parallel loop must declare its counter", it->get_line_number()).expose();
+        
+        variable_declaration initialized;
+        std::vector<expression<void>::ptr> decls = compile_variable_declaration(ctx, it, &initialized);
+        
+        parse_token_value(ctx, it, Tokens::semicolon);
+        node_ptr condition = parse_expression(ctx, it, type_registry::get_number_handle(), true);
+        parse_token_value(ctx, it, Tokens::semicolon);
+        node_ptr step = parse_expression(ctx, it, type_registry::get_void_handle(), true);
+        parse_token_value(ctx, it, Tokens::bracket_e);
+        
+        std::optional<counted_loop> loop = recognize_counted_loop(ctx, condition, step);
+        if(!loop || loop->counter != initialized.info)
+            semantic_error("a parallel loop must count, comparing its counter to a constant or a local and stepping it by a constant", line_number).expose();
+        if(initialized.initializer)
+            loop->start = get_constant(initialized.initializer);
+        if(loop->comparison == loop_comparison::ne && loop->start && !loop->bound_variable && !is_bounded_integral_loop(loop->comparison, *loop->start, loop->bound, loop->step))
+            semantic_error("the step of a parallel loop on != must divide the distance from its start to its bound", line_number).expose();
+        
+        std::optional<value_range> range;
+        if(ctx.passes().is_enabled(pass::loops))
+        {
+            auto timing = ctx.passes().time(pass::loops);
+            range = get_counter_range(*loop);
+        }
+        if(range)
+            ctx.set_range(loop->counter, *range);
+        
+        statement_ptr block;
+        {
+            // the counter and the bound are declared before the body, so they cannot be written either
+            auto parallel = ctx.parallel(ctx.next_local_index(), reductions);
+            block = compile_block_statement(ctx, it, pf);
+        }
+        
+        if(range)
+            ctx.clear_range(loop->counter);
+        
+        return create_parallel_for_statement(std::move(decls), *loop, reductions, count_back_edges(ctx, std::move(block)));
+    }
+    
     statement_ptr compile_while_statement(compiler_context& ctx, tk_iterator& it, possible_flow pf)
     {
         parse_token_value(ctx, it, Tokens::kw_while);
@@ -163,7 +459,7 @@ namespace Gisel
         expression<number>::ptr expr = build_number_expression(ctx, it);
         parse_token_value(ctx, it, Tokens::bracket_e);
         
-        statement_ptr block = compile_block_statement(ctx, it, pf);
+        statement_ptr block = count_back_edges(ctx, compile_block_statement(ctx, it, pf));
         
         return create_while_statement(std::move(expr), std::move(block));
     }
@@ -172,7 +468,7 @@ namespace Gisel
     {
         parse_token_value(ctx, it, Tokens::kw_do);
         
-        statement_ptr block = compile_block_statement(ctx, it, pf);
+        statement_ptr block = count_back_edges(ctx, compile_block_statement(ctx, it, pf));
         
         parse_token_value(ctx, it, Tokens::kw_while);
         
@@ -183,14 +479,104 @@ namespace Gisel
         return create_do_statement(std::move(expr), std::move(block));
     }
     
+    // an elif chain whose conditions all compare the same variable to a constant of their own: they have
+    // no side effect and can be tested in any order, they only hold together when the variable is NaN
+    struct elif_chain
+    {
+        const node_ptr* variable;
+        std::vector<constant_value> constants;
+    };
+    
+    std::optional<constant_value> get_case_constant(const node_ptr& np, type_handle type_id)
+    {
+        if(type_id == type_registry::get_string_handle())
+            return np->is_string() ? std::optional<constant_value>(std::string(np->get_string())) : std::nullopt;
+        
+        std::optional<double> c = get_constant(np);
+        if(!c || std::isnan(*c))
+            return std::nullopt;
+        // the constants of an int chain are compared as ints
+        if(type_id == type_registry::get_integer_handle() && (*c != std::trunc(*c) || std::fabs(*c) >= 0x1p63))
+            return std::nullopt;
+        return *c;
+    }
+    
+    std::optional<elif_chain> recognize_elif_chain(compiler_context& ctx, const std::vector<node_ptr>& conditions)
+    {
+        const identifier_info* discriminant = nullptr;
+        elif_chain ret{nullptr, {}};
+        
+        for(const node_ptr& condition : conditions)
+        {
+            if(!condition->is_node_operation() || condition->get_node_operation() != node_operation::eq)
+                return std::nullopt;
+            
+            const std::vector<node_ptr>& children = condition->get_children();
+            const bool constant_first = !children[0]->is_identifier();
+            const node_ptr& variable = children[constant_first ? 1 : 0];
+            
+            if(!variable->is_identifier())
+                return std::nullopt;
+            
+            const identifier_info* info = ctx.find(std::string(variable->get_identifier()));
+            if(!info || (discriminant && info != discriminant))
+                return std::nullopt;
+            if(info->type_id() != type_registry::get_number_handle() && info->type_id() != type_registry::get_integer_handle() && info->type_id() != type_registry::get_string_handle())
+                return std::nullopt;
+            
+            std::optional<constant_value> constant = get_case_constant(children[constant_first ? 0 : 1], info->type_id());
+            if(!constant || std::find(ret.constants.begin(), ret.constants.end(), *constant) != ret.constants.end())
+                return std::nullopt;
+            
+            discriminant = info;
+            ret.variable = &variable;
+            ret.constants.push_back(std::move(*constant));
+        }
+        
+        return ret;
+    }
+    
+    // shorter chains are as fast tested one condition after the other
+    constexpr const size_t min_dispatched_cases = 3;
+    
+    // the constant of every condition selects its branch, the else is the default
+    statement_ptr create_dispatch_statement(compiler_context& ctx, const elif_chain& chain, std::vector<expression<void>::ptr> decls, std::vector<statement_ptr> stmts)
+    {
+        const node_ptr& variable = *chain.variable;
+        const size_t dflt = stmts.size() - 1;
+        
+        if(variable->get_type_id() == type_registry::get_string_handle())
+        {
+            std::unordered_map<std::string, size_t> cases;
+            for(size_t i = 0; i < chain.constants.size(); ++i)
+                cases.emplace(std::get<std::string>(chain.constants[i]), i);
+            return create_switch_statement(std::move(decls), build_string_expression(ctx, variable), std::move(stmts), std::move(cases), dflt);
+        }
+        
+        if(variable->get_type_id() == type_registry::get_integer_handle())
+        {
+            std::unordered_map<integer, size_t> cases;
+            for(size_t i = 0; i < chain.constants.size(); ++i)
+                cases.emplace(integer(std::get<double>(chain.constants[i])), i);
+            return create_switch_statement(std::move(decls), build_integer_expression(ctx, variable), std::move(stmts), std::move(cases), dflt);
+        }
+        
+        std::unordered_map<number, size_t> cases;
+        for(size_t i = 0; i < chain.constants.size(); ++i)
+            cases.emplace(std::get<double>(chain.constants[i]), i);
+        // NaN is equal to every constant, so the first branch is the one taken
+        return create_switch_statement(std::move(decls), build_number_expression(ctx, variable), std::move(stmts), std::move(cases), dflt, 0);
+    }
+    
     statement_ptr compile_if_statement(compiler_context& ctx, tk_iterator& it, possible_flow pf)
     {
-        ctx.scope();
+        auto _ = ctx.scope();
+        const size_t line_number = it->get_line_number();
         parse_token_value(ctx, it, Tokens::statement_if);
         
         parse_token_value(ctx, it, Tokens::bracket_b);
         
-        std::vector<expression<lvalue>::ptr> decls;
+        std::vector<expression<void>::ptr> decls;
         
         if(is_typename(ctx, it))
         {
@@ -198,10 +584,12 @@ namespace Gisel
             parse_token_value(ctx, it, Tokens::semicolon);
         }
         
+        std::vector<node_ptr> conditions;
         std::vector<expression<number>::ptr> exprs;
         std::vector<statement_ptr> stmts;
         
-        exprs.emplace_back(build_number_expression(ctx, it));
+        conditions.emplace_back(parse_expression(ctx, it, type_registry::get_number_handle(), true));
+        exprs.emplace_back(build_number_expression(ctx, conditions.back()));
         parse_token_value(ctx, it, Tokens::bracket_e);
         stmts.emplace_back(compile_block_statement(ctx, it, pf));
         
@@ -209,7 +597,8 @@ namespace Gisel
         {
             ++it;
             parse_token_value(ctx, it, Tokens::bracket_b);
-            exprs.emplace_back(build_number_expression(ctx, it));
+            conditions.emplace_back(parse_expression(ctx, it, type_registry::get_number_handle(), true));
+            exprs.emplace_back(build_number_expression(ctx, conditions.back()));
             parse_token_value(ctx, it, Tokens::bracket_e);
             stmts.emplace_back(compile_block_statement(ctx, it, pf));
         }
@@ -222,16 +611,138 @@ namespace Gisel
         else
             stmts.emplace_back(create_block_statement({}));
         
+        const compiler_options& options = ctx.get_options();
+        const size_t branches = stmts.size();
+        
+        if(options.branch_counters)
+            return create_profiled_if_statement(std::move(decls), std::move(exprs), std::move(stmts), options.branch_counters->counters(line_number, branches));
+        
+        const pass_manager& passes = ctx.passes();
+        if(!passes.is_enabled(pass::dispatch) && !passes.is_enabled(pass::reorder))
+            return create_if_statement(std::move(decls), std::move(exprs), std::move(stmts));
+        
+        std::optional<elif_chain> chain = recognize_elif_chain(ctx, conditions);
+        
+        if(chain && chain->constants.size() >= min_dispatched_cases && passes.is_enabled(pass::dispatch))
+        {
+            auto timing = passes.time(pass::dispatch);
+            return create_dispatch_statement(ctx, *chain, std::move(decls), std::move(stmts));
+        }
+        
+        // the most taken branches of a profiled chain are tested first
+        const std::vector<size_t>* hits = options.branch_weights ? options.branch_weights->find(line_number, branches) : nullptr;
+        if(chain && hits && passes.is_enabled(pass::reorder))
+        {
+            auto timing = passes.time(pass::reorder);
+            std::vector<size_t> order(exprs.size());
+            std::iota(order.begin(), order.end(), 0);
+            std::stable_sort(order.begin(), order.end(), [&](size_t i, size_t j) { return (*hits)[i] > (*hits)[j]; });
+            
+            if(!std::is_sorted(order.begin(), order.end()))
+            {
+                expression<number>::ptr nan_check = (*chain->variable)->get_type_id() == type_registry::get_number_handle() ? build_number_expression(ctx, *chain->variable) : nullptr;
+                return create_reordered_if_statement(std::move(decls), std::move(exprs), std::move(stmts), std::move(order), std::move(nan_check));
+            }
+        }
+        
         return create_if_statement(std::move(decls), std::move(exprs), std::move(stmts));
     }
 
+    statement_ptr compile_switch_statement(compiler_context& ctx, tk_iterator& it, possible_flow pf)
+    {
+        parse_token_value(ctx, it, Tokens::statement_switch);
+        
+        parse_token_value(ctx, it, Tokens::bracket_b);
+        node_ptr np = parse_expression(ctx, it, type_registry::get_void_handle(), true);
+        parse_token_value(ctx, it, Tokens::bracket_e);
+        
+        const type_handle type_id = np->get_type_id();
+        if(type_id != type_registry::get_number_handle() && type_id != type_registry::get_integer_handle() && type_id != type_registry::get_string_handle())
+            wrong_type_error(std::to_string(type_id).c_str(), std::to_string(type_registry::get_number_handle()).c_str(), false, np->get_line_number()).expose();
+        
+        std::vector<constant_value> constants;
+        std::vector<size_t> labels;
+        std::optional<size_t> dflt;
+        std::vector<statement_ptr> stmts;
+        
+        parse_token_value(ctx, it, Tokens::embrace_b);
+        
+        while(!it->has_value(Tokens::embrace_e))
+        {
+            if(it->has_value(Tokens::statement_case))
+            {
+                ++it;
+                node_ptr label = parse_expression(ctx, it, type_id, false);
+                std::optional<constant_value> constant = get_case_constant(label, type_id);
+                if(!constant)
+                    semantic_error("case label must be a constant", label->get_line_number()).expose();
+                if(std::find(constants.begin(), constants.end(), *constant) != constants.end())
+                    semantic_error("duplicate case label", label->get_line_number()).expose();
+                constants.push_back(std::move(*constant));
+                labels.push_back(stmts.size());
+            }
+            else if(it->has_value(Tokens::statement_default))
+            {
+                if(dflt)
+                    semantic_error("duplicate default label", it->get_line_number()).expose();
+                ++it;
+                dflt = stmts.size();
+            }
+            else if(constants.empty() && !dflt)
+                expected_syntax_error("case", it->get_line_number()).expose();
+            // a case could jump over the declaration of a variable still in scope
+            else if(it->has_value(Tokens::kw_var))
+                semantic_error("variables declared in a switch must be in a block", it->get_line_number()).expose();
+            else
+            {
+                stmts.push_back(compile_statement(ctx, it, pf));
+                continue;
+            }
+            parse_token_value(ctx, it, Tokens::type_specifier);
+        }
+        
+        parse_token_value(ctx, it, Tokens::embrace_e);
+        
+        // without a default, a value of no case runs past the last statement
+        const size_t dflt_label = dflt.value_or(stmts.size());
+        
+        if(type_id == type_registry::get_string_handle())
+        {
+            std::unordered_map<std::string, size_t> cases;
+            for(size_t i = 0; i < constants.size(); ++i)
+                cases.emplace(std::get<std::string>(constants[i]), labels[i]);
+            return create_fallthrough_switch_statement(build_string_expression(ctx, np), std::move(stmts), std::move(cases), dflt_label);
+        }
+        
+        if(type_id == type_registry::get_integer_handle())
+        {
+            std::unordered_map<integer, size_t> cases;
+            for(size_t i = 0; i < constants.size(); ++i)
+                cases.emplace(integer(std::get<double>(constants[i])), labels[i]);
+            return create_fallthrough_switch_statement(build_integer_expression(ctx, np), std::move(stmts), std::move(cases), dflt_label);
+        }
+        
+        std::unordered_map<number, size_t> cases;
+        for(size_t i = 0; i < constants.size(); ++i)
+            cases.emplace(std::get<double>(constants[i]), labels[i]);
+        return create_fallthrough_switch_statement(build_number_expression(ctx, np), std::move(stmts), std::move(cases), dflt_label);
+    }
+
     statement_ptr compile_var_statement(compiler_context& ctx, tk_iterator& it)
     {
-        std::vector<expression<lvalue>::ptr> decls = compile_variable_declaration(ctx, it);
+        std::vector<expression<void>::ptr> decls = compile_variable_declaration(ctx, it);
         parse_token_value(ctx, it, Tokens::semicolon);
         return create_local_declaration_statement(std::move(decls));
     }
     
+    // the reads of a constant are replaced by its value, nothing is left to run
+    statement_ptr compile_const_statement(compiler_context& ctx, tk_iterator& it)
+    {
+        compile_constant_declaration(ctx, it);
+        parse_token_value(ctx, it, Tokens::semicolon);
+        return create_block_statement({});
+    }
+    
     statement_ptr compile_break_statement(compiler_context& ctx, tk_iterator& it, possible_flow pf)
     {
         if(pf.break_level == 0)
@@ -267,6 +778,9 @@ namespace Gisel
     
     statement_ptr compile_return_statement(compiler_context& ctx, tk_iterator& it, possible_flow pf)
     {
+        if(!pf.can_return)
+            syntax_error("cannot return from a parallel loop", it->get_line_number()).expose();
+        
         parse_token_value(ctx, it, Tokens::kw_return);
         
         if(pf.return_type_id == type_registry::get_void_handle())
@@ -301,7 +815,7 @@ namespace Gisel
     
     statement_ptr compile_block_statement(compiler_context& ctx, tk_iterator& it, possible_flow pf)
     {
-        ctx.scope();
+        auto _ = ctx.scope();
         std::vector<statement_ptr> block = compile_block_contents(ctx, it, pf);
         return create_block_statement(std::move(block));
     }
@@ -359,6 +873,10 @@ namespace Gisel
 				t = ctx.get_handle(simple_type::string);
 				++it;
 				break;
+			case Tokens::type_int:
+				t = ctx.get_handle(simple_type::integer);
+				++it;
+				break;
 			default: unexpected_syntax(it).expose();
 		}
 		
@@ -402,34 +920,24 @@ namespace Gisel
 		return create_shared_block_statement(std::move(block));
 	}
 
-	runtime_context compile(tk_iterator& it, const std::vector<std::pair<std::string, function>>& external_functions, std::vector<std::string> public_declarations)
+	program_declarations parse_program(compiler_context& ctx, tk_iterator& it, const std::vector<std::pair<std::string, function> >& external_functions, const std::vector<std::string>& public_declarations, const func::function<void(tk_iterator&)>& compile_global)
 	{
-		compiler_context ctx;
-		
 		for(const std::pair<std::string, function>& p : external_functions)
 		{
-			get_character get = [i = 0, &p]() mutable { return i < p.first.size() ? int(p.first[i++]) : -1; };
-			StreamStack stream(&get);
-			tk_iterator function_it(stream);
-			function_declaration decl = parse_function_declaration(ctx, function_it);
+			function_declaration decl = parse_function_declaration(ctx, p.first);
 			ctx.create_function(decl.name, decl.type_id);
 		}
+		ctx.close_external_functions();
 		
 		std::unordered_map<std::string, type_handle> public_function_types;
 		
 		for(const std::string& f : public_declarations)
 		{
-			get_character get = [i = 0, &f]() mutable { return i < f.size() ? int(f[i++]) : -1; };
-			StreamStack stream(&get);
-			tk_iterator function_it(stream);
-			function_declaration decl = parse_function_declaration(ctx, function_it);
+			function_declaration decl = parse_function_declaration(ctx, f);
 			public_function_types.emplace(decl.name, decl.type_id);
 		}
 
-		std::vector<expression<lvalue>::ptr> initializers;
-		
-		std::vector<incomplete_function> incomplete_functions;
-		std::unordered_map<std::string, size_t> public_functions;
+		program_declarations ret;
 		
 		while(it())
 		{
@@ -447,7 +955,7 @@ namespace Gisel
 				case Tokens::kw_fn:
 				{
 					size_t line_number = it->get_line_number();
-					const incomplete_function& f = incomplete_functions.emplace_back(ctx, it);
+					const incomplete_function& f = ret.functions.emplace_back(ctx, it);
 
 					if(public_function)
 					{
@@ -455,10 +963,10 @@ namespace Gisel
 					
 						if(it != public_function_types.end() && it->second != f.get_decl().type_id)
 							semantic_error(std::string("function doesn't match it's declaration " + std::to_string(it->second)).c_str(), line_number).expose();
-						else
+						else if(it != public_function_types.end())
 							public_function_types.erase(it);
 					
-						public_functions.emplace(f.get_decl().name, external_functions.size() + incomplete_functions.size() - 1);
+						ret.public_functions.emplace(f.get_decl().name, external_functions.size() + ret.functions.size() - 1);
 					}
 
 					break;
@@ -467,9 +975,12 @@ namespace Gisel
 					compile_import_statement(ctx, it);
 					parse_token_value(ctx, it, Tokens::semicolon);
 				break;
+				case Tokens::kw_const:
+					compile_constant_declaration(ctx, it);
+					parse_token_value(ctx, it, Tokens::semicolon);
+				break;
 				default:
-					for(expression<lvalue>::ptr& expr : compile_variable_declaration(ctx, it))
-						initializers.push_back(std::move(expr));
+					compile_global(it);
 					parse_token_value(ctx, it, Tokens::semicolon);
 				break;
 			}
@@ -478,16 +989,50 @@ namespace Gisel
 		if(!public_function_types.empty())
 			semantic_error(std::string("public function '" + public_function_types.begin()->first + "' is not defined.").c_str(), it->get_line_number()).expose();
 		
+		return ret;
+	}
+
+	runtime_context compile(tk_iterator& it, const std::vector<std::pair<std::string, function>>& external_functions, std::vector<std::string> public_declarations, const compiler_options& options, std::vector<std::pair<std::string, storage_stats> >* storage)
+	{
+		// with tiering, the context outlives the compilation to rebuild the hot functions with the given options
+		auto tiers = std::make_shared<tier_compiler>(options);
+		compiler_context& ctx = tiers->context();
+		
+		std::vector<expression<lvalue>::ptr> initializers;
+		
+		program_declarations program = parse_program(ctx, it, external_functions, public_declarations, [&](tk_iterator& it) { initializers.push_back(compile_global_declaration(ctx, it)); });
+		
+		// the types of the public functions let the host check its calls, before the functions are moved into their builds
+		std::unordered_map<std::string, Gisel::program::public_function> public_functions;
+		for(const auto& [name, idx] : program.public_functions)
+			public_functions.emplace(name, Gisel::program::public_function{idx, std::to_string(program.functions[idx - external_functions.size()].get_decl().type_id)});
+		
 		std::vector<function> functions;
 		
-		functions.reserve(external_functions.size() + incomplete_functions.size());
+		functions.reserve(external_functions.size() + program.functions.size());
 		
 		for(const std::pair<std::string, function>& p : external_functions)
 			functions.emplace_back(p.second);
 		
-		for(incomplete_function& f : incomplete_functions)
-			functions.emplace_back(f.compile(ctx));
+		for(incomplete_function& f : program.functions)
+		{
+			std::string name = f.get_decl().name;
+			storage_stats stats;
+			
+			if(options.tiering)
+				functions.emplace_back(compile_tiered(tiers, std::move(f), &stats));
+			else
+			{
+				functions.emplace_back(f.compile(ctx));
+				stats = f.get_storage_stats();
+			}
+			
+			if(storage)
+				storage->emplace_back(std::move(name), stats);
+		}
+		
+		ctx.check_parallel_calls();
 		
-		return runtime_context(std::move(initializers), std::move(functions), std::move(public_functions));
+		return runtime_context(std::make_shared<const Gisel::program>(std::move(initializers), std::move(functions), std::move(public_functions), options.lazy_globals), !options.deferred_globals);
 	}
 }
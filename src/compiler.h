@@ -23,6 +23,7 @@
 #include "type.h"
 #include "tokens.h"
 #include "statement.h"
+#include "incomplete_function.h"
 
 #include <vector>
 #include "function.h"
@@ -31,13 +32,27 @@ namespace Gisel
 {
 	class compiler_context;
 	class tk_iterator;
+	struct storage_stats;
+	struct compiler_options;
 	class runtime_context;
 
 	using function = func::function<void(runtime_context&)>;
 
-	runtime_context compile(tk_iterator& it, const std::vector<std::pair<std::string, function> >& external_functions, std::vector<std::string> public_declarations);
+	struct program_declarations
+	{
+		std::vector<incomplete_function> functions;
+		std::unordered_map<std::string, size_t> public_functions;
+	};
+
+	// declares the external functions and parses the top level of a program;
+	// global variable declarations are handed to compile_global as they come
+	program_declarations parse_program(compiler_context& ctx, tk_iterator& it, const std::vector<std::pair<std::string, function> >& external_functions, const std::vector<std::string>& public_declarations, const func::function<void(tk_iterator&)>& compile_global);
+	runtime_context compile(tk_iterator& it, const std::vector<std::pair<std::string, function> >& external_functions, std::vector<std::string> public_declarations, const compiler_options& options, std::vector<std::pair<std::string, storage_stats> >* storage = nullptr);
 	type_handle parse_type(compiler_context& ctx, tk_iterator& it);
 	std::string parse_declaration_name(compiler_context& ctx, tk_iterator& it);
+	std::string parse_variable_declaration(compiler_context& ctx, tk_iterator& it, type_handle& type_id, node_ptr& initializer);
+	// a constant has no storage: it must be known at compile time and its reads are replaced by its value
+	void compile_constant_declaration(compiler_context& ctx, tk_iterator& it);
 	void parse_token_value(compiler_context& ctx, tk_iterator& it, const token_value& value);
 	shared_statement_ptr compile_function_block(compiler_context& ctx, tk_iterator& it, type_handle return_type_id);
 }
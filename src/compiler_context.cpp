@@ -18,10 +18,13 @@
  */
 
 #include "compiler_context.h"
+#include "passes.h"
+#include "errors.h"
+#include <algorithm>
 
 namespace Gisel
 {
-	identifier_info::identifier_info(type_handle type_id, size_t index, identifier_scope scope) : _type_id(type_id), _index(index), _scope(scope) {}
+	identifier_info::identifier_info(type_handle type_id, size_t index, identifier_scope scope, constant_value value) : _type_id(type_id), _index(index), _scope(scope), _value(std::move(value)) {}
 
 	local_variable_lookup::local_variable_lookup(std::unique_ptr<local_variable_lookup> parent_lookup) : _parent(std::move(parent_lookup)), _next_identifier_index(_parent ? _parent->_next_identifier_index : 1) {}
 
@@ -38,11 +41,23 @@ namespace Gisel
 
 	param_lookup::param_lookup() : local_variable_lookup(nullptr), _next_param_index(-1) {}
 
-	const identifier_info* param_lookup::create_param(std::string name, type_handle type_id) { return insert_identifier(std::move(name), type_id, _next_param_index--, identifier_scope::local_variable); }
+	const identifier_info* param_lookup::create_param(std::string name, type_handle type_id, bool by_ref)
+	{
+		const identifier_info* ret = insert_identifier(std::move(name), type_id, _next_param_index--, identifier_scope::local_variable);
+		if(by_ref)
+			_references.insert(ret);
+		return ret;
+	}
 
 	const identifier_info* function_lookup::create_identifier(std::string name, type_handle type_id) { return insert_identifier(std::move(name), type_id, identifiers_size(), identifier_scope::function); }
 
-	compiler_context::compiler_context() : _params(nullptr) {}
+	compiler_context::compiler_context(compiler_options options) : _options(options), _params(nullptr), _functions_count(0), _external_functions_count(0), _compiled_function(nullptr), _back_edge_counter(nullptr), _initializer_calls(false) {}
+	
+	const pass_manager& compiler_context::passes() const
+	{
+		static const pass_manager defaults;
+		return _options.passes ? *_options.passes : defaults;
+	}
 
 	const type* compiler_context::get_handle(const type& t) { return _types.get_handle(t); }
 
@@ -65,13 +80,117 @@ namespace Gisel
 		return _globals.create_identifier(std::move(name), type_id);
 	}
 
-	const identifier_info* compiler_context::create_param(std::string name, type_handle type_id) { return _params->create_param(name, type_id); }
+	const identifier_info* compiler_context::create_param(std::string name, type_handle type_id, bool by_ref) { return _params->create_param(name, type_id, by_ref); }
+
+	bool compiler_context::is_reference_param(const identifier_info* info) const { return _params && _params->is_reference(info); }
+
+	const identifier_info* compiler_context::create_function(std::string name, type_handle type_id) { _functions_count++; return _functions.create_identifier(name, type_id); }
+
+	const identifier_info* compiler_context::create_constant(std::string name, type_handle type_id, constant_value value)
+	{
+		if(_locals)
+			return _locals->create_constant(std::move(name), type_id, std::move(value));
+		return _globals.create_constant(std::move(name), type_id, std::move(value));
+	}
+
+	void compiler_context::log_write(const std::string& name, size_t line_number, bool additive)
+	{
+		const identifier_info* info = find(name);
+		if(!info)
+			return;
+		_writes.push_back(info);
+		if(_compiled_function && info->get_scope() == identifier_scope::global_variable)
+			_effects[_compiled_function].writes_globals = true;
+		
+		for(const parallel_body& body : _parallel_bodies)
+		{
+			if(info->get_scope() == identifier_scope::local_variable && int(info->index()) >= body.first_local)
+				continue;
+			if(std::find(body.reductions.begin(), body.reductions.end(), info) == body.reductions.end())
+				semantic_error(("a parallel loop cannot write " + name + ", which is declared before its body").c_str(), line_number).expose();
+			if(!additive)
+				semantic_error(("the reduction " + name + " of a parallel loop can only be added to").c_str(), line_number).expose();
+		}
+	}
+
+	bool compiler_context::is_written_since(size_t mark, const identifier_info* info) const { return std::find(_writes.begin() + mark, _writes.end(), info) != _writes.end(); }
+
+	void compiler_context::log_call(const identifier_info* callee, const std::string& name, size_t line_number)
+	{
+		// the host functions cannot reach the globals of the script
+		if(callee && callee->get_scope() != identifier_scope::function)
+			callee = nullptr;
+		if(callee && is_external_function(callee))
+			return;
+		
+		if(_compiled_function)
+			_effects[_compiled_function].callees.push_back(callee);
+		if(!_parallel_bodies.empty())
+			_parallel_calls.push_back(parallel_call{callee, name, line_number});
+	}
+
+	bool compiler_context::may_write_globals(const identifier_info* f, std::unordered_set<const identifier_info*>& visited) const
+	{
+		if(!f)
+			return true;
+		if(!visited.insert(f).second)
+			return false;
+		
+		auto it = _effects.find(f);
+		if(it == _effects.end())
+			return false;
+		if(it->second.writes_globals)
+			return true;
+		return std::any_of(it->second.callees.begin(), it->second.callees.end(), [&](const identifier_info* callee) { return may_write_globals(callee, visited); });
+	}
+
+	void compiler_context::check_parallel_calls()
+	{
+		for(const parallel_call& call : _parallel_calls)
+		{
+			std::unordered_set<const identifier_info*> visited;
+			if(!call.callee)
+				semantic_error("a parallel loop can only call functions by their name, a function value may write globals", call.line_number).expose();
+			if(may_write_globals(call.callee, visited))
+				semantic_error(("a parallel loop cannot call " + call.name + ", which writes globals").c_str(), call.line_number).expose();
+		}
+		_parallel_calls.clear();
+	}
+
+	const value_range* compiler_context::find_range(const identifier_info* info) const
+	{
+		if(auto it = _ranges.find(info); it != _ranges.end())
+			return &it->second;
+		return nullptr;
+	}
 
-	const identifier_info* compiler_context::create_function(std::string name, type_handle type_id) { return _functions.create_identifier(name, type_id); }
+	void compiler_context::log_local_storage(const std::string& name, size_t line_number, bool boxed) { _local_storage.insert_or_assign(std::make_pair(line_number, name), boxed); }
+
+	storage_stats compiler_context::get_storage_stats() const
+	{
+		storage_stats ret;
+		for(const auto& p : _local_storage)
+			++(p.second ? ret.boxed : ret.unboxed);
+		return ret;
+	}
+
+	bool compiler_context::is_external_function(const identifier_info* info) const noexcept { return info->get_scope() == identifier_scope::function && info->index() < _external_functions_count; }
 
 	void compiler_context::enter_scope() { _locals = std::make_unique<local_variable_lookup>(std::move(_locals)); }
 
-	void compiler_context::enter_function() { std::unique_ptr<param_lookup> params = std::make_unique<param_lookup>(); _params = params.get(); _locals = std::move(params); }
+	void compiler_context::enter_function(const identifier_info* compiled)
+	{
+		_compiled_function = compiled;
+		if(compiled)
+			_effects[compiled] = function_effects();
+		_writes.clear();
+		_ranges.clear();
+		_referenced_names.clear();
+		_local_storage.clear();
+		std::unique_ptr<param_lookup> params = std::make_unique<param_lookup>();
+		_params = params.get();
+		_locals = std::move(params);
+	}
 
 	void compiler_context::leave_scope()
 	{
@@ -85,13 +204,23 @@ namespace Gisel
 
 	compiler_context::scope_raii compiler_context::scope() { return scope_raii(*this); }
 
-	compiler_context::function_raii compiler_context::function() { return function_raii(*this); }
+	compiler_context::function_raii compiler_context::function(const identifier_info* compiled) { return function_raii(*this, compiled); }
+
+	compiler_context::parallel_raii compiler_context::parallel(int first_local, std::vector<const identifier_info*> reductions)
+	{
+		_parallel_bodies.push_back(parallel_body{first_local, std::move(reductions)});
+		return parallel_raii(*this);
+	}
 
 	compiler_context::scope_raii::scope_raii(compiler_context& context) : _context(context) { _context.enter_scope(); }
 
 	compiler_context::scope_raii::~scope_raii() { _context.leave_scope(); }
 
-	compiler_context::function_raii::function_raii(compiler_context& context) : _context(context) { _context.enter_function(); }
+	compiler_context::function_raii::function_raii(compiler_context& context, const identifier_info* compiled) : _context(context) { _context.enter_function(compiled); }
+
+	compiler_context::function_raii::~function_raii() { _context._compiled_function = nullptr; _context.leave_scope(); }
+
+	compiler_context::parallel_raii::parallel_raii(compiler_context& context) : _context(context) {}
 
-	compiler_context::function_raii::~function_raii() { _context.leave_scope(); }
+	compiler_context::parallel_raii::~parallel_raii() { _context._parallel_bodies.pop_back(); }
 }
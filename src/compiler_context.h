@@ -21,10 +21,17 @@
 #define __COMPILER_CONTEXT__
 
 #include <unordered_map>
+#include <unordered_set>
+#include <atomic>
+#include <cstdint>
+#include <map>
 #include <memory>
 #include <string>
+#include <variant>
+#include <vector>
 
 #include "type.h"
+#include "range_analysis.h"
 
 namespace Gisel
 {
@@ -33,21 +40,51 @@ namespace Gisel
 		global_variable,
 		local_variable,
 		function,
+		constant,
+	};
+
+	using constant_value = std::variant<double, std::string>;
+
+	// how many locals of a function live in boxes of their own and how many reuse their stack slot
+	struct storage_stats
+	{
+		size_t boxed = 0;
+		size_t unboxed = 0;
+	};
+
+	class branch_profile;
+	class pass_manager;
+
+	struct compiler_options
+	{
+		bool jit = false; // compile numeric functions to machine code when possible
+		const pass_manager* passes = nullptr; // the optimizations to run and time, all of -O2 when null
+		bool unchecked = false; // drop the run-time checks the compiler proves redundant
+		bool lazy_globals = false; // initialize every global on its first access
+		bool deferred_globals = false; // leave the globals of the context to be initialized or restored by its user
+		bool tiering = false; // build functions cheaply and rebuild them with every optimization once hot
+		size_t hot_calls = 1000;
+		size_t hot_back_edges = 100000;
+		branch_profile* branch_counters = nullptr; // if statements count the branches they take there
+		const branch_profile* branch_weights = nullptr; // elif chains test the most taken branches first
+		std::uint64_t* evaluated_nodes = nullptr; // flattened expressions count the nodes they evaluate there
 	};
 
 	class identifier_info
 	{
 		public:
-			identifier_info(type_handle type_id, size_t index, identifier_scope scope);
+			identifier_info(type_handle type_id, size_t index, identifier_scope scope, constant_value value = 0.0);
 			
 			inline type_handle type_id() const noexcept { return _type_id; }
 			inline size_t index() const noexcept { return _index; }
 			inline identifier_scope get_scope() const { return _scope; }
+			inline const constant_value& get_constant() const noexcept { return _value; }
 			
 		private:
 			type_handle _type_id;
 			size_t _index;
 			identifier_scope _scope;
+			constant_value _value;
 	};
 
 	class identifier_lookup
@@ -60,6 +97,7 @@ namespace Gisel
 				return nullptr;
 			}
 			virtual const identifier_info* create_identifier(std::string name, type_handle type_id) = 0;
+			inline const identifier_info* create_constant(std::string name, type_handle type_id, constant_value value) { return &_identifiers.emplace(std::move(name), identifier_info(type_id, 0, identifier_scope::constant, std::move(value))).first->second; }
 			inline bool can_declare(const std::string& name) const { return _identifiers.find(name) == _identifiers.end(); }
 
 			virtual ~identifier_lookup() = default;
@@ -85,6 +123,7 @@ namespace Gisel
 			const identifier_info* find(const std::string& name) const override;
 			const identifier_info* create_identifier(std::string name, type_handle type_id) override;
 			std::unique_ptr<local_variable_lookup> detach_parent();
+			inline int next_index() const noexcept { return _next_identifier_index; }
 
 		private:
 			std::unique_ptr<local_variable_lookup> _parent;
@@ -95,10 +134,12 @@ namespace Gisel
 	{
 		public:
 			param_lookup();
-			const identifier_info* create_param(std::string name, type_handle type_id);
+			const identifier_info* create_param(std::string name, type_handle type_id, bool by_ref);
+			inline bool is_reference(const identifier_info* info) const { return _references.count(info) != 0; }
 
 		private:
 			int _next_param_index;
+			std::unordered_set<const identifier_info*> _references;
 	};
 
 	class function_lookup: public identifier_lookup
@@ -121,32 +162,116 @@ namespace Gisel
 		class function_raii
 		{
 			public:
-				function_raii(compiler_context& context);
+				function_raii(compiler_context& context, const identifier_info* compiled);
 				~function_raii();
 			private:
 				compiler_context& _context;
 		};
 		
+		class parallel_raii
+		{
+			public:
+				parallel_raii(compiler_context& context);
+				~parallel_raii();
+			private:
+				compiler_context& _context;
+		};
+		
+		// the body of a parallel loop writes none of the variables declared before its first local,
+		// but its reductions, which it can only add to or subtract from
+		struct parallel_body
+		{
+			int first_local;
+			std::vector<const identifier_info*> reductions;
+		};
+		
+		// the globals a function writes are copies of its own in the contexts a parallel loop forks, lost once it is over
+		struct function_effects
+		{
+			bool writes_globals = false;
+			std::vector<const identifier_info*> callees; // null for the calls of function values
+		};
+		
+		struct parallel_call
+		{
+			const identifier_info* callee; // null for a function value
+			std::string name;
+			size_t line_number;
+		};
+		
 		public:
-			compiler_context();
+			compiler_context(compiler_options options = compiler_options());
+			inline const compiler_options& get_options() const noexcept { return _options; }
+			inline void set_options(const compiler_options& options) noexcept { _options = options; }
+			const pass_manager& passes() const;
 			type_handle get_handle(const type& t);
 			const identifier_info* find(const std::string& name) const;
 			const identifier_info* create_identifier(std::string name, type_handle type_id);
-			const identifier_info* create_param(std::string name, type_handle type_id);
+			const identifier_info* create_param(std::string name, type_handle type_id, bool by_ref = false);
+			// a parameter passed by reference is the variable of a caller, which the callees may write too
+			bool is_reference_param(const identifier_info* info) const;
 			const identifier_info* create_function(std::string name, type_handle type_id);
+			const identifier_info* create_constant(std::string name, type_handle type_id, constant_value value);
 			bool can_declare(const std::string& name) const;
+			inline void close_external_functions() noexcept { _external_functions_count = _functions_count; }
+			bool is_external_function(const identifier_info* info) const noexcept;
+
+			// every variable that may be modified is logged as its expression is parsed, additive
+			// writes being those of +=, -=, ++ and --
+			void log_write(const std::string& name, size_t line_number, bool additive);
+			inline size_t writes_mark() const noexcept { return _writes.size(); }
+			bool is_written_since(size_t mark, const identifier_info* info) const;
+			// every call is logged too, callee being null when a function value is called
+			void log_call(const identifier_info* callee, const std::string& name, size_t line_number);
+			// once every function is compiled, rejects the calls of parallel loops to functions that may write globals
+			void check_parallel_calls();
+
+			// known ranges of variables, such as the counters of counted loops
+			inline void set_range(const identifier_info* info, value_range range) { _ranges.insert_or_assign(info, range); }
+			inline void clear_range(const identifier_info* info) { _ranges.erase(info); }
+			const value_range* find_range(const identifier_info* info) const;
+
+			// locals passed by reference somewhere in the function being compiled must be boxed
+			inline void set_referenced_names(std::unordered_set<std::string> names) { _referenced_names = std::move(names); }
+			inline bool is_referenced(const std::string& name) const { return _referenced_names.count(name) != 0; }
+			void log_local_storage(const std::string& name, size_t line_number, bool boxed);
+			storage_stats get_storage_stats() const;
+			// with unchecked options, the globals are known to be initialized where they are read: an initializer
+			// can only name the globals before it, and functions run once every initializer has, unless one calls them
+			inline void log_initializer_call() noexcept { _initializer_calls = true; }
+			inline bool are_globals_initialized() const noexcept { return _options.unchecked && !_options.lazy_globals && (!_locals || !_initializer_calls); }
+			// the loops of a function being profiled count their iterations there
+			inline void set_back_edge_counter(std::atomic<size_t>* counter) noexcept { _back_edge_counter = counter; }
+			inline std::atomic<size_t>* get_back_edge_counter() const noexcept { return _back_edge_counter; }
 			scope_raii scope();
-			function_raii function();
+			// the effects of the function compiled, when given, are logged for check_parallel_calls
+			function_raii function(const identifier_info* compiled = nullptr);
+			// the index of the next local declared in the current scope
+			inline int next_local_index() const noexcept { return _locals->next_index(); }
+			parallel_raii parallel(int first_local, std::vector<const identifier_info*> reductions);
 
 		private:
+			compiler_options _options;
 			function_lookup _functions;
 			global_variable_lookup _globals;
 			param_lookup* _params;
 			std::unique_ptr<local_variable_lookup> _locals;
 			type_registry _types;
+			size_t _functions_count;
+			size_t _external_functions_count;
+			std::vector<const identifier_info*> _writes;
+			std::vector<parallel_body> _parallel_bodies; // the enclosing parallel loops
+			const identifier_info* _compiled_function;
+			std::unordered_map<const identifier_info*, function_effects> _effects;
+			std::vector<parallel_call> _parallel_calls;
+			std::unordered_map<const identifier_info*, value_range> _ranges;
+			std::unordered_set<std::string> _referenced_names;
+			std::map<std::pair<size_t, std::string>, bool> _local_storage; // unrolled loops compile the same declaration more than once
+			std::atomic<size_t>* _back_edge_counter;
+			bool _initializer_calls;
 			
-			
-			void enter_function();
+			void enter_function(const identifier_info* compiled);
+			bool may_write_globals(const identifier_info* f, std::unordered_set<const identifier_info*>& visited) const;
 			void enter_scope();
 			void leave_scope();
 	};
@@ -0,0 +1,615 @@
+/**
+ * This file is a part of the Gisel Interpreter
+ *
+ * Copyright (C) 2022 @kbz_8
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "cpp_emitter.h"
+#include "compiler.h"
+#include "compiler_context.h"
+#include "expression.h"
+#include "expression_tree.h"
+#include "incomplete_function.h"
+#include "tk_iterator.h"
+#include "errors.h"
+#include <cstdio>
+#include <sstream>
+#include <unordered_map>
+
+namespace Gisel
+{
+	namespace
+	{
+		inline bool is_integer(const node_ptr& np) { return np->get_type_id() == type_registry::get_integer_handle(); }
+		inline bool is_numeric(const node_ptr& np) { return np->get_type_id() == type_registry::get_number_handle() || is_integer(np); }
+		inline bool are_integer_operands(const node_ptr& np1, const node_ptr& np2) { return (is_integer(np1) || is_integral_literal(*np1)) && (is_integer(np2) || is_integral_literal(*np2)) && (is_integer(np1) || is_integer(np2)); }
+
+		inline bool is_operation(const node_ptr& np, node_operation op) { return np->is_node_operation() && np->get_node_operation() == op; }
+
+		[[noreturn]] void unsupported(const char* what, size_t line)
+		{
+			compiler_error((std::string(what) + " cannot be translated to C++").c_str(), line).expose();
+			std::exit(EXIT_FAILURE);
+		}
+
+		std::string quote(std::string_view s)
+		{
+			std::string ret = "\"";
+			for(char c : s)
+			{
+				switch(c)
+				{
+					case '"': ret += "\\\""; break;
+					case '\\': ret += "\\\\"; break;
+					case '\n': ret += "\\n"; break;
+					case '\t': ret += "\\t"; break;
+					default:
+						if(c >= ' ' && c <= '~')
+							ret += c;
+						else
+						{
+							char buffer[8];
+							std::snprintf(buffer, sizeof(buffer), "\\%03o", unsigned(static_cast<unsigned char>(c)));
+							ret += buffer;
+						}
+				}
+			}
+			return ret + "\"";
+		}
+
+		class cpp_emitter
+		{
+			struct loop
+			{
+				size_t id;
+				bool broken_from_inside;
+			};
+
+			public:
+				cpp_emitter(compiler_context& ctx, const std::vector<std::pair<std::string, function> >& external_functions) : _ctx(ctx), _external_functions(external_functions), _external_slots(external_functions.size(), -1), _indentation(1), _labels(0) {}
+
+				void compile_global(tk_iterator& it)
+				{
+					type_handle type_id = nullptr;
+					node_ptr initializer;
+					size_t line_number = it->get_line_number();
+					std::string name = parse_variable_declaration(_ctx, it, type_id, initializer);
+
+					std::string cpp_name = "g_" + name;
+					_globals << "\tstatic " << type_name(type_id, line_number) << " " << cpp_name << ";\n";
+					_initialize << "\t\t" << cpp_name << " = " << (initializer ? expression(initializer, type_id) : type_name(type_id, line_number) + "()") << ";\n";
+
+					_names.insert_or_assign(_ctx.create_identifier(std::move(name), type_id), std::move(cpp_name));
+				}
+
+				void compile_function(const incomplete_function& f, size_t idx)
+				{
+					const function_declaration& decl = f.get_decl();
+					const function_type* ft = std::get_if<function_type>(decl.type_id);
+					size_t line_number = f.get_tokens().empty() ? 0 : f.get_tokens().front().get_line_number();
+
+					auto _ = _ctx.function();
+
+					std::ostringstream signature;
+					signature << "\tstatic " << type_name(ft->return_type_id, line_number) << " f" << idx << "(Gisel::runtime_context& ctx";
+					for(size_t i = 0; i < decl.params.size(); ++i)
+					{
+						const identifier_info* info = _ctx.create_param(decl.params[i], ft->param_type_id[i].type_id, ft->param_type_id[i].by_ref);
+						std::string cpp_name = "p" + std::to_string(i);
+						signature << ", " << type_name(ft->param_type_id[i].type_id, line_number) << (ft->param_type_id[i].by_ref ? "& " : " ") << cpp_name;
+						_names.insert_or_assign(info, std::move(cpp_name));
+					}
+					signature << ")";
+
+					_prototypes << signature.str() << ";\n";
+					_functions << signature.str() << "\n";
+
+					_return_type_id = ft->return_type_id;
+					std::deque<Token> tokens = f.get_tokens();
+					tk_iterator it(tokens);
+
+					// falling off the end of the function returns a default value, like the interpreter does
+					compile_block_statement(it, ft->return_type_id == type_registry::get_void_handle() ? std::string() : "return " + type_name(ft->return_type_id, line_number) + "();\n");
+					_functions << "\n";
+				}
+
+				void compile_public_function(const std::string& name, const incomplete_function& f, size_t idx)
+				{
+					const function_type* ft = std::get_if<function_type>(f.get_decl().type_id);
+					std::ostringstream call;
+					call << "f" << idx << "(ctx";
+					for(size_t i = 0; i < ft->param_type_id.size(); ++i)
+						call << ", Gisel::native::param<" << type_name(ft->param_type_id[i].type_id, 0) << ">(ctx, " << i << ")";
+					call << ")";
+
+					_functions << "\tvoid e" << idx << "(Gisel::runtime_context& ctx)\n\t{\n\t\t";
+					if(ft->return_type_id == type_registry::get_void_handle())
+						_functions << call.str() << ";\n";
+					else
+						_functions << "Gisel::native::set_retval(ctx, " << call.str() << ");\n";
+					_functions << "\t}\n\n";
+
+					_publics.push_back("{" + quote(name) + ", " + quote(std::to_string(f.get_decl().type_id)) + ", &e" + std::to_string(idx) + "}");
+				}
+
+				void write(std::ostream& out) const
+				{
+					out << "// generated by giseli --emit-cpp, build it with\n";
+					out << "// c++ -std=c++17 -O2 -shared -fPIC -I<gisel>/src <file>.cpp -o <file>.so\n\n";
+					out << "#include <gisel_native.h>\n\n";
+					out << "namespace\n{\n";
+					out << _strings.str() << (_strings.str().empty() ? "" : "\n");
+					out << _globals.str() << (_globals.str().empty() ? "" : "\n");
+					out << _prototypes.str() << "\n";
+					out << _functions.str();
+					out << "\tvoid initialize(Gisel::runtime_context& ctx)\n\t{\n" << _initialize.str() << "\t}\n\n";
+
+					write_table(out, "externals", _externals);
+					write_table(out, "publics", _publics);
+
+					out << "\tconst Gisel::native::module_info module = {Gisel::native::abi_version, ";
+					out << (_externals.empty() ? "nullptr" : "externals") << ", " << _externals.size() << ", ";
+					out << (_publics.empty() ? "nullptr" : "publics") << ", " << _publics.size() << ", &initialize};\n";
+					out << "}\n\n";
+					out << "extern \"C\" const Gisel::native::module_info* gisel_native_module(const Gisel::native::host_interface* host)\n{\n";
+					out << "\tGisel::native::host = host;\n\treturn &module;\n}\n";
+				}
+
+			private:
+				compiler_context& _ctx;
+				const std::vector<std::pair<std::string, function> >& _external_functions;
+				std::vector<int> _external_slots;
+				std::unordered_map<const identifier_info*, std::string> _names;
+				std::unordered_map<std::string, std::string> _string_constants;
+				std::vector<std::string> _externals;
+				std::vector<std::string> _publics;
+				std::ostringstream _strings;
+				std::ostringstream _globals;
+				std::ostringstream _prototypes;
+				std::ostringstream _functions;
+				std::ostringstream _initialize;
+				type_handle _return_type_id;
+				size_t _indentation;
+				size_t _labels;
+				std::vector<loop> _loops;
+
+				static void write_table(std::ostream& out, const char* name, const std::vector<std::string>& entries)
+				{
+					if(entries.empty())
+						return;
+					out << "\tconst Gisel::native::function_info " << name << "[] =\n\t{\n";
+					for(const std::string& entry : entries)
+						out << "\t\t" << entry << ",\n";
+					out << "\t};\n\n";
+				}
+
+				std::string type_name(type_handle type_id, size_t line_number) const
+				{
+					if(type_id == type_registry::get_void_handle())
+						return "void";
+					if(type_id == type_registry::get_number_handle())
+						return "Gisel::number";
+					if(type_id == type_registry::get_integer_handle())
+						return "Gisel::integer";
+					if(type_id == type_registry::get_string_handle())
+						return "Gisel::string";
+					unsupported("function value", line_number);
+				}
+
+				const std::string& name_of(const node_ptr& np)
+				{
+					const identifier_info* info = _ctx.find(std::string(np->get_identifier()));
+					if(info->get_scope() == identifier_scope::function)
+						unsupported("function value", np->get_line_number());
+					return _names.at(info);
+				}
+
+				// expressions
+
+				std::string expression(const node_ptr& np, type_handle type_id)
+				{
+					if(type_id == type_registry::get_void_handle())
+						return "(void)(" + value(np) + ")";
+					if(np->get_type_id() == type_id)
+						return value(np);
+					if(type_id == type_registry::get_integer_handle() && is_integral_literal(*np))
+						return "Gisel::integer(" + value(np) + ")";
+					if(type_id == type_registry::get_number_handle() && is_integer(np))
+						return "Gisel::number(" + value(np) + ")";
+					// the interpreter turns numbers into empty strings
+					if(type_id == type_registry::get_string_handle())
+						return "((void)(" + value(np) + "), Gisel::string())";
+					unsupported("conversion", np->get_line_number());
+				}
+
+				std::string string_constant(std::string_view s)
+				{
+					auto it = _string_constants.find(std::string(s));
+					if(it != _string_constants.end())
+						return it->second;
+
+					std::string name = "s" + std::to_string(_string_constants.size());
+					_strings << "\tconst Gisel::string " << name << " = std::make_shared<std::string>(" << quote(s) << ");\n";
+					return _string_constants.emplace(std::string(s), name).first->second;
+				}
+
+				std::string value(const node_ptr& np)
+				{
+					if(np->is_number())
+					{
+						char buffer[64];
+						std::snprintf(buffer, sizeof(buffer), "%a", np->get_number());
+						return buffer;
+					}
+					if(np->is_string())
+						return string_constant(np->get_string());
+					if(np->is_identifier())
+						return name_of(np);
+
+					const std::vector<node_ptr>& children = np->get_children();
+					type_handle type_id = np->get_type_id();
+
+					auto unary = [&](const char* f) { return std::string(f) + "(" + value(children[0]) + ")"; };
+					auto binary = [&](const char* f, type_handle operands) { return std::string(f) + "(" + expression(children[0], operands) + ", " + expression(children[1], operands) + ")"; };
+					auto assignment = [&](const char* f) { return std::string(f) + "(" + value(children[0]) + ", " + expression(children[1], type_id) + ")"; };
+					auto comparison = [&](const char* f)
+					{
+						if(are_integer_operands(children[0], children[1]))
+							return binary(f, type_registry::get_integer_handle());
+						if(is_numeric(children[0]) && is_numeric(children[1]))
+							return binary(f, type_registry::get_number_handle());
+						return binary(f, type_registry::get_string_handle());
+					};
+
+					switch(np->get_node_operation())
+					{
+						case node_operation::preinc:     return unary("Gisel::native::preinc");
+						case node_operation::predec:     return unary("Gisel::native::predec");
+						case node_operation::postinc:    return unary("Gisel::native::postinc");
+						case node_operation::postdec:    return unary("Gisel::native::postdec");
+						case node_operation::positive:   return expression(children[0], type_id);
+						case node_operation::negative:   return "Gisel::neg(" + expression(children[0], type_id) + ")";
+						case node_operation::bnot:       return "(~" + expression(children[0], type_id) + ")";
+						case node_operation::lnot:       return "Gisel::number(!" + expression(children[0], type_id) + ")";
+						case node_operation::to_integer:
+							if(is_integer(children[0]))
+								return value(children[0]);
+							return "Gisel::to_integer(" + expression(children[0], type_registry::get_number_handle()) + ")";
+						case node_operation::to_number:  return "Gisel::number(" + value(children[0]) + ")";
+						case node_operation::add:        return binary("Gisel::add", type_id);
+						case node_operation::sub:        return binary("Gisel::sub", type_id);
+						case node_operation::mul:        return binary("Gisel::mul", type_id);
+						case node_operation::div:        return binary("Gisel::div", type_id);
+						case node_operation::mod:        return binary("Gisel::mod", type_id);
+						case node_operation::band:       return "(" + expression(children[0], type_id) + " & " + expression(children[1], type_id) + ")";
+						case node_operation::bor:        return "(" + expression(children[0], type_id) + " | " + expression(children[1], type_id) + ")";
+						case node_operation::bxor:       return "(" + expression(children[0], type_id) + " ^ " + expression(children[1], type_id) + ")";
+						case node_operation::shl:        return binary("Gisel::native::shl", type_id);
+						case node_operation::shr:        return binary("Gisel::native::shr", type_id);
+						case node_operation::eq:         return comparison("Gisel::native::eq");
+						case node_operation::ne:         return comparison("Gisel::native::ne");
+						case node_operation::lt:         return comparison("Gisel::lt");
+						case node_operation::gt:         return comparison("Gisel::native::gt");
+						case node_operation::le:         return comparison("Gisel::native::le");
+						case node_operation::ge:         return comparison("Gisel::native::ge");
+						case node_operation::assign:     return "(" + value(children[0]) + " = " + expression(children[1], type_id) + ")";
+						case node_operation::add_assign: return assignment("Gisel::native::add_assign");
+						case node_operation::sub_assign: return assignment("Gisel::native::sub_assign");
+						case node_operation::mul_assign: return assignment("Gisel::native::mul_assign");
+						case node_operation::div_assign: return assignment("Gisel::native::div_assign");
+						case node_operation::mod_assign: return assignment("Gisel::native::mod_assign");
+						case node_operation::land:       return "Gisel::number(" + expression(children[0], type_id) + " && " + expression(children[1], type_id) + ")";
+						case node_operation::lor:        return "Gisel::number(" + expression(children[0], type_id) + " || " + expression(children[1], type_id) + ")";
+						case node_operation::comma:
+						{
+							std::string ret = "(";
+							for(size_t i = 0; i + 1 < children.size(); ++i)
+								ret += expression(children[i], type_registry::get_void_handle()) + ", ";
+							return ret + value(children.back()) + ")";
+						}
+						case node_operation::ternary:
+							return "(" + expression(children[0], type_registry::get_number_handle()) + " ? " + expression(children[1], type_id) + " : " + expression(children[2], type_id) + ")";
+						case node_operation::call: return call(np);
+						default: unsupported("expression", np->get_line_number());
+					}
+				}
+
+				// only direct calls, functions are not values in the emitted code
+				std::string call(const node_ptr& np)
+				{
+					const std::vector<node_ptr>& children = np->get_children();
+					const identifier_info* info = children[0]->is_identifier() ? _ctx.find(std::string(children[0]->get_identifier())) : nullptr;
+					if(!info || info->get_scope() != identifier_scope::function)
+						unsupported("call of a function value", np->get_line_number());
+
+					const function_type* ft = std::get_if<function_type>(children[0]->get_type_id());
+
+					std::string args;
+					for(size_t i = 1; i < children.size(); ++i)
+					{
+						// arguments passed by value are wrapped in param nodes
+						const node_ptr& argument = children[i];
+						args += ", ";
+						if(is_operation(argument, node_operation::param))
+							args += expression(argument->get_children()[0], ft->param_type_id[i - 1].type_id);
+						else
+							args += value(argument);
+					}
+
+					if(info->index() < _external_functions.size())
+					{
+						for(const function_type::param& p : ft->param_type_id)
+							if(p.by_ref)
+								unsupported("reference passed to an external function", np->get_line_number());
+						return "Gisel::native::call<" + type_name(ft->return_type_id, np->get_line_number()) + ">(ctx, " + std::to_string(external_slot(info->index())) + args + ")";
+					}
+
+					return "f" + std::to_string(info->index()) + "(ctx" + args + ")";
+				}
+
+				int external_slot(size_t idx)
+				{
+					if(_external_slots[idx] < 0)
+					{
+						// parsing a declaration opens a function scope, which must not be the one being emitted
+						compiler_context ctx;
+						function_declaration decl = parse_function_declaration(ctx, _external_functions[idx].first);
+						_external_slots[idx] = int(_externals.size());
+						_externals.push_back("{" + quote(decl.name) + ", " + quote(std::to_string(decl.type_id)) + ", nullptr}");
+					}
+					return _external_slots[idx];
+				}
+
+				// statements
+
+				inline std::ostream& line() { return _functions << std::string(_indentation, '\t'); }
+
+				void compile_statement(tk_iterator& it)
+				{
+					if(it->is_keyword())
+					{
+						switch(it->get_token())
+						{
+							case Tokens::kw_var:       return compile_var_statement(it);
+							case Tokens::kw_const:     return compile_const_statement(it);
+							case Tokens::kw_for:       return compile_for_statement(it);
+							case Tokens::kw_parallel:  unsupported("parallel loop", it->get_line_number());
+							case Tokens::kw_while:     return compile_while_statement(it);
+							case Tokens::kw_do:        return compile_do_statement(it);
+							case Tokens::statement_if: return compile_if_statement(it);
+							case Tokens::statement_switch: unsupported("switch statement", it->get_line_number());
+							case Tokens::kw_break:     return compile_break_statement(it);
+							case Tokens::kw_continue:  return compile_continue_statement(it);
+							case Tokens::kw_return:    return compile_return_statement(it);
+
+							default: break;
+						}
+					}
+					if(it->has_value(Tokens::embrace_b))
+						return compile_block_statement(it);
+
+					if(node_ptr np = parse_expression(_ctx, it, type_registry::get_void_handle(), true))
+						line() << value(np) << ";\n";
+					parse_token_value(_ctx, it, Tokens::semicolon);
+				}
+
+				void compile_block_statement(tk_iterator& it, const std::string& epilogue = std::string())
+				{
+					auto _ = _ctx.scope();
+
+					line() << "{\n";
+					++_indentation;
+
+					if(it->has_value(Tokens::embrace_b))
+					{
+						parse_token_value(_ctx, it, Tokens::embrace_b);
+
+						while(!it->has_value(Tokens::embrace_e))
+							compile_statement(it);
+
+						parse_token_value(_ctx, it, Tokens::embrace_e);
+					}
+					else
+						compile_statement(it);
+
+					if(!epilogue.empty())
+						line() << epilogue;
+
+					--_indentation;
+					line() << "}\n";
+				}
+
+				std::string compile_variable_declaration(tk_iterator& it)
+				{
+					type_handle type_id = nullptr;
+					node_ptr initializer;
+					size_t line_number = it->get_line_number();
+					std::string name = parse_variable_declaration(_ctx, it, type_id, initializer);
+
+					// the initializer is emitted before the variable is declared, so it sees the outer variables
+					std::string cpp_name = "v_" + name + "_" + std::to_string(_labels++);
+					std::string ret = type_name(type_id, line_number) + " " + cpp_name + (initializer ? " = " + expression(initializer, type_id) : "{}");
+
+					_names.insert_or_assign(_ctx.create_identifier(std::move(name), type_id), std::move(cpp_name));
+					return ret;
+				}
+
+				void compile_var_statement(tk_iterator& it)
+				{
+					line() << compile_variable_declaration(it) << ";\n";
+					parse_token_value(_ctx, it, Tokens::semicolon);
+				}
+
+				void compile_const_statement(tk_iterator& it)
+				{
+					compile_constant_declaration(_ctx, it);
+					parse_token_value(_ctx, it, Tokens::semicolon);
+				}
+
+				std::string condition(tk_iterator& it)
+				{
+					parse_token_value(_ctx, it, Tokens::bracket_b);
+					std::string ret = expression(parse_expression(_ctx, it, type_registry::get_number_handle(), true), type_registry::get_number_handle());
+					parse_token_value(_ctx, it, Tokens::bracket_e);
+					return ret;
+				}
+
+				void compile_loop_body(tk_iterator& it)
+				{
+					_loops.push_back(loop{_labels++, false});
+					compile_block_statement(it);
+				}
+
+				// break N jumps right after the loop it leaves
+				void close_loop()
+				{
+					if(_loops.back().broken_from_inside)
+						line() << "break_" << _loops.back().id << ":;\n";
+					_loops.pop_back();
+				}
+
+				void compile_for_statement(tk_iterator& it)
+				{
+					auto _ = _ctx.scope();
+
+					parse_token_value(_ctx, it, Tokens::kw_for);
+					parse_token_value(_ctx, it, Tokens::bracket_b);
+
+					std::string init;
+					if(it->has_value(Tokens::kw_var))
+						init = compile_variable_declaration(it);
+					else if(node_ptr np = parse_expression(_ctx, it, type_registry::get_void_handle(), true))
+						init = value(np);
+
+					parse_token_value(_ctx, it, Tokens::semicolon);
+
+					std::string cond;
+					if(node_ptr np = parse_expression(_ctx, it, type_registry::get_number_handle(), true))
+						cond = expression(np, type_registry::get_number_handle());
+
+					parse_token_value(_ctx, it, Tokens::semicolon);
+
+					std::string step;
+					if(node_ptr np = parse_expression(_ctx, it, type_registry::get_void_handle(), true))
+						step = value(np);
+
+					parse_token_value(_ctx, it, Tokens::bracket_e);
+
+					line() << "for(" << init << "; " << cond << "; " << step << ")\n";
+					compile_loop_body(it);
+					close_loop();
+				}
+
+				void compile_while_statement(tk_iterator& it)
+				{
+					parse_token_value(_ctx, it, Tokens::kw_while);
+					line() << "while(" << condition(it) << ")\n";
+					compile_loop_body(it);
+					close_loop();
+				}
+
+				void compile_do_statement(tk_iterator& it)
+				{
+					parse_token_value(_ctx, it, Tokens::kw_do);
+					line() << "do\n";
+					compile_loop_body(it);
+					parse_token_value(_ctx, it, Tokens::kw_while);
+					line() << "while(" << condition(it) << ");\n";
+					close_loop();
+				}
+
+				void compile_if_statement(tk_iterator& it)
+				{
+					auto _ = _ctx.scope();
+
+					parse_token_value(_ctx, it, Tokens::statement_if);
+					line() << "if(" << condition(it) << ")\n";
+					compile_block_statement(it);
+
+					while(it->has_value(Tokens::statement_elif))
+					{
+						++it;
+						line() << "else if(" << condition(it) << ")\n";
+						compile_block_statement(it);
+					}
+
+					if(it->has_value(Tokens::statement_else))
+					{
+						++it;
+						line() << "else\n";
+						compile_block_statement(it);
+					}
+				}
+
+				void compile_break_statement(tk_iterator& it)
+				{
+					parse_token_value(_ctx, it, Tokens::kw_break);
+
+					size_t break_level = 1;
+					if(it->is_number())
+					{
+						break_level = size_t(it->get_number());
+						++it;
+					}
+					parse_token_value(_ctx, it, Tokens::semicolon);
+
+					if(break_level == 1)
+					{
+						line() << "break;\n";
+						return;
+					}
+
+					loop& target = _loops[_loops.size() - break_level];
+					target.broken_from_inside = true;
+					line() << "goto break_" << target.id << ";\n";
+				}
+
+				void compile_continue_statement(tk_iterator& it)
+				{
+					parse_token_value(_ctx, it, Tokens::kw_continue);
+					parse_token_value(_ctx, it, Tokens::semicolon);
+					line() << "continue;\n";
+				}
+
+				void compile_return_statement(tk_iterator& it)
+				{
+					parse_token_value(_ctx, it, Tokens::kw_return);
+
+					if(_return_type_id == type_registry::get_void_handle())
+						line() << "return;\n";
+					else
+						line() << "return " << expression(parse_expression(_ctx, it, _return_type_id, true), _return_type_id) << ";\n";
+
+					parse_token_value(_ctx, it, Tokens::semicolon);
+				}
+		};
+	}
+
+	void emit_cpp(tk_iterator& it, const std::vector<std::pair<std::string, function> >& external_functions, const std::vector<std::string>& public_declarations, std::ostream& out)
+	{
+		compiler_context ctx;
+		cpp_emitter emitter(ctx, external_functions);
+
+		program_declarations program = parse_program(ctx, it, external_functions, public_declarations, [&](tk_iterator& it) { emitter.compile_global(it); });
+
+		for(size_t i = 0; i < program.functions.size(); ++i)
+			emitter.compile_function(program.functions[i], external_functions.size() + i);
+
+		for(const auto& [name, idx] : program.public_functions)
+			emitter.compile_public_function(name, program.functions[idx - external_functions.size()], idx);
+
+		emitter.write(out);
+	}
+}
@@ -0,0 +1,39 @@
+/**
+ * This file is a part of the Gisel Interpreter
+ *
+ * Copyright (C) 2022 @kbz_8
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef __CPP_EMITTER__
+#define __CPP_EMITTER__
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include "function.h"
+
+namespace Gisel
+{
+	class tk_iterator;
+	class runtime_context;
+
+	using function = func::function<void(runtime_context&)>;
+
+	// translates a program to C++ written against gisel_native.h; once built as a shared
+	// object, it is loaded by Module::load_native instead of the source
+	void emit_cpp(tk_iterator& it, const std::vector<std::pair<std::string, function> >& external_functions, const std::vector<std::string>& public_declarations, std::ostream& out);
+}
+
+#endif // __CPP_EMITTER__
@@ -84,10 +84,10 @@ namespace Gisel
 			std::string _message;
 	};
 
-	inline void runtime_assertion(bool b, std::string message)
+	inline void runtime_assertion(bool b, const char* message)
 	{
 		if(!b)
-			runtime_error(std::move(message)).expose();
+			runtime_error(message).expose();
 	}
 }
 
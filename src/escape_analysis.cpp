@@ -0,0 +1,55 @@
+/**
+ * This file is a part of the Gisel Interpreter
+ *
+ * Copyright (C) 2022 @kbz_8
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "escape_analysis.h"
+
+namespace Gisel
+{
+	std::unordered_set<std::string> find_referenced_names(const std::deque<Token>& tokens)
+	{
+		std::unordered_set<std::string> ret;
+
+		for(size_t i = 1; i < tokens.size(); ++i)
+		{
+			if(!tokens[i].has_value(Tokens::type_specifier))
+				continue;
+			if(!tokens[i-1].has_value(Tokens::bracket_b) && !tokens[i-1].has_value(Tokens::comma))
+				continue;
+
+			// the whole argument is taken, an identifier anywhere in it may be the referenced one
+			int depth = 0;
+			for(size_t j = i + 1; j < tokens.size(); ++j)
+			{
+				const Token& t = tokens[j];
+
+				if(t.has_value(Tokens::bracket_b))
+					++depth;
+				else if(t.has_value(Tokens::bracket_e) && depth-- == 0)
+					break;
+				else if(t.has_value(Tokens::comma) && depth == 0)
+					break;
+				else if(t.has_value(Tokens::semicolon) || t.is_eof())
+					break;
+				else if(t.is_identifier())
+					ret.insert(t.get_identifier().name);
+			}
+		}
+
+		return ret;
+	}
+}
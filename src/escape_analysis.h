@@ -0,0 +1,35 @@
+/**
+ * This file is a part of the Gisel Interpreter
+ *
+ * Copyright (C) 2022 @kbz_8
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef __ESCAPE_ANALYSIS__
+#define __ESCAPE_ANALYSIS__
+
+#include <deque>
+#include <string>
+#include <unordered_set>
+#include "tokens.h"
+
+namespace Gisel
+{
+	// names of the variables that a function body passes by reference (f(:x));
+	// locals that are never passed by reference can't be aliased and don't need
+	// a box of their own, whatever scope they are declared in
+	std::unordered_set<std::string> find_referenced_names(const std::deque<Token>& tokens);
+}
+
+#endif // __ESCAPE_ANALYSIS__
@@ -25,7 +25,14 @@
 #include "tk_iterator.h"
 #include "runtime_context.h"
 #include "compiler_context.h"
+#include "optimizer.h"
+#include "passes.h"
+#include "range_analysis.h"
+#include "arithmetic.h"
+#include "flat_expression.h"
+#include "task.h"
 #include <type_traits>
+#include <cstdint>
 
 namespace Gisel
 {
@@ -48,17 +55,19 @@ namespace Gisel
 			return std::forward<From>(from);
 		else if constexpr(is_boxed<From, To>::value)
 			return unbox(std::forward<From>(from));
+		else if constexpr(std::is_same<To, number>::value && is_boxed<typename remove_cvref<From>::type, integer>::value)
+			return number(unbox(std::forward<From>(from)));
 		else
 			return To();
 	}
 
 	template <typename From, typename To>
-	struct is_convertible { static const bool value = std::is_convertible<From, To>::value || is_boxed<From, To>::value || (std::is_same<To, string>::value && (std::is_same<From, number>::value || std::is_same<From, lnumber>::value)) || std::is_void<To>::value; };
+	struct is_convertible { static const bool value = std::is_convertible<From, To>::value || is_boxed<From, To>::value || (std::is_same<To, string>::value && (std::is_same<From, number>::value || std::is_same<From, lnumber>::value)) || (std::is_same<To, number>::value && std::is_same<From, linteger>::value) || std::is_void<To>::value; };
 
-	number lt(number n1, number n2) { return n1 < n2; }
-	number lt(string s1, string s2) { return *s1 < *s2; }
+	template <typename R>
+	struct is_lvalue_type { static constexpr const bool value = std::is_same<R, lvalue>::value || std::is_same<R, lnumber>::value || std::is_same<R, linteger>::value || std::is_same<R, lstring>::value || std::is_same<R, lfunction>::value; };
 
-	template <typename R, typename T>
+	template <typename R, typename T, bool checked>
 	class global_variable_expression: public expression<R>
 	{
 		public:
@@ -67,8 +76,19 @@ namespace Gisel
 			{
 				if constexpr(std::is_void<R>::value)
 					return;
+				else if constexpr(is_lvalue_type<R>::value)
+				{
+					// the global may be written through its box, which must then be its own
+					if constexpr(checked)
+						return convert<R>(context.writable_global(_idx)->template static_pointer_downcast<T>());
+					else
+						return convert<R>(context.writable_initialized_global(_idx)->template static_pointer_downcast<T>());
+				}
+				// a read does not take a reference: the value may be shared by the contexts of every thread
+				else if constexpr(checked)
+					return convert<R>(static_cast<const typename T::element_type&>(*context.global(_idx)).value);
 				else
-					return convert<R>(context.global(_idx)->template static_pointer_downcast<T>());
+					return convert<R>(static_cast<const typename T::element_type&>(*context.initialized_global(_idx)).value);
 			}
 
 		private:
@@ -97,7 +117,7 @@ namespace Gisel
 	{
 		public:
 			function_expression(int idx) : _idx(idx) {}
-			R evaluate(runtime_context& context) const override { return convert<R>(context.get_function(_idx)); }
+			R evaluate(runtime_context& context) const override { return convert<R>(function(function_reference(_idx))); }
 
 		private:
 			int _idx;
@@ -148,27 +168,39 @@ namespace Gisel
 			using name##_expression = generic_expression<name##_op, R, T1>;
 
 			UNARY_EXPRESSION(preinc,
-				++t1->value;
+				t1->value = add(t1->value, decltype(t1->value)(1));
 				return t1;
 			);
 
 			UNARY_EXPRESSION(predec,
-				--t1->value;
+				t1->value = sub(t1->value, decltype(t1->value)(1));
 				return t1;
 			);
 
-			UNARY_EXPRESSION(postinc, return t1->value++);
+			UNARY_EXPRESSION(postinc,
+				auto old = t1->value;
+				t1->value = add(old, decltype(old)(1));
+				return old;
+			);
 			
-			UNARY_EXPRESSION(postdec, return t1->value--);
+			UNARY_EXPRESSION(postdec,
+				auto old = t1->value;
+				t1->value = sub(old, decltype(old)(1));
+				return old;
+			);
 			
 			UNARY_EXPRESSION(positive, return t1);
 			
-			UNARY_EXPRESSION(negative, return -t1);
+			UNARY_EXPRESSION(negative, return neg(t1));
 			
-			UNARY_EXPRESSION(bnot, return ~int(t1));
+			UNARY_EXPRESSION(bnot, return ~t1);
 			
 			UNARY_EXPRESSION(lnot, return !t1);
 
+			UNARY_EXPRESSION(to_integer, return to_integer(t1));
+
+			UNARY_EXPRESSION(to_number, return number(t1));
+
 #undef UNARY_EXPRESSION
 
 #define BINARY_EXPRESSION(name, code)\
@@ -183,38 +215,48 @@ namespace Gisel
 			template<typename R, typename T1, typename T2>\
 			using name##_expression = generic_expression<name##_op, R, T1, T2>;
 
-			BINARY_EXPRESSION(add, return t1 + t2);
+			BINARY_EXPRESSION(add, return add(t1, t2));
 			
-			BINARY_EXPRESSION(sub, return t1 - t2);
+			BINARY_EXPRESSION(sub, return sub(t1, t2));
+
+			BINARY_EXPRESSION(mul, return mul(t1, t2));
+
+			BINARY_EXPRESSION(div, return div(t1, t2));
+
+			BINARY_EXPRESSION(mod, return mod(t1, t2));
+
+			BINARY_EXPRESSION(band, return t1 & t2);
+
+			BINARY_EXPRESSION(bor, return t1 | t2);
 
-			BINARY_EXPRESSION(mul, return t1 * t2);
+			BINARY_EXPRESSION(bxor, return t1 ^ t2);
 
-			BINARY_EXPRESSION(div, return t1 / t2);
+			BINARY_EXPRESSION(shl, return integer(std::uint64_t(t1) << (t2 & 63)));
 
-			BINARY_EXPRESSION(mod, return t1 - t2 * int(t1/t2));
+			BINARY_EXPRESSION(shr, return t1 >> (t2 & 63));
 
 			BINARY_EXPRESSION(add_assign,
-				t1->value += t2;
+				t1->value = add(t1->value, t2);
 				return t1;
 			);
 			
 			BINARY_EXPRESSION(sub_assign,
-				t1->value -= t2;
+				t1->value = sub(t1->value, t2);
 				return t1;
 			);
 			
 			BINARY_EXPRESSION(mul_assign,
-				t1->value *= t2;
+				t1->value = mul(t1->value, t2);
 				return t1;
 			);
 			
 			BINARY_EXPRESSION(div_assign,
-				t1->value /= t2;
+				t1->value = div(t1->value, t2);
 				return t1;
 			);
 			
 			BINARY_EXPRESSION(mod_assign,
-				t1->value = t1->value - t2 * int(t1->value/t2);
+				t1->value = mod(t1->value, t2);
 				return t1;
 			);
 			
@@ -237,6 +279,53 @@ namespace Gisel
 
 #undef BINARY_EXPRESSION
 
+	// modulo by a power of two : the quotient is computed with the exact reciprocal instead of a division
+	template<typename R, typename T1>
+	class mod_reciprocal_expression: public expression<R>
+	{
+		public:
+			mod_reciprocal_expression(typename expression<T1>::ptr expr, number divisor) : _expr(std::move(expr)), _divisor(divisor), _reciprocal(1 / divisor) {}
+
+			R evaluate(runtime_context& context) const override
+			{
+				if constexpr(std::is_same<T1, lnumber>::value)
+				{
+					lnumber t1 = _expr->evaluate(context);
+					t1->value = t1->value - _divisor * int(t1->value * _reciprocal);
+					return convert<R>(std::move(t1));
+				}
+				else
+				{
+					number t1 = _expr->evaluate(context);
+					return convert<R>(t1 - _divisor * int(t1 * _reciprocal));
+				}
+			}
+
+		private:
+			typename expression<T1>::ptr _expr;
+			number _divisor;
+			number _reciprocal;
+	};
+
+	// both operands are integers within the range of int, so the remainder is exact without any division of doubles
+	template<typename R>
+	class int_mod_expression: public expression<R>
+	{
+		public:
+			int_mod_expression(expression<number>::ptr expr1, expression<number>::ptr expr2) : _expr1(std::move(expr1)), _expr2(std::move(expr2)) {}
+
+			R evaluate(runtime_context& context) const override
+			{
+				const std::int64_t t1 = std::int64_t(_expr1->evaluate(context));
+				const std::int64_t t2 = std::int64_t(_expr2->evaluate(context));
+				return convert<R>(number(t1 % t2));
+			}
+
+		private:
+			expression<number>::ptr _expr1;
+			expression<number>::ptr _expr2;
+	};
+
 	template<typename R, typename T1, typename T2>
 	class comma_expression: public expression<R>
 	{
@@ -302,7 +391,7 @@ namespace Gisel
 			typename expression<T3>::ptr _expr3;
 	};
 
-	template<typename R, typename T>
+	template<typename R, typename T, bool checked>
 	class call_expression: public expression<R>
 	{
 		public:
@@ -310,23 +399,84 @@ namespace Gisel
 			
 			R evaluate(runtime_context& context) const override
 			{
-				std::vector<variable_ptr> params;
-				params.reserve(_exprs.size());
-			
+				// the arguments go straight to the stack
 				for(size_t i = 0; i < _exprs.size(); ++i)
-					params.push_back(_exprs[i]->evaluate(context));
+					context.push(_exprs[i]->evaluate(context));
 				
 				function f = _fexpr->evaluate(context);
 				
 				if constexpr(std::is_same<R, void>::value)
-					context.call(f, std::move(params));
+					call(context, f);
 				else
-					return convert<R>(std::move(std::static_pointer_cast<variable_impl<T>>(context.call(f, std::move(params)))->value));
+					return convert<R>(std::move(std::static_pointer_cast<variable_impl<T>>(call(context, f))->value));
 			}
 			
 		private:
 			expression<function>::ptr _fexpr;
 			std::vector<expression<lvalue>::ptr> _exprs;
+			
+			inline variable_ptr call(runtime_context& context, const function& f) const
+			{
+				if constexpr(checked)
+					return context.call_pushed(f, _exprs.size());
+				else
+					return context.call_defined(f, _exprs.size());
+			}
+	};
+
+	// the task is queued with the values of the arguments, which its own context gets copies of
+	template<typename R>
+	class spawn_expression: public expression<R>
+	{
+		public:
+			spawn_expression(expression<function>::ptr fexpr, std::vector<expression<lvalue>::ptr> exprs) : _fexpr(std::move(fexpr)), _exprs(std::move(exprs)) {}
+			
+			R evaluate(runtime_context& context) const override
+			{
+				std::vector<variable_ptr> args;
+				args.reserve(_exprs.size());
+				for(const expression<lvalue>::ptr& expr : _exprs)
+					args.push_back(expr->evaluate(context));
+				
+				function task = spawn_task(context, _fexpr->evaluate(context), std::move(args));
+				if constexpr(!std::is_void<R>::value)
+					return convert<R>(std::move(task));
+			}
+			
+		private:
+			expression<function>::ptr _fexpr;
+			std::vector<expression<lvalue>::ptr> _exprs;
+	};
+
+	// a call to a function of the program by its name, which runs it without copying it
+	template<typename R, typename T, bool checked>
+	class direct_call_expression: public expression<R>
+	{
+		public:
+			direct_call_expression(int idx, std::vector<expression<lvalue>::ptr> exprs) : _idx(idx), _exprs(std::move(exprs)) {}
+			
+			R evaluate(runtime_context& context) const override
+			{
+				for(size_t i = 0; i < _exprs.size(); ++i)
+					context.push(_exprs[i]->evaluate(context));
+				
+				if constexpr(std::is_same<R, void>::value)
+					call(context);
+				else
+					return convert<R>(std::move(std::static_pointer_cast<variable_impl<T>>(call(context))->value));
+			}
+			
+		private:
+			int _idx;
+			std::vector<expression<lvalue>::ptr> _exprs;
+			
+			inline variable_ptr call(runtime_context& context) const
+			{
+				if constexpr(checked)
+					return context.call_pushed(context.get_function(_idx), _exprs.size());
+				else
+					return context.call_defined(context.get_function(_idx), _exprs.size());
+			}
 	};
 
 	template <typename T>
@@ -334,7 +484,7 @@ namespace Gisel
 	{
 		public:
 			param_expression(typename expression<T>::ptr expr) : _expr(std::move(expr)) {}                
-			lvalue evaluate(runtime_context& context) const override { return std::make_shared<variable_impl<T>>(_expr->evaluate(context)); }
+			lvalue evaluate(runtime_context& context) const override { return context.make_variable<T>(_expr->evaluate(context)); }
 
 		private:
 			typename expression<T>::ptr _expr;
@@ -342,6 +492,18 @@ namespace Gisel
 
 	struct expression_builder_error { expression_builder_error(){} };
 
+	inline bool is_integer(const node_ptr& np) { return np->get_type_id() == type_registry::get_integer_handle(); }
+	inline bool is_numeric(const node_ptr& np) { return np->get_type_id() == type_registry::get_number_handle() || is_integer(np); }
+	inline bool are_integer_operands(const node_ptr& np1, const node_ptr& np2) { return (is_integer(np1) || is_integral_literal(*np1)) && (is_integer(np2) || is_integral_literal(*np2)) && (is_integer(np1) || is_integer(np2)); }
+
+	// t1 - t2 * int(t1/t2) gives the exact remainder of integers, except that -0 % t2 is -0
+	bool is_int_mod(const node_ptr& np, const compiler_context& context)
+	{
+		std::optional<value_range> r1 = get_range(np->get_children()[0], context);
+		std::optional<value_range> r2 = get_range(np->get_children()[1], context);
+		return r1 && r2 && r1->is_int32() && r2->is_int32() && !r1->negative_zero && !r2->contains(0);
+	}
+
 	expression<lvalue>::ptr build_lvalue_expression(type_handle type_id, const node_ptr& np, compiler_context& context);
 
 #define RETURN_EXPRESSION_OF_TYPE(T)\
@@ -360,9 +522,13 @@ namespace Gisel
 			const identifier_info* info = context.find(id.name);\
 			switch(info->get_scope())\
 			{\
-				case identifier_scope::global_variable: return std::make_unique<global_variable_expression<R, T1>>(info->index());\
+				case identifier_scope::global_variable:\
+					if(context.are_globals_initialized())\
+						return std::make_unique<global_variable_expression<R, T1, false>>(info->index());\
+					return std::make_unique<global_variable_expression<R, T1, true>>(info->index());\
 				case identifier_scope::local_variable: return std::make_unique<local_variable_expression<R, T1>>(info->index());\
-				case identifier_scope::function: break;\
+				case identifier_scope::function:\
+				case identifier_scope::constant: break;\
 			}\
 		}
 
@@ -374,7 +540,8 @@ namespace Gisel
 			switch(info->get_scope())\
 			{\
 				case identifier_scope::global_variable:\
-				case identifier_scope::local_variable: break;\
+				case identifier_scope::local_variable:\
+				case identifier_scope::constant: break;\
 				case identifier_scope::function: return std::make_unique<function_expression<R> >(info->index());\
 			}\
 		}
@@ -392,11 +559,52 @@ namespace Gisel
 
 #define CHECK_COMPARISON_OPERATION(name)\
 			case node_operation::name:\
-				if(np->get_children()[0]->get_type_id() == type_registry::get_number_handle() && np->get_children()[1]->get_type_id() == type_registry::get_number_handle())\
+				if(are_integer_operands(np->get_children()[0], np->get_children()[1]))\
+					return expression_ptr(std::make_unique<name##_expression<R, integer, integer>>(expression_builder<integer>::build_expression(np->get_children()[0], context), expression_builder<integer>::build_expression(np->get_children()[1], context)));\
+				else if(is_numeric(np->get_children()[0]) && is_numeric(np->get_children()[1]))\
 					return expression_ptr(std::make_unique<name##_expression<R, number, number>>(expression_builder<number>::build_expression(np->get_children()[0], context), expression_builder<number>::build_expression(np->get_children()[1], context)));\
 				else\
 					return expression_ptr(std::make_unique<name##_expression<R, string, string>>(expression_builder<string>::build_expression(np->get_children()[0], context), expression_builder<string>::build_expression(np->get_children()[1], context)));
 
+#define CHECK_MOD_OPERATION(name, T1)\
+		case node_operation::name:\
+			if constexpr(std::is_same<T1, number>::value)\
+			{\
+				if(is_int_mod(np, context))\
+					return expression_ptr(std::make_unique<int_mod_expression<R>>(expression_builder<number>::build_expression(np->get_children()[0], context), expression_builder<number>::build_expression(np->get_children()[1], context)));\
+			}\
+			if(std::optional<double> divisor = get_constant(np->get_children()[1]); divisor && has_exact_reciprocal(*divisor))\
+				return expression_ptr(std::make_unique<mod_reciprocal_expression<R, T1>>(expression_builder<T1>::build_expression(np->get_children()[0], context), *divisor));\
+			return expression_ptr(std::make_unique<name##_expression<R, T1, number>>(expression_builder<T1>::build_expression(np->get_children()[0], context), expression_builder<number>::build_expression(np->get_children()[1], context)));
+
+	// with unchecked options, the functions of the program are known to be defined, unlike external functions and function values
+	inline bool is_defined_function(const node_ptr& np, const compiler_context& context)
+	{
+		if(!context.get_options().unchecked || !np->is_identifier())
+			return false;
+		const identifier_info* info = context.find(std::string(np->get_identifier()));
+		return info->get_scope() == identifier_scope::function && !context.is_external_function(info);
+	}
+
+	// the index of the function np names, -1 when np is no function name
+	inline int function_index(const node_ptr& np, const compiler_context& context)
+	{
+		if(!np->is_identifier())
+			return -1;
+		const identifier_info* info = context.find(std::string(np->get_identifier()));
+		return info->get_scope() == identifier_scope::function ? int(info->index()) : -1;
+	}
+
+#define CHECK_SPAWN_OPERATION()\
+		case node_operation::spawn:\
+		{\
+			std::vector<expression<lvalue>::ptr> arguments;\
+			const function_type* ft = std::get_if<function_type>(np->get_children()[0]->get_type_id());\
+			for(size_t i = 1; i < np->get_children().size(); ++i)\
+				arguments.push_back(build_lvalue_expression(ft->param_type_id[i-1].type_id, np->get_children()[i]->get_children()[0], context));\
+			return expression_ptr(std::make_unique<spawn_expression<R>>(expression_builder<function>::build_expression(np->get_children()[0], context), std::move(arguments)));\
+		}
+
 #define CHECK_CALL_OPERATION(T)\
 		case node_operation::call:\
 		{\
@@ -410,7 +618,16 @@ namespace Gisel
 				else\
 					arguments.push_back(expression_builder<lvalue>::build_expression(child, context));\
 			}\
-			return expression_ptr(std::make_unique<call_expression<R, T>>(expression_builder<function>::build_expression(np->get_children()[0], context), std::move(arguments)));\
+			if(int idx = function_index(np->get_children()[0], context); idx >= 0)\
+			{\
+				if(is_defined_function(np->get_children()[0], context))\
+					return expression_ptr(std::make_unique<direct_call_expression<R, T, false>>(idx, std::move(arguments)));\
+				return expression_ptr(std::make_unique<direct_call_expression<R, T, true>>(idx, std::move(arguments)));\
+			}\
+			expression<function>::ptr fexpr = expression_builder<function>::build_expression(np->get_children()[0], context);\
+			if(is_defined_function(np->get_children()[0], context))\
+				return expression_ptr(std::make_unique<call_expression<R, T, false>>(std::move(fexpr), std::move(arguments)));\
+			return expression_ptr(std::make_unique<call_expression<R, T, true>>(std::move(fexpr), std::move(arguments)));\
 		}
 
 	template<typename R>
@@ -445,6 +662,15 @@ namespace Gisel
 								{
 									RETURN_EXPRESSION_OF_TYPE(string);
 								}
+							case simple_type::integer:
+								if(np->is_lvalue())
+								{
+									RETURN_EXPRESSION_OF_TYPE(linteger);
+								}
+								else
+								{
+									RETURN_EXPRESSION_OF_TYPE(integer);
+								}
 							case simple_type::nothing: RETURN_EXPRESSION_OF_TYPE(void);
 						}
 					},
@@ -478,8 +704,23 @@ namespace Gisel
 			
 			static expression_ptr build_number_expression(const node_ptr& np, compiler_context& context)
 			{
+				if constexpr(std::is_same<R, number>::value)
+				{
+					if(context.passes().is_enabled(pass::flatten))
+					{
+						auto timer = context.passes().time(pass::flatten);
+						if(expression_ptr flat = build_flat_number_expression(context, np))
+							return flat;
+					}
+				}
+				
 				if(std::holds_alternative<double>(np->get_value()))
-					return std::make_unique<constant_expression<R, number>>(std::get<double>(np->get_value()));
+				{
+					if constexpr(std::is_same<R, integer>::value)
+						return std::make_unique<constant_expression<R, integer>>(integer(std::get<double>(np->get_value())));
+					else
+						return std::make_unique<constant_expression<R, number>>(std::get<double>(np->get_value()));
+				}
 				
 				CHECK_IDENTIFIER(lnumber);
 				
@@ -489,13 +730,13 @@ namespace Gisel
 					CHECK_UNARY_OPERATION(postdec, lnumber);
 					CHECK_UNARY_OPERATION(positive, number);
 					CHECK_UNARY_OPERATION(negative, number);
-					CHECK_UNARY_OPERATION(bnot, number);
 					CHECK_UNARY_OPERATION(lnot, number);
+					CHECK_UNARY_OPERATION(to_number, number);
 					CHECK_BINARY_OPERATION(add, number, number);
 					CHECK_BINARY_OPERATION(sub, number, number);
 					CHECK_BINARY_OPERATION(mul, number, number);
 					CHECK_BINARY_OPERATION(div, number, number);
-					CHECK_BINARY_OPERATION(mod, number, number);
+					CHECK_MOD_OPERATION(mod, number);
 					CHECK_COMPARISON_OPERATION(eq);
 					CHECK_COMPARISON_OPERATION(ne);
 					CHECK_COMPARISON_OPERATION(lt);
@@ -525,7 +766,7 @@ namespace Gisel
 					CHECK_BINARY_OPERATION(sub_assign, lnumber, number);
 					CHECK_BINARY_OPERATION(mul_assign, lnumber, number);
 					CHECK_BINARY_OPERATION(div_assign, lnumber, number);
-					CHECK_BINARY_OPERATION(mod_assign, lnumber, number);
+					CHECK_MOD_OPERATION(mod_assign, lnumber);
 					CHECK_BINARY_OPERATION(comma, void, lnumber);
 					CHECK_TERNARY_OPERATION(ternary, number, lnumber, lnumber);
 					
@@ -533,6 +774,60 @@ namespace Gisel
 				}
 			}
 			
+			static expression_ptr build_integer_expression(const node_ptr& np, compiler_context& context)
+			{
+				CHECK_IDENTIFIER(linteger);
+				
+				switch(std::get<node_operation>(np->get_value()))
+				{
+					case node_operation::to_integer:
+						if(is_integer(np->get_children()[0]))
+							return expression_builder<R>::build_expression(np->get_children()[0], context);
+						return expression_ptr(std::make_unique<to_integer_expression<R, number>>(expression_builder<number>::build_expression(np->get_children()[0], context)));
+					CHECK_UNARY_OPERATION(postinc, linteger);
+					CHECK_UNARY_OPERATION(postdec, linteger);
+					CHECK_UNARY_OPERATION(positive, integer);
+					CHECK_UNARY_OPERATION(negative, integer);
+					CHECK_UNARY_OPERATION(bnot, integer);
+					CHECK_BINARY_OPERATION(add, integer, integer);
+					CHECK_BINARY_OPERATION(sub, integer, integer);
+					CHECK_BINARY_OPERATION(mul, integer, integer);
+					CHECK_BINARY_OPERATION(div, integer, integer);
+					CHECK_BINARY_OPERATION(mod, integer, integer);
+					CHECK_BINARY_OPERATION(band, integer, integer);
+					CHECK_BINARY_OPERATION(bor, integer, integer);
+					CHECK_BINARY_OPERATION(bxor, integer, integer);
+					CHECK_BINARY_OPERATION(shl, integer, integer);
+					CHECK_BINARY_OPERATION(shr, integer, integer);
+					CHECK_BINARY_OPERATION(comma, void, integer);
+					CHECK_TERNARY_OPERATION(ternary, number, integer, integer);
+					CHECK_CALL_OPERATION(integer);
+					
+					default: throw expression_builder_error();
+				}
+			}
+			
+			static expression_ptr build_linteger_expression(const node_ptr& np, compiler_context& context)
+			{
+				CHECK_IDENTIFIER(linteger);
+
+				switch(std::get<node_operation>(np->get_value()))
+				{
+					CHECK_UNARY_OPERATION(preinc, linteger);
+					CHECK_UNARY_OPERATION(predec, linteger);
+					CHECK_BINARY_OPERATION(assign, linteger, integer);
+					CHECK_BINARY_OPERATION(add_assign, linteger, integer);
+					CHECK_BINARY_OPERATION(sub_assign, linteger, integer);
+					CHECK_BINARY_OPERATION(mul_assign, linteger, integer);
+					CHECK_BINARY_OPERATION(div_assign, linteger, integer);
+					CHECK_BINARY_OPERATION(mod_assign, linteger, integer);
+					CHECK_BINARY_OPERATION(comma, void, linteger);
+					CHECK_TERNARY_OPERATION(ternary, number, linteger, linteger);
+					
+					default: throw expression_builder_error();
+				}
+			}
+			
 			static expression_ptr build_string_expression(const node_ptr& np, compiler_context& context)
 			{
 				if(std::holds_alternative<std::string>(np->get_value()))
@@ -574,6 +869,7 @@ namespace Gisel
 					CHECK_BINARY_OPERATION(comma, void, function);
 					CHECK_TERNARY_OPERATION(ternary, number, function, function);
 					CHECK_CALL_OPERATION(function);
+					CHECK_SPAWN_OPERATION();
 					
 					default: throw expression_builder_error();
 				}
@@ -595,7 +891,9 @@ namespace Gisel
 			
 	};
 
+#undef CHECK_SPAWN_OPERATION
 #undef CHECK_CALL_OPERATION
+#undef CHECK_MOD_OPERATION
 #undef CHECK_COMPARISON_OPERATION
 #undef CHECK_TERNARY_OPERATION
 #undef CHECK_BINARY_OPERATION
@@ -614,6 +912,7 @@ namespace Gisel
 				{
 					case simple_type::number: return expression_builder<number>::build_param_expression(np, context);
 					case simple_type::string: return expression_builder<string>::build_param_expression(np, context);
+					case simple_type::integer: return expression_builder<integer>::build_param_expression(np, context);
 					case simple_type::nothing:
 						throw expression_builder_error();
 						return expression<lvalue>::ptr();
@@ -625,21 +924,24 @@ namespace Gisel
 
 	class empty_expression: public expression<void> { void evaluate(runtime_context&) const override {} };
 
+	node_ptr parse_expression(compiler_context& context, tk_iterator& it, type_handle type_id, bool allow_comma)
+	{
+		node_ptr np = parse_expression_tree(context, it, type_id, allow_comma);
+		context.passes().run_node_passes(np, context);
+		return np;
+	}
+
 	template<typename R>
-	typename expression<R>::ptr build_expression(type_handle type_id, compiler_context& context, tk_iterator& it, bool allow_comma)
+	typename expression<R>::ptr build_expression(type_handle type_id, compiler_context& context, const node_ptr& np)
 	{
-		size_t line_number = it->get_line_number();
-		
-		try
+		if constexpr(std::is_void<R>::value)
 		{
-			node_ptr np = parse_expression_tree(context, it, type_id, allow_comma);
-			
-			if constexpr(std::is_void<R>::value)
-			{
-				if(!np)
-					return std::make_unique<empty_expression>();
-			}
+			if(!np)
+				return std::make_unique<empty_expression>();
+		}
 
+		try
+		{
 			if constexpr(std::is_same<R, lvalue>::value)
 				return build_lvalue_expression(type_id, np, context);
 			else
@@ -647,21 +949,65 @@ namespace Gisel
 		}
 		catch(const expression_builder_error&)
 		{
-			compiler_error("expression building failed", line_number).expose();
+			compiler_error("expression building failed", np->get_line_number()).expose();
 		}
 	}
 
+	template<typename R>
+	typename expression<R>::ptr build_expression(type_handle type_id, compiler_context& context, tk_iterator& it, bool allow_comma)
+	{
+		node_ptr np = parse_expression(context, it, type_id, allow_comma);
+		return build_expression<R>(type_id, context, np);
+	}
+
 	template <typename T>
 	class default_initialization_expression: public expression<lvalue>
 	{
 		public:
-			lvalue evaluate(runtime_context &context) const override { return std::make_shared<variable_impl<T>>(T{}); }
+			lvalue evaluate(runtime_context &context) const override { return context.make_variable<T>(T{}); }
+	};
+
+	// a local that is passed by reference may be shared with a callee, it gets a new box every time it is declared
+	class boxed_declaration_expression: public expression<void>
+	{
+		public:
+			boxed_declaration_expression(expression<lvalue>::ptr initializer) : _initializer(std::move(initializer)) {}
+			void evaluate(runtime_context& context) const override { context.push(_initializer->evaluate(context)); }
+
+		private:
+			expression<lvalue>::ptr _initializer;
+	};
+
+	// any other local reuses the box left in its stack slot by the previous declaration
+	template <typename T>
+	class register_declaration_expression: public expression<void>
+	{
+		public:
+			register_declaration_expression(typename expression<T>::ptr initializer) : _initializer(std::move(initializer)) {}
+			void evaluate(runtime_context& context) const override { context.push_value<T>(_initializer ? _initializer->evaluate(context) : T{}); }
+
+		private:
+			typename expression<T>::ptr _initializer;
 	};
 
+	template <typename T>
+	expression<void>::ptr build_register_declaration(compiler_context& context, const node_ptr& np, type_handle type_id)
+	{
+		typename expression<T>::ptr initializer;
+		if(np)
+			initializer = build_expression<T>(type_id, context, np);
+		return std::make_unique<register_declaration_expression<T>>(std::move(initializer));
+	}
+
 	expression<void>::ptr build_void_expression(compiler_context& context, tk_iterator& it) { return build_expression<void>(type_registry::get_void_handle(), context, it, true); }
 	expression<number>::ptr build_number_expression(compiler_context& context, tk_iterator& it) { return build_expression<number>(type_registry::get_number_handle(), context, it, true); }
 	expression<string>::ptr build_string_expression(compiler_context& context, tk_iterator& it) { return build_expression<string>(type_registry::get_string_handle(), context, it, true); }
 	expression<lvalue>::ptr build_initialization_expression(compiler_context& context, tk_iterator& it, type_handle type_id, bool allow_comma) { return build_expression<lvalue>(type_id, context, it, allow_comma); }
+	expression<void>::ptr build_void_expression(compiler_context& context, const node_ptr& np) { return build_expression<void>(type_registry::get_void_handle(), context, np); }
+	expression<number>::ptr build_number_expression(compiler_context& context, const node_ptr& np) { return build_expression<number>(type_registry::get_number_handle(), context, np); }
+	expression<integer>::ptr build_integer_expression(compiler_context& context, const node_ptr& np) { return build_expression<integer>(type_registry::get_integer_handle(), context, np); }
+	expression<string>::ptr build_string_expression(compiler_context& context, const node_ptr& np) { return build_expression<string>(type_registry::get_string_handle(), context, np); }
+	expression<lvalue>::ptr build_initialization_expression(compiler_context& context, const node_ptr& np, type_handle type_id) { return build_expression<lvalue>(type_id, context, np); }
 
 	expression<lvalue>::ptr build_default_initialization(type_handle type_id)
 	{
@@ -673,10 +1019,33 @@ namespace Gisel
 				{
 					case simple_type::number:  return expression<lvalue>::ptr(std::make_unique<default_initialization_expression<number>>());
 					case simple_type::string:  return expression<lvalue>::ptr(std::make_unique<default_initialization_expression<string>>());
+					case simple_type::integer: return expression<lvalue>::ptr(std::make_unique<default_initialization_expression<integer>>());
 					case simple_type::nothing: return expression<lvalue>::ptr(nullptr); // cannot happen
 				}
 			},
 			[&](const function_type& ft) { return expression<lvalue>::ptr(std::make_unique<default_initialization_expression<function>>()); },
 		}, *type_id);
 	}
+
+	expression<void>::ptr build_local_declaration(compiler_context& context, const node_ptr& np, type_handle type_id, bool boxed)
+	{
+		if(boxed)
+			return std::make_unique<boxed_declaration_expression>(np ? build_initialization_expression(context, np, type_id) : build_default_initialization(type_id));
+
+		return std::visit(overloaded
+		{
+			[&](simple_type st)
+			{
+				switch(st)
+				{
+					case simple_type::number:  return build_register_declaration<number>(context, np, type_id);
+					case simple_type::string:  return build_register_declaration<string>(context, np, type_id);
+					case simple_type::integer: return build_register_declaration<integer>(context, np, type_id);
+					case simple_type::nothing: break;
+				}
+				return expression<void>::ptr(nullptr); // cannot happen
+			},
+			[&](const function_type&) { return build_register_declaration<function>(context, np, type_id); },
+		}, *type_id);
+	}
 }
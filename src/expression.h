@@ -22,6 +22,7 @@
 
 #include "variable.h"
 #include "type.h"
+#include "node_arena.h"
 
 #include <string>
 
@@ -30,9 +31,12 @@ namespace Gisel
 	class runtime_context;
 	class tk_iterator;
 	class compiler_context;
+	struct node;
+
+	using node_ptr = std::unique_ptr<node>;
 
 	template <typename R>
-	class expression
+	class expression : public arena_object
 	{
 		public:
 			using ptr = std::unique_ptr<const expression>;
@@ -53,6 +57,14 @@ namespace Gisel
 	expression<string>::ptr build_string_expression(compiler_context& context, tk_iterator& it);
 	expression<lvalue>::ptr build_initialization_expression(compiler_context& context, tk_iterator& it, type_handle type_id, bool allow_comma);
 	expression<lvalue>::ptr build_default_initialization(type_handle type_id);
+
+	node_ptr parse_expression(compiler_context& context, tk_iterator& it, type_handle type_id, bool allow_comma);
+	expression<void>::ptr build_void_expression(compiler_context& context, const node_ptr& np);
+	expression<number>::ptr build_number_expression(compiler_context& context, const node_ptr& np);
+	expression<integer>::ptr build_integer_expression(compiler_context& context, const node_ptr& np);
+	expression<string>::ptr build_string_expression(compiler_context& context, const node_ptr& np);
+	expression<lvalue>::ptr build_initialization_expression(compiler_context& context, const node_ptr& np, type_handle type_id);
+	expression<void>::ptr build_local_declaration(compiler_context& context, const node_ptr& np, type_handle type_id, bool boxed);
 }
 
 #endif // __EXPRESSION__
@@ -21,6 +21,7 @@
 #include "utils.h"
 
 #include <filesystem>
+#include <cmath>
 
 namespace Gisel
 {
@@ -32,17 +33,70 @@ namespace Gisel
             return lvalue_from && type_from == type_to;
         if(type_from == type_to)
             return true;
+        if(type_from == type_registry::get_integer_handle() && type_to == type_registry::get_number_handle())
+            return true;
         return type_from == type_registry::get_number_handle() && type_to == type_registry::get_string_handle();
     }
 
+    inline bool is_integer(const node& n) { return n.get_type_id() == type_registry::get_integer_handle(); }
+    
+    // operands of int operations: ints and integral literals, as long as one of them is an int
+    inline bool is_integer_operand(const node& n) { return is_integer(n) || is_integral_literal(n); }
+    inline bool are_integer_operands(const node& n1, const node& n2) { return is_integer_operand(n1) && is_integer_operand(n2) && (is_integer(n1) || is_integer(n2)); }
+
     bool is_file(const char* file)
     {
         std::filesystem::path f(file);
         return std::filesystem::exists(f) ? true : false;
     }
 
+	void log_lvalue_writes(compiler_context& context, const node& n, bool additive = false)
+	{
+		if(n.is_identifier())
+		{
+			context.log_write(std::string(n.get_identifier()), n.get_line_number(), additive);
+			return;
+		}
+		if(!n.is_node_operation())
+			return;
+
+		const std::vector<node_ptr>& children = n.get_children();
+
+		switch(n.get_node_operation())
+		{
+			case node_operation::preinc:
+			case node_operation::predec:
+			case node_operation::add_assign:
+			case node_operation::sub_assign: log_lvalue_writes(context, *children[0], additive); break;
+			case node_operation::assign:
+			case node_operation::mul_assign:
+			case node_operation::div_assign:
+			case node_operation::mod_assign: log_lvalue_writes(context, *children[0]); break;
+			case node_operation::comma: log_lvalue_writes(context, *children.back(), additive); break;
+			case node_operation::ternary:
+				log_lvalue_writes(context, *children[1], additive);
+				log_lvalue_writes(context, *children[2], additive);
+			break;
+
+			default: break;
+		}
+	}
+
+	bool is_integral_literal(const node& n)
+	{
+		if(n.is_number())
+			return n.get_number() == std::trunc(n.get_number()) && std::fabs(n.get_number()) < 9223372036854775808.0;
+		if(n.is_node_operation() && (n.get_node_operation() == node_operation::positive || n.get_node_operation() == node_operation::negative))
+			return is_integral_literal(*n.get_children()[0]);
+		return false;
+	}
+
 	void node::check_conversion(type_handle type_id, bool lvalue) const
 	{
+		if(lvalue && (is_number() || is_string()))
+			semantic_error("cannot assign to a constant", _line_number).expose();
+		if(!lvalue && type_id == type_registry::get_integer_handle() && is_integral_literal(*this))
+			return;
 		if(!is_convertible(_type_id, _lvalue, type_id, lvalue))
 			wrong_type_error(std::to_string(_type_id).c_str(), std::to_string(type_id).c_str(), lvalue, _line_number).expose();
 	}
@@ -58,6 +112,22 @@ namespace Gisel
 		const type_handle void_handle = type_registry::get_void_handle();
 		const type_handle number_handle = type_registry::get_number_handle();
 		const type_handle string_handle = type_registry::get_string_handle();
+		const type_handle integer_handle = type_registry::get_integer_handle();
+
+		if(const identifier* id = std::get_if<identifier>(&_value))
+		{
+			if(const identifier_info* info = context.find(id->name); info && info->get_scope() == identifier_scope::constant)
+			{
+				_value = std::visit([](const auto& value) { return node_value(value); }, info->get_constant());
+				
+				// an int constant keeps its type
+				if(info->type_id() == integer_handle)
+				{
+					_children.push_back(std::make_unique<node>(context, std::move(_value), std::vector<node_ptr>(), line_number));
+					_value = node_operation::to_integer;
+				}
+			}
+		}
 		
 		std::visit(overloaded
 		{
@@ -91,30 +161,61 @@ namespace Gisel
 					break;
 					case node_operation::preinc:
 					case node_operation::predec:
-						_type_id = number_handle;
+						_type_id = is_integer(*_children[0]) ? integer_handle : number_handle;
 						_lvalue = true;
-						_children[0]->check_conversion(number_handle, true);
+						_children[0]->check_conversion(_type_id, true);
+						log_lvalue_writes(context, *_children[0], true);
 					break;
 					case node_operation::postinc:
 					case node_operation::postdec:
-						_type_id = number_handle;
+						_type_id = is_integer(*_children[0]) ? integer_handle : number_handle;
 						_lvalue = false;
-						_children[0]->check_conversion(number_handle, true);
+						_children[0]->check_conversion(_type_id, true);
+						log_lvalue_writes(context, *_children[0], true);
 					break;
 					case node_operation::positive:
 					case node_operation::negative:
+						_type_id = is_integer(*_children[0]) ? integer_handle : number_handle;
+						_lvalue = false;
+						_children[0]->check_conversion(_type_id, false);
+					break;
 					case node_operation::bnot:
+						_type_id = integer_handle;
+						_lvalue = false;
+						_children[0]->check_conversion(integer_handle, false);
+					break;
 					case node_operation::lnot:
 						_type_id = number_handle;
 						_lvalue = false;
 						_children[0]->check_conversion(number_handle, false);
 					break;
+					case node_operation::to_integer:
+					case node_operation::to_number:
+						_type_id = value == node_operation::to_integer ? integer_handle : number_handle;
+						_lvalue = false;
+						if(!is_integer(*_children[0]))
+							_children[0]->check_conversion(number_handle, false);
+					break;
 					case node_operation::add:
 					case node_operation::sub:
 					case node_operation::mul:
 					case node_operation::div:
 					case node_operation::mod:
+						_type_id = are_integer_operands(*_children[0], *_children[1]) ? integer_handle : number_handle;
+						_lvalue = false;
+						_children[0]->check_conversion(_type_id, false);
+						_children[1]->check_conversion(_type_id, false);
+					break;
 					case node_operation::band:
+					case node_operation::bor:
+					case node_operation::bxor:
+					case node_operation::shl:
+					case node_operation::shr:
+						_type_id = integer_handle;
+						_lvalue = false;
+						_children[0]->check_conversion(integer_handle, false);
+						_children[1]->check_conversion(integer_handle, false);
+					break;
 					case node_operation::land:
 					case node_operation::lor:
 						_type_id = number_handle;
@@ -130,7 +231,12 @@ namespace Gisel
 					case node_operation::ge:
 						_type_id = number_handle;
 						_lvalue = false;
-						if(!_children[0]->is_number() || !_children[1]->is_number())
+						if(is_integer(*_children[0]) || is_integer(*_children[1]))
+						{
+							_children[0]->check_conversion(number_handle, false);
+							_children[1]->check_conversion(number_handle, false);
+						}
+						else if(!_children[0]->is_number() || !_children[1]->is_number())
 						{
 							_children[0]->check_conversion(string_handle, false);
 							_children[1]->check_conversion(string_handle, false);
@@ -146,16 +252,18 @@ namespace Gisel
 						_lvalue = true;
 						_children[0]->check_conversion(_type_id, true);
 						_children[1]->check_conversion(_type_id, false);
+						log_lvalue_writes(context, *_children[0]);
 					break;
 					case node_operation::add_assign:
 					case node_operation::sub_assign:
 					case node_operation::mul_assign:
 					case node_operation::div_assign:
 					case node_operation::mod_assign:
-						_type_id = number_handle;
+						_type_id = is_integer(*_children[0]) ? integer_handle : number_handle;
 						_lvalue = true;
-						_children[0]->check_conversion(number_handle, true);
-						_children[1]->check_conversion(number_handle, false);
+						_children[0]->check_conversion(_type_id, true);
+						_children[1]->check_conversion(_type_id, false);
+						log_lvalue_writes(context, *_children[0], value == node_operation::add_assign || value == node_operation::sub_assign);
 					break;
 					case node_operation::comma:
 						for(int i = 0; i < int(_children.size()) - 1; ++i)
@@ -165,24 +273,31 @@ namespace Gisel
 					break;
 					case node_operation::ternary:
 						_children[0]->check_conversion(number_handle, false);
-						if(is_convertible(_children[2]->get_type_id(), _children[2]->is_lvalue(), _children[1]->get_type_id(), _children[1]->is_lvalue()))
+						// a num variable and an int variable make a num value, not a variable of either type
+						_lvalue = _children[1]->is_lvalue() && _children[2]->is_lvalue() && _children[1]->get_type_id() == _children[2]->get_type_id();
+						if(is_convertible(_children[2]->get_type_id(), _children[2]->is_lvalue(), _children[1]->get_type_id(), _lvalue))
 						{
-							_children[2]->check_conversion(_children[1]->get_type_id(), _children[1]->is_lvalue());
+							_children[2]->check_conversion(_children[1]->get_type_id(), _lvalue);
 							_type_id = _children[1]->get_type_id();
-							_lvalue = _children[1]->is_lvalue();
 						}
 						else
 						{
-							_children[1]->check_conversion(_children[2]->get_type_id(), _children[2]->is_lvalue());
+							_children[1]->check_conversion(_children[2]->get_type_id(), _lvalue);
 							_type_id = _children[2]->get_type_id();
-							_lvalue = _children[2]->is_lvalue();
 						}
 					break;
 					case node_operation::call:
+						// to_str of an int goes to int_to_str, which prints all of its 64 bits instead of the widened double
+						if(_children.size() == 2 && _children[0]->is_identifier() && _children[0]->get_identifier() == "to_str" && _children[1]->get_type_id() == integer_handle && context.find("int_to_str"))
+							_children[0] = std::make_unique<node>(context, identifier{"int_to_str"}, std::vector<node_ptr>(), _children[0]->get_line_number());
 						if(const function_type* ft = std::get_if<function_type>(_children[0]->get_type_id()))
 						{
 							_type_id = ft->return_type_id;
 							_lvalue = false;
+							if(_children[0]->is_identifier())
+								context.log_call(context.find(std::string(_children[0]->get_identifier())), std::string(_children[0]->get_identifier()), _line_number);
+							else
+								context.log_call(nullptr, "", _line_number);
 							if(ft->param_type_id.size() + 1 != _children.size())
 								semantic_error(std::string("wrong number of arguments. Expected " + std::to_string(ft->param_type_id.size()) + ", given " + std::to_string(_children.size() - 1)).c_str(), _line_number).expose();
 							for(size_t i = 0; i < ft->param_type_id.size(); ++i)
@@ -190,6 +305,8 @@ namespace Gisel
 								if(_children[i+1]->is_lvalue() && !ft->param_type_id[i].by_ref)
 									semantic_error("reference passed to a function that did not expect one", _children[i + 1]->get_line_number()).expose();
 								_children[i+1]->check_conversion(ft->param_type_id[i].type_id, ft->param_type_id[i].by_ref);
+								if(ft->param_type_id[i].by_ref)
+									log_lvalue_writes(context, *_children[i+1]);
 							}
 						}
 						else
@@ -199,6 +316,24 @@ namespace Gisel
 							semantic_error(std::string(to_string(_children[0]->_type_id) + " is not callable").c_str(), _line_number).expose();
 						}
 					break;
+					case node_operation::spawn:
+						if(const function_type* ft = std::get_if<function_type>(_children[0]->get_type_id()))
+						{
+							// the task runs in a context of its own, which cannot reach the variables of this one
+							_type_id = context.get_handle(function_type{ft->return_type_id, {}});
+							_lvalue = false;
+							if(ft->param_type_id.size() + 1 != _children.size())
+								semantic_error(std::string("wrong number of arguments. Expected " + std::to_string(ft->param_type_id.size()) + ", given " + std::to_string(_children.size() - 1)).c_str(), _line_number).expose();
+							for(size_t i = 0; i < ft->param_type_id.size(); ++i)
+							{
+								if(ft->param_type_id[i].by_ref)
+									semantic_error("a function taking references cannot be spawned", _line_number).expose();
+								_children[i+1]->check_conversion(ft->param_type_id[i].type_id, false);
+							}
+						}
+						else
+							semantic_error(std::string(to_string(_children[0]->_type_id) + " cannot be spawned").c_str(), _line_number).expose();
+					break;
 					case node_operation::import:
 						std::cout << "test" << std::endl;
 						_children[1]->check_conversion(string_handle, false);
@@ -27,6 +27,7 @@
 #include "type.h"
 #include "compiler_context.h"
 #include "errors.h"
+#include "node_arena.h"
 
 namespace Gisel
 {
@@ -41,7 +42,9 @@ namespace Gisel
 		positive,
 		negative,
 		bnot,
-		lnot,    
+		lnot,
+		to_integer,
+		to_number,
 
 		add,
 		sub,
@@ -55,6 +58,10 @@ namespace Gisel
 		div_assign,
 		mod_assign,
 		band,
+		bor,
+		bxor,
+		shl,
+		shr,
 		eq,
 		ne,
 		lt,
@@ -68,6 +75,7 @@ namespace Gisel
 		ternary,
 
 		call,
+		spawn,
 
 		import
 	};
@@ -77,7 +85,7 @@ namespace Gisel
 
 	using node_value = std::variant<node_operation, std::string, double, identifier>;
 
-	struct node
+	struct node : arena_object
 	{
 		node(compiler_context& context, node_value value, std::vector<node_ptr> children, size_t line_number);
 		
@@ -93,6 +101,7 @@ namespace Gisel
 		inline double get_number() const { return std::get<double>(_value); }
 		inline std::string_view get_string() const { return std::get<std::string>(_value); }
 		inline const std::vector<node_ptr>& get_children() const { return _children; }
+		inline std::vector<node_ptr>& get_children() { return _children; }
 		inline type_handle get_type_id() const { return _type_id; }
 
 		inline bool is_lvalue() const { return _lvalue; }
@@ -109,6 +118,9 @@ namespace Gisel
 			bool _lvalue;
 			size_t _line_number;
 	};
+
+	// number literals that can initialize an int, such as 3 or -1
+	bool is_integral_literal(const node& n);
 }
 
 #endif // __EXPRESSION_TREE__
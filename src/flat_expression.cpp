@@ -0,0 +1,260 @@
+/**
+ * This file is a part of the Gisel Interpreter
+ *
+ * Copyright (C) 2022 @kbz_8
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "flat_expression.h"
+#include <cstdint>
+#include <vector>
+#include "expression_tree.h"
+#include "compiler_context.h"
+#include "runtime_context.h"
+
+namespace Gisel
+{
+	namespace
+	{
+		enum struct flat_opcode : std::uint32_t
+		{
+			constant,
+			local,
+			leaf,
+			negative,
+			add,
+			sub,
+			mul,
+			div,
+		};
+
+		// 16 bytes: a constant is stored in the instruction itself
+		struct flat_instruction
+		{
+			flat_opcode op;
+			union
+			{
+				number constant;
+				struct
+				{
+					std::uint32_t a;
+					std::uint32_t b;
+				} operands;
+				std::int32_t local;
+				std::uint32_t leaf;
+			};
+		};
+
+		// the instructions of an expression fill one block of the arena
+		constexpr const size_t max_instructions = 32;
+
+		class flat_number_expression: public expression<number>
+		{
+			public:
+				flat_number_expression(std::uint64_t* evaluated_nodes) : _evaluated_nodes(evaluated_nodes) {}
+
+				number evaluate(runtime_context& context) const override
+				{
+					number results[max_instructions];
+					const flat_instruction* code = _code.data();
+					const size_t size = _code.size();
+
+					for(size_t i = 0; i < size; ++i)
+					{
+						const flat_instruction& in = code[i];
+						switch(in.op)
+						{
+							case flat_opcode::constant: results[i] = in.constant; break;
+							case flat_opcode::local: results[i] = static_cast<const variable_impl<number>*>(context.local(in.local).get())->value; break;
+							case flat_opcode::leaf: results[i] = _leaves[in.leaf]->evaluate(context); break;
+							case flat_opcode::negative: results[i] = -results[in.operands.a]; break;
+							case flat_opcode::add: results[i] = results[in.operands.a] + results[in.operands.b]; break;
+							case flat_opcode::sub: results[i] = results[in.operands.a] - results[in.operands.b]; break;
+							case flat_opcode::mul: results[i] = results[in.operands.a] * results[in.operands.b]; break;
+							case flat_opcode::div: results[i] = results[in.operands.a] / results[in.operands.b]; break;
+						}
+					}
+
+					if(_evaluated_nodes)
+						*_evaluated_nodes += size;
+
+					return results[size - 1];
+				}
+
+				std::uint32_t emit(flat_instruction in)
+				{
+					_code.push_back(in);
+					return std::uint32_t(_code.size() - 1);
+				}
+
+				std::uint32_t add_leaf(expression<number>::ptr leaf)
+				{
+					_leaves.push_back(std::move(leaf));
+					return std::uint32_t(_leaves.size() - 1);
+				}
+
+			private:
+				std::vector<flat_instruction, arena_allocator<flat_instruction> > _code;
+				std::vector<expression<number>::ptr, arena_allocator<expression<number>::ptr> > _leaves;
+				std::uint64_t* _evaluated_nodes;
+		};
+
+		bool is_flat_operation(const node_ptr& np)
+		{
+			if(!np->is_node_operation() || np->get_type_id() != type_registry::get_number_handle())
+				return false;
+
+			switch(np->get_node_operation())
+			{
+				case node_operation::positive:
+				case node_operation::negative:
+				case node_operation::add:
+				case node_operation::sub:
+				case node_operation::mul:
+				case node_operation::div:
+					return true;
+				default:
+					return false;
+			}
+		}
+
+		// whether evaluating np may do more than compute a value: call a function, write a variable,
+		// or run the initializer of a lazy global
+		bool has_effects(compiler_context& context, const node_ptr& np)
+		{
+			if(np->is_identifier())
+				return context.get_options().lazy_globals && context.find(std::string(np->get_identifier()))->get_scope() == identifier_scope::global_variable;
+			if(!np->is_node_operation())
+				return false;
+
+			switch(np->get_node_operation())
+			{
+				case node_operation::preinc:
+				case node_operation::predec:
+				case node_operation::postinc:
+				case node_operation::postdec:
+				case node_operation::assign:
+				case node_operation::add_assign:
+				case node_operation::sub_assign:
+				case node_operation::mul_assign:
+				case node_operation::div_assign:
+				case node_operation::mod_assign:
+				case node_operation::call:
+				case node_operation::spawn:
+				case node_operation::import:
+					return true;
+				default:
+					break;
+			}
+
+			for(const node_ptr& child : np->get_children())
+				if(has_effects(context, child))
+					return true;
+			return false;
+		}
+
+		// the number of operations of the arithmetic of np, of the instructions it takes, and of its leaves with effects
+		void measure(compiler_context& context, const node_ptr& np, size_t& operations, size_t& instructions, size_t& effects)
+		{
+			if(!is_flat_operation(np))
+			{
+				++instructions;
+				if(has_effects(context, np))
+					++effects;
+				return;
+			}
+
+			if(np->get_node_operation() != node_operation::positive)
+			{
+				++operations;
+				++instructions;
+			}
+
+			for(const node_ptr& child : np->get_children())
+				measure(context, child, operations, instructions, effects);
+		}
+
+		bool is_local_number(compiler_context& context, const node_ptr& np)
+		{
+			if(!np->is_identifier() || np->get_type_id() != type_registry::get_number_handle())
+				return false;
+			const identifier_info* info = context.find(std::string(np->get_identifier()));
+			return info->get_scope() == identifier_scope::local_variable;
+		}
+
+		std::uint32_t flatten(compiler_context& context, const node_ptr& np, flat_number_expression& expr)
+		{
+			flat_instruction in{};
+
+			if(np->is_number())
+			{
+				in.op = flat_opcode::constant;
+				in.constant = std::get<double>(np->get_value());
+				return expr.emit(in);
+			}
+
+			if(is_local_number(context, np))
+			{
+				in.op = flat_opcode::local;
+				in.local = std::int32_t(context.find(std::string(np->get_identifier()))->index());
+				return expr.emit(in);
+			}
+
+			if(!is_flat_operation(np))
+			{
+				in.op = flat_opcode::leaf;
+				in.leaf = expr.add_leaf(build_number_expression(context, np));
+				return expr.emit(in);
+			}
+
+			const std::vector<node_ptr>& children = np->get_children();
+
+			switch(np->get_node_operation())
+			{
+				case node_operation::positive: return flatten(context, children[0], expr);
+				case node_operation::negative:
+					in.op = flat_opcode::negative;
+					in.operands.a = flatten(context, children[0], expr);
+					return expr.emit(in);
+				case node_operation::add: in.op = flat_opcode::add; break;
+				case node_operation::sub: in.op = flat_opcode::sub; break;
+				case node_operation::mul: in.op = flat_opcode::mul; break;
+				default: in.op = flat_opcode::div; break;
+			}
+
+			in.operands.a = flatten(context, children[0], expr);
+			in.operands.b = flatten(context, children[1], expr);
+			return expr.emit(in);
+		}
+	}
+
+	expression<number>::ptr build_flat_number_expression(compiler_context& context, const node_ptr& np)
+	{
+		if(!is_flat_operation(np))
+			return nullptr;
+
+		// a single operation is as fast in the tree, and a larger expression is flattened in pieces; the leaves
+		// run in post-order, the tree may run them in another, so two leaves with effects are left to the tree
+		size_t operations = 0;
+		size_t instructions = 0;
+		size_t effects = 0;
+		measure(context, np, operations, instructions, effects);
+		if(operations < 2 || instructions > max_instructions || effects > 1)
+			return nullptr;
+
+		auto expr = std::make_unique<flat_number_expression>(context.get_options().evaluated_nodes);
+		flatten(context, np, *expr);
+		return expr;
+	}
+}
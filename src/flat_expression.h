@@ -0,0 +1,37 @@
+/**
+ * This file is a part of the Gisel Interpreter
+ *
+ * Copyright (C) 2022 @kbz_8
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef __FLAT_EXPRESSION__
+#define __FLAT_EXPRESSION__
+
+#include <memory>
+#include "expression.h"
+
+namespace Gisel
+{
+	struct node;
+	class compiler_context;
+
+	using node_ptr = std::unique_ptr<node>;
+
+	// builds the arithmetic of np as one array of instructions in post-order, the operands of an instruction
+	// being the indices of earlier ones; null when np is no arithmetic on numbers or too small to gain from it
+	expression<number>::ptr build_flat_number_expression(compiler_context& context, const node_ptr& np);
+}
+
+#endif // __FLAT_EXPRESSION__
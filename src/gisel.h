@@ -30,12 +30,32 @@
 #include "type.h"
 #include "expression_tree.h"
 #include "parser.h"
+#include "optimizer.h"
+#include "passes.h"
+#include "range_analysis.h"
+#include "loop_analysis.h"
 #include "compiler_context.h"
 #include "variable.h"
+#include "node_arena.h"
+#include "value_pool.h"
 #include "expression.h"
+#include "flat_expression.h"
+#include "program.h"
 #include "runtime_context.h"
+#include "worker_pool.h"
+#include "scheduler.h"
+#include "task.h"
+#include "channel.h"
 #include "compiler.h"
 #include "incomplete_function.h"
+#include "escape_analysis.h"
+#include "jit.h"
+#include "tiering.h"
+#include "branch_profile.h"
+#include "perf_counters.h"
+#include "arithmetic.h"
+#include "cpp_emitter.h"
+#include "native_module.h"
 #include <gisel_api.h>
 #include "builtin_functions.h"
 #include "statement.h"
@@ -19,20 +19,35 @@
 
 #include <vector>
 #include <cstdio>
+#include <cstdint>
+#include <fstream>
 #include <gisel_api.h>
 #include "errors.h"
 #include "streamstack.h"
 #include "lexer.h"
 #include "compiler.h"
+#include "cpp_emitter.h"
+#include "native_module.h"
+#include "branch_profile.h"
+#include "passes.h"
+#include "compiler_context.h"
 #include "file.h"
 #include "tk_iterator.h"
+#include "incomplete_function.h"
+#include "worker_pool.h"
+#include "scheduler.h"
 
 namespace Gisel
 {
 	class Module_impl
 	{
 		public:
-			Module_impl() {}
+			Module_impl() { _options.passes = &_passes; }
+			~Module_impl()
+			{
+				stop_workers();
+				wait_for_tasks();
+			}
 			
 			inline runtime_context* get_runtime_context() { return _context.get(); }
 			
@@ -46,25 +61,199 @@ namespace Gisel
 			
 			inline void load(const char* path)
 			{
+				stop_workers();
+				wait_for_tasks();
 				File f(path);
-				get_character get = [&](){ return f(); };
+				
+				// the program depends on its source and on the declarations of the host
+				std::uint64_t hash = fnv_offset_basis;
+				for(const auto& p : _external_functions)
+					hash = hash_bytes(hash, p.first.c_str(), p.first.size() + 1);
+				for(const std::string& declaration : _public_declarations)
+					hash = hash_bytes(hash, declaration.c_str(), declaration.size() + 1);
+				
+				get_character get = [&]()
+				{
+					int c = f();
+					if(c != EOF)
+					{
+						char byte = char(c);
+						hash = hash_bytes(hash, &byte, 1);
+					}
+					return c;
+				};
 				StreamStack stream(&get);
 				
 				tk_iterator it(stream);
 				
-				_context = std::make_unique<runtime_context>(compile(it, _external_functions, _public_declarations));
+				compiler_options options = _options;
+				options.deferred_globals = !_state_path.empty();
+				
+				node_arena::scope arena(_arena);
+				_context = std::make_unique<runtime_context>(compile(it, _external_functions, _public_declarations, options, &_storage_stats));
+				_program_hash = hash;
+				
+				if(options.deferred_globals)
+				{
+					std::ifstream in(_state_path, std::ios::binary);
+					if(!in || !_context->restore_globals(in, _program_hash))
+						_context->initialize();
+				}
+				_context->capture_globals();
+				
+				for(const auto& p : _public_functions)
+					*p.second = _context->get_public_function(p.first.c_str());
+			}
+			
+			inline void load_native(const char* path)
+			{
+				stop_workers();
+				wait_for_tasks();
+				_context = std::make_unique<runtime_context>(load_native_module(path, _external_functions, _public_declarations, _native_module));
 				
 				for(const auto& p : _public_functions)
 					*p.second = _context->get_public_function(p.first.c_str());
 			}
 			
-			inline void reset_globals() { if(_context) _context->initialize(); }
+			inline void emit_cpp(const char* path, std::ostream& out)
+			{
+				File f(path);
+				get_character get = [&](){ return f(); };
+				StreamStack stream(&get);
+				
+				tk_iterator it(stream);
+				
+				node_arena::scope arena(_arena);
+				Gisel::emit_cpp(it, _external_functions, _public_declarations, out);
+			}
+			
+			inline void set_jit_enabled(bool enabled) noexcept { _options.jit = enabled; }
+			inline void set_tiering_enabled(bool enabled) noexcept { _options.tiering = enabled; }
+			inline void set_unchecked(bool unchecked) noexcept { _options.unchecked = unchecked; }
+			inline void set_lazy_globals(bool lazy) noexcept { _options.lazy_globals = lazy; }
+			inline void set_branch_profiling(bool enabled) noexcept { _options.branch_counters = enabled ? &_branch_counters : nullptr; }
+			inline void write_branch_profile(std::ostream& out) const { _branch_counters.write(out); }
+			
+			inline void read_branch_profile(std::istream& in)
+			{
+				_branch_weights.read(in);
+				_options.branch_weights = &_branch_weights;
+			}
+
+			inline void set_optimization_level(int level)
+			{
+				if(level < 0 || level > pass_manager::max_level)
+					Error("invalid optimization level " + std::to_string(level), -2).expose();
+				_passes.set_level(level);
+			}
+			
+			inline void set_pass_enabled(const char* name, bool enabled)
+			{
+				if(!_passes.set_enabled(name, enabled))
+					Error(std::string("unknown pass ") + name, -2).expose();
+			}
+			
+			inline void write_pass_timings(std::ostream& out) const { _passes.write_timings(out); }
+			
+			inline void set_node_counting(bool enabled) noexcept { _options.evaluated_nodes = enabled ? &_evaluated_nodes : nullptr; }
+			inline std::uint64_t get_evaluated_nodes() const noexcept { return _evaluated_nodes; }
+
+			inline void reset_globals() { if(_context) _context->reset_globals(); }
+			
+			inline void save_state(const char* path) const
+			{
+				if(!_context || !_context->has_snapshot())
+					Error("no module is loaded", -2).expose();
+				
+				std::ofstream out(path, std::ios::binary);
+				if(!out)
+					Error(std::string("cannot write ") + path, -2).expose();
+				_context->save_globals(out, _program_hash);
+			}
+			
+			inline void restore_state(const char* path) { _state_path = path; }
+			
+			inline std::unique_ptr<runtime_context> clone_context() const
+			{
+				if(!_context)
+					Error("no module is loaded", -2).expose();
+				if(!_context->has_snapshot())
+					Error("the globals of a native module cannot be cloned", -2).expose();
+				return std::make_unique<runtime_context>(_context->clone());
+			}
+
+			inline void start_workers(size_t threads, size_t queue_capacity)
+			{
+				if(threads == 0 || queue_capacity == 0)
+					Error("a worker pool needs a thread and room for a call", -2).expose();
+				std::unique_ptr<runtime_context> prototype = clone_context();
+				_workers.reset();
+				_workers = std::make_unique<worker_pool>(*prototype, threads, queue_capacity);
+			}
+			
+			inline void stop_workers() { _workers.reset(); }
+			
+			// the tasks spawned by the scripts run the program of _context, which must outlive them
+			inline void wait_for_tasks()
+			{
+				if(!_context)
+					return;
+				const program& p = *_context->get_program();
+				scheduler::instance().help_until([&]() { return p.running_tasks() == 0; });
+			}
+			
+			inline const function& find_public_function(const std::string& declaration) const
+			{
+				if(!_context)
+					Error("no module is loaded", -2).expose();
+				
+				compiler_context ctx;
+				function_declaration decl = parse_function_declaration(ctx, declaration);
+				const function* f = _context->get_program()->find_public_function(decl.name, std::to_string(decl.type_id));
+				if(!f)
+					Error("no public function " + declaration, -2).expose();
+				return *f;
+			}
+			
+			inline void submit_async(std::vector<function> tasks)
+			{
+				if(!_workers)
+					Error("the workers are not started", -2).expose();
+				_workers->submit(std::move(tasks));
+			}
+
+			inline void dump_storage_stats(std::ostream& out) const
+			{
+				for(const auto& p : _storage_stats)
+					out << p.first << ": " << p.second.boxed << " boxed, " << p.second.unboxed << " unboxed locals" << std::endl;
+			}
 
 		private:
+			// the compiled program lives in these two, declared first to outlive everything holding a function
+			node_arena _arena;
+			std::shared_ptr<void> _native_module;
 			std::vector<std::pair<std::string, function> > _external_functions;
 			std::vector<std::string> _public_declarations;
 			std::unordered_map<std::string, std::shared_ptr<function> > _public_functions;
+			branch_profile _branch_counters;
+			branch_profile _branch_weights;
+			std::uint64_t _evaluated_nodes = 0;
+			pass_manager _passes;
 			std::unique_ptr<runtime_context> _context;
+			compiler_options _options;
+			std::vector<std::pair<std::string, storage_stats> > _storage_stats;
+			std::string _state_path;
+			std::uint64_t _program_hash = 0;
+			std::unique_ptr<worker_pool> _workers; // runs in contexts cloned from _context, destroyed first
+			
+			static constexpr const std::uint64_t fnv_offset_basis = 14695981039346656037ull;
+			
+			static inline std::uint64_t hash_bytes(std::uint64_t hash, const char* bytes, size_t size) noexcept
+			{
+				for(size_t i = 0; i < size; ++i)
+					hash = (hash ^ std::uint8_t(bytes[i])) * 1099511628211ull;
+				return hash;
+			}
 	};
 
 	Module::Module() : _impl(std::make_unique<Module_impl>()) {}
@@ -72,8 +261,40 @@ namespace Gisel
 	runtime_context* Module::get_runtime_context() { return _impl->get_runtime_context(); }
 	void Module::add_external_function_impl(std::string declaration, function f) { _impl->add_external_function_impl(std::move(declaration), std::move(f)); }
 	void Module::add_public_function_declaration(std::string declaration, std::string name, std::shared_ptr<function> fptr) { _impl->add_public_function_declaration(std::move(declaration), std::move(name), std::move(fptr)); }
+	void Module::set_jit_enabled(bool enabled) { _impl->set_jit_enabled(enabled); }
+	void Module::set_tiering_enabled(bool enabled) { _impl->set_tiering_enabled(enabled); }
+	void Module::set_unchecked(bool unchecked) { _impl->set_unchecked(unchecked); }
+	void Module::set_lazy_globals(bool lazy) { _impl->set_lazy_globals(lazy); }
+	void Module::set_branch_profiling(bool enabled) { _impl->set_branch_profiling(enabled); }
+	void Module::write_branch_profile(std::ostream& out) const { _impl->write_branch_profile(out); }
+	void Module::read_branch_profile(std::istream& in) { _impl->read_branch_profile(in); }
+	void Module::set_optimization_level(int level) { _impl->set_optimization_level(level); }
+	void Module::set_pass_enabled(const char* name, bool enabled) { _impl->set_pass_enabled(name, enabled); }
+	void Module::write_pass_timings(std::ostream& out) const { _impl->write_pass_timings(out); }
+	void Module::set_node_counting(bool enabled) { _impl->set_node_counting(enabled); }
+	std::uint64_t Module::get_evaluated_nodes() const { return _impl->get_evaluated_nodes(); }
 	void Module::load(const char* path) { _impl->load(path); }
+	std::unique_ptr<runtime_context> Module::clone_context() const { return _impl->clone_context(); }
+	void Module::load_native(const char* path) { _impl->load_native(path); }
+	void Module::emit_cpp(const char* path, std::ostream& out) { _impl->emit_cpp(path, out); }
 	void Module::reset_globals() { _impl->reset_globals(); }
+	void Module::save_state(const char* path) const { _impl->save_state(path); }
+	void Module::restore_state(const char* path) { _impl->restore_state(path); }
+	void Module::start_workers(size_t threads, size_t queue_capacity) { _impl->start_workers(threads, queue_capacity); }
+	void Module::stop_workers() { _impl->stop_workers(); }
+	const function& Module::find_public_function(const std::string& declaration) const { return _impl->find_public_function(declaration); }
+	void Module::submit_async(std::vector<function> tasks) { _impl->submit_async(std::move(tasks)); }
+	void Module::set_parallel_threads(size_t threads) { scheduler::instance().set_threads(threads); }
+	integer Module::open_number_channel(size_t capacity) { return open_channel<number>(capacity); }
+	integer Module::open_string_channel(size_t capacity) { return open_channel<std::string>(capacity); }
+	void Module::send(integer channel, number value) { send_to_channel<number>(channel, value); }
+	void Module::send(integer channel, std::string value) { send_to_channel<std::string>(channel, std::move(value)); }
+	bool Module::recv(integer channel, number& value) { return recv_from_channel<number>(channel, value) == channel_status::received; }
+	bool Module::recv(integer channel, std::string& value) { return recv_from_channel<std::string>(channel, value) == channel_status::received; }
+	channel_status Module::try_recv(integer channel, number& value) { return try_recv_from_channel<number>(channel, value); }
+	channel_status Module::try_recv(integer channel, std::string& value) { return try_recv_from_channel<std::string>(channel, value); }
+	void Module::close_channel(integer channel) { Gisel::close_channel(channel); }
+	void Module::dump_storage_stats(std::ostream& out) const { _impl->dump_storage_stats(out); }
 
 	Module::~Module() {}
 }
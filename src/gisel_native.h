@@ -0,0 +1,112 @@
+/**
+ * This file is a part of the Gisel Interpreter
+ *
+ * Copyright (C) 2022 @kbz_8
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef __GISEL_NATIVE__
+#define __GISEL_NATIVE__
+
+#include <cstddef>
+#include <vector>
+#include "variable.h"
+#include "arithmetic.h"
+
+// runtime of the C++ emitted by giseli --emit-cpp; the shared object only
+// reaches the interpreter through the host interface it is given on load
+
+namespace Gisel
+{
+	namespace native
+	{
+		constexpr const int abi_version = 1;
+
+		struct host_interface
+		{
+			variable_ptr (*box_number)(number value);
+			variable_ptr (*box_integer)(integer value);
+			variable_ptr (*box_string)(string value);
+			variable_ptr& (*local)(runtime_context& context, int idx);
+			variable_ptr& (*retval)(runtime_context& context);
+			variable_ptr (*call)(runtime_context& context, int idx, std::vector<variable_ptr> params);
+		};
+
+		// name and type (as printed by the compiler) of a function the module imports or exports
+		struct function_info
+		{
+			const char* name;
+			const char* type;
+			void (*entry)(runtime_context& context);
+		};
+
+		struct module_info
+		{
+			int version;
+			const function_info* externals;
+			size_t externals_count;
+			const function_info* publics;
+			size_t publics_count;
+			void (*initialize)(runtime_context& context);
+		};
+
+		using module_entry = const module_info* (*)(const host_interface* host);
+
+		inline const host_interface* host = nullptr;
+
+		inline variable_ptr box(number value) { return host->box_number(value); }
+		inline variable_ptr box(integer value) { return host->box_integer(value); }
+		inline variable_ptr box(string value) { return host->box_string(std::move(value)); }
+
+		template <typename T>
+		inline T& value_of(const variable_ptr& v) { return static_cast<variable_impl<T>&>(*v).value; }
+
+		template <typename T>
+		inline T& param(runtime_context& context, int i) { return value_of<T>(host->local(context, -1 - i)); }
+
+		template <typename T>
+		inline void set_retval(runtime_context& context, T value) { host->retval(context) = box(std::move(value)); }
+
+		// external functions are called through the interpreter, which owns them
+		template <typename R, typename... Args>
+		R call(runtime_context& context, int idx, Args... args)
+		{
+			variable_ptr ret = host->call(context, idx, {box(std::move(args))...});
+			if constexpr(!std::is_void<R>::value)
+				return value_of<R>(ret);
+		}
+
+		template <typename T> inline T& preinc(T& t) { return t = add(t, T(1)); }
+		template <typename T> inline T& predec(T& t) { return t = sub(t, T(1)); }
+		template <typename T> inline T postinc(T& t) { T old = t; t = add(old, T(1)); return old; }
+		template <typename T> inline T postdec(T& t) { T old = t; t = sub(old, T(1)); return old; }
+
+		template <typename T> inline T& add_assign(T& t1, T t2) { return t1 = add(t1, t2); }
+		template <typename T> inline T& sub_assign(T& t1, T t2) { return t1 = sub(t1, t2); }
+		template <typename T> inline T& mul_assign(T& t1, T t2) { return t1 = mul(t1, t2); }
+		template <typename T> inline T& div_assign(T& t1, T t2) { return t1 = div(t1, t2); }
+		template <typename T> inline T& mod_assign(T& t1, T t2) { return t1 = mod(t1, t2); }
+
+		template <typename T> inline number eq(const T& t1, const T& t2) { return !lt(t1, t2) && !lt(t2, t1); }
+		template <typename T> inline number ne(const T& t1, const T& t2) { return lt(t1, t2) || lt(t2, t1); }
+		template <typename T> inline number gt(const T& t1, const T& t2) { return lt(t2, t1); }
+		template <typename T> inline number le(const T& t1, const T& t2) { return !lt(t2, t1); }
+		template <typename T> inline number ge(const T& t1, const T& t2) { return !lt(t1, t2); }
+
+		inline integer shl(integer t1, integer t2) { return integer(std::uint64_t(t1) << (t2 & 63)); }
+		inline integer shr(integer t1, integer t2) { return t1 >> (t2 & 63); }
+	}
+}
+
+#endif // __GISEL_NATIVE__
@@ -24,6 +24,9 @@
 #include "lexer.h"
 #include "tk_iterator.h"
 #include "runtime_context.h"
+#include "streamstack.h"
+#include "escape_analysis.h"
+#include "jit.h"
 
 namespace Gisel
 {
@@ -81,6 +84,14 @@ namespace Gisel
 		return ret;
 	}
 
+	function_declaration parse_function_declaration(compiler_context& ctx, const std::string& declaration)
+	{
+		get_character get = [i = size_t(0), &declaration]() mutable { return i < declaration.size() ? int(declaration[i++]) : -1; };
+		StreamStack stream(&get);
+		tk_iterator it(stream);
+		return parse_function_declaration(ctx, it);
+	}
+
 	incomplete_function::incomplete_function(compiler_context& ctx, tk_iterator& it)
 	{
 		_decl = parse_function_declaration(ctx, it);
@@ -109,16 +120,36 @@ namespace Gisel
 		ctx.create_function(_decl.name, _decl.type_id);
 	}
 
-	incomplete_function::incomplete_function(incomplete_function&& orig) noexcept : _tokens(std::move(orig._tokens)), _decl(std::move(orig._decl)) {}
+	incomplete_function::incomplete_function(incomplete_function&& orig) noexcept : _tokens(std::move(orig._tokens)), _decl(std::move(orig._decl)), _storage_stats(orig._storage_stats) {}
 
 	function incomplete_function::compile(compiler_context& ctx)
 	{
-		auto _ = ctx.function();
-		const function_type* ft = std::get_if<function_type>(_decl.type_id);
-		for(int i = 0; i < int(_decl.params.size()); ++i)
-			ctx.create_param(std::move(_decl.params[i]), ft->param_type_id[i].type_id);
-		tk_iterator it(_tokens);
-		shared_statement_ptr stmt = compile_function_block(ctx, it, ft->return_type_id);
+		// compiling consumes the tokens, they are kept when tiering builds the function again
+		std::deque<Token> tokens = ctx.get_options().tiering ? _tokens : std::move(_tokens);
+
+		// the tree is always built, it reports the errors and is the fallback of the jit; the jit does not
+		// count the branches taken, so the functions stay trees while they are profiled
+		const bool jit = ctx.get_options().jit && !ctx.get_options().branch_counters;
+		std::deque<Token> jit_tokens;
+		if(jit)
+			jit_tokens = tokens;
+
+		shared_statement_ptr stmt;
+		{
+			auto _ = ctx.function(ctx.find(_decl.name));
+			ctx.set_referenced_names(find_referenced_names(tokens));
+			const function_type* ft = std::get_if<function_type>(_decl.type_id);
+			for(int i = 0; i < int(_decl.params.size()); ++i)
+				ctx.create_param(_decl.params[i], ft->param_type_id[i].type_id, ft->param_type_id[i].by_ref);
+			tk_iterator it(tokens);
+			stmt = compile_function_block(ctx, it, ft->return_type_id);
+			_storage_stats = ctx.get_storage_stats();
+		}
+
+		if(jit)
+			if(function f = jit_compile(ctx, _decl, std::move(jit_tokens)))
+				return f;
+
 		return [stmt=std::move(stmt)] (runtime_context& ctx) { stmt->execute(ctx); };
 	}
 }
@@ -22,6 +22,7 @@
 
 #include "tokens.h"
 #include "type.h"
+#include "compiler_context.h"
 #include <deque>
 #include "function.h"
 
@@ -40,6 +41,7 @@ namespace Gisel
 	};
 
 	function_declaration parse_function_declaration(compiler_context& ctx, tk_iterator& it);
+	function_declaration parse_function_declaration(compiler_context& ctx, const std::string& declaration);
 
 	class incomplete_function
 	{
@@ -47,10 +49,13 @@ namespace Gisel
 			incomplete_function(compiler_context& ctx, tk_iterator& it);
 			incomplete_function(incomplete_function&& orig) noexcept;
 			inline const function_declaration& get_decl() const noexcept { return _decl; }
+			inline const storage_stats& get_storage_stats() const noexcept { return _storage_stats; }
+			inline const std::deque<Token>& get_tokens() const noexcept { return _tokens; }
 			function compile(compiler_context& ctx);
 
 		private:
 			function_declaration _decl;
+			storage_stats _storage_stats;
 			std::deque<Token> _tokens;
 			size_t _index;
 	};
@@ -0,0 +1,845 @@
+/**
+ * This file is a part of the Gisel Interpreter
+ *
+ * Copyright (C) 2022 @kbz_8
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "jit.h"
+#include "compiler.h"
+#include "compiler_context.h"
+#include "expression.h"
+#include "expression_tree.h"
+#include "incomplete_function.h"
+#include "runtime_context.h"
+#include "tk_iterator.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#if defined(__x86_64__) && defined(__unix__)
+	#include <sys/mman.h>
+	#include <unistd.h>
+	#define GISEL_JIT
+#endif
+
+namespace Gisel
+{
+#ifdef GISEL_JIT
+	namespace
+	{
+		struct jit_unsupported { jit_unsupported(){} };
+
+		constexpr const size_t max_jit_params = 16;
+
+		using jit_entry = double(*)(const double* args, runtime_context* context);
+
+		class executable_code
+		{
+			public:
+				executable_code(const std::vector<std::uint8_t>& code) : _size(code.size())
+				{
+					_memory = mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+					if(_memory == MAP_FAILED)
+					{
+						_memory = nullptr;
+						return;
+					}
+					std::memcpy(_memory, code.data(), _size);
+					if(mprotect(_memory, _size, PROT_READ | PROT_EXEC) != 0)
+					{
+						munmap(_memory, _size);
+						_memory = nullptr;
+					}
+				}
+
+				~executable_code() { if(_memory) munmap(_memory, _size); }
+
+				inline explicit operator bool() const noexcept { return _memory != nullptr; }
+				inline jit_entry entry() const noexcept { return reinterpret_cast<jit_entry>(_memory); }
+				inline const void* address() const noexcept { return _memory; }
+				inline size_t size() const noexcept { return _size; }
+
+			private:
+				void* _memory;
+				size_t _size;
+		};
+
+		// lets perf symbolize the generated code
+		void write_perf_map_entry(const executable_code& code, const std::string& name)
+		{
+			std::string path = "/tmp/perf-" + std::to_string(getpid()) + ".map";
+			if(std::FILE* f = std::fopen(path.c_str(), "a"))
+			{
+				std::fprintf(f, "%lx %zx gisel::%s\n", reinterpret_cast<unsigned long>(code.address()), code.size(), name.c_str());
+				std::fclose(f);
+			}
+		}
+
+		// called back by the generated code for every call, the callee may or may not be compiled itself
+		double call_function(runtime_context* context, int idx, const double* args, int count)
+		{
+			for(int i = 0; i < count; ++i)
+				context->push_value<number>(args[i]);
+
+			variable_ptr ret = context->call_pushed(context->get_function(idx), count);
+			return ret ? static_cast<const variable_impl<number>&>(*ret).value : 0.0;
+		}
+
+		class assembler
+		{
+			public:
+				using label = size_t;
+
+				inline void emit(std::initializer_list<std::uint8_t> bytes) { _code.insert(_code.end(), bytes); }
+				inline void emit32(std::uint32_t v) { for(int i = 0; i < 4; ++i) _code.push_back(std::uint8_t(v >> (8 * i))); }
+				inline void emit64(std::uint64_t v) { for(int i = 0; i < 8; ++i) _code.push_back(std::uint8_t(v >> (8 * i))); }
+				inline size_t size() const noexcept { return _code.size(); }
+
+				inline void patch32(size_t offset, std::uint32_t v) { for(int i = 0; i < 4; ++i) _code[offset + i] = std::uint8_t(v >> (8 * i)); }
+
+				inline label new_label() { _labels.push_back(0); return _labels.size() - 1; }
+				inline void bind(label l) { _labels[l] = _code.size(); }
+				inline void jump(label l) { emit({0xE9}); fixup(l); }
+				inline void jump_if(std::uint8_t condition, label l) { emit({0x0F, condition}); fixup(l); }
+
+				std::vector<std::uint8_t> finish()
+				{
+					for(const auto& [offset, l] : _fixups)
+						patch32(offset, std::uint32_t(_labels[l] - (offset + 4)));
+					return std::move(_code);
+				}
+
+			private:
+				std::vector<std::uint8_t> _code;
+				std::vector<size_t> _labels;
+				std::vector<std::pair<size_t, label> > _fixups;
+
+				inline void fixup(label l) { _fixups.emplace_back(_code.size(), l); emit32(0); }
+		};
+
+		enum jit_condition : std::uint8_t
+		{
+			jump_equal = 0x84,
+			jump_not_equal = 0x85,
+			jump_parity = 0x8A,
+		};
+
+		enum cmpsd_predicate : std::uint8_t
+		{
+			cmp_eq = 0,
+			cmp_lt = 1,
+			cmp_unord = 3,
+			cmp_neq = 4,
+			cmp_nlt = 5,
+			cmp_ord = 7,
+		};
+
+		// System V calling convention, rbx holds the frame of the function and r12 the runtime context;
+		// expressions are evaluated in xmm0, their left operands are spilled on the machine stack
+		class function_compiler
+		{
+			struct loop_labels
+			{
+				assembler::label break_label;
+				assembler::label continue_label;
+			};
+
+			public:
+				function_compiler(compiler_context& ctx, size_t params_count, type_handle return_type_id) : _ctx(ctx), _params_count(params_count), _return_type_id(return_type_id), _locals_count(0)
+				{
+					_epilogue = _asm.new_label();
+
+					_asm.emit({0x55});                   // push rbp
+					_asm.emit({0x48, 0x89, 0xE5});       // mov rbp, rsp
+					_asm.emit({0x53});                   // push rbx
+					_asm.emit({0x41, 0x54});             // push r12
+					_asm.emit({0x48, 0x81, 0xEC});       // sub rsp, frame size
+					_frame_size_offset = _asm.size();
+					_asm.emit32(0);
+					_asm.emit({0x48, 0x89, 0xE3});       // mov rbx, rsp
+					_asm.emit({0x49, 0x89, 0xF4});       // mov r12, rsi
+
+					for(size_t i = 0; i < params_count; ++i)
+					{
+						_asm.emit({0xF2, 0x0F, 0x10, 0x87}); // movsd xmm0, [rdi + 8 * i]
+						_asm.emit32(std::uint32_t(8 * i));
+						store(std::int32_t(8 * i), 0);
+					}
+				}
+
+				void compile_body(tk_iterator& it)
+				{
+					compile_block_contents(it);
+
+					load_constant(0.0, 0);
+					_asm.bind(_epilogue);
+					_asm.emit({0x48, 0x8D, 0x65, 0xF0}); // lea rsp, [rbp - 16]
+					_asm.emit({0x41, 0x5C});             // pop r12
+					_asm.emit({0x5B});                   // pop rbx
+					_asm.emit({0x5D});                   // pop rbp
+					_asm.emit({0xC3});                   // ret
+				}
+
+				std::vector<std::uint8_t> finish()
+				{
+					size_t frame_size = 8 * (_params_count + _locals_count);
+					_asm.patch32(_frame_size_offset, std::uint32_t((frame_size + 15) & ~size_t(15)));
+					return _asm.finish();
+				}
+
+			private:
+				compiler_context& _ctx;
+				assembler _asm;
+				size_t _params_count;
+				type_handle _return_type_id;
+				size_t _locals_count;
+				size_t _frame_size_offset;
+				assembler::label _epilogue;
+				std::vector<loop_labels> _loops;
+
+				// instructions
+
+				inline void sse(std::uint8_t prefix, std::uint8_t opcode, int dst, int src) { _asm.emit({prefix, 0x0F, opcode, std::uint8_t(0xC0 | (dst << 3) | src)}); }
+				inline void movapd(int dst, int src) { sse(0x66, 0x28, dst, src); }
+				inline void addsd(int dst, int src) { sse(0xF2, 0x58, dst, src); }
+				inline void subsd(int dst, int src) { sse(0xF2, 0x5C, dst, src); }
+				inline void mulsd(int dst, int src) { sse(0xF2, 0x59, dst, src); }
+				inline void divsd(int dst, int src) { sse(0xF2, 0x5E, dst, src); }
+				inline void andpd(int dst, int src) { sse(0x66, 0x54, dst, src); }
+				inline void orpd(int dst, int src) { sse(0x66, 0x56, dst, src); }
+				inline void xorpd(int dst, int src) { sse(0x66, 0x57, dst, src); }
+				inline void cmpsd(int dst, int src, cmpsd_predicate predicate) { sse(0xF2, 0xC2, dst, src); _asm.emit({predicate}); }
+
+				inline void load(std::int32_t disp, int reg) { _asm.emit({0xF2, 0x0F, 0x10, std::uint8_t(0x83 | (reg << 3))}); _asm.emit32(disp); }
+				inline void store(std::int32_t disp, int reg) { _asm.emit({0xF2, 0x0F, 0x11, std::uint8_t(0x83 | (reg << 3))}); _asm.emit32(disp); }
+
+				void load_constant(double value, int reg)
+				{
+					std::uint64_t bits;
+					std::memcpy(&bits, &value, sizeof(bits));
+					if(bits == 0)
+						return xorpd(reg, reg);
+					_asm.emit({0x48, 0xB8});             // mov rax, imm64
+					_asm.emit64(bits);
+					_asm.emit({0x66, 0x48, 0x0F, 0x6E, std::uint8_t(0xC0 | (reg << 3))}); // movq xmm, rax
+				}
+
+				inline void push()
+				{
+					_asm.emit({0x48, 0x83, 0xEC, 0x10});       // sub rsp, 16
+					_asm.emit({0xF2, 0x0F, 0x11, 0x04, 0x24}); // movsd [rsp], xmm0
+				}
+
+				// left operand in xmm0, right operand in xmm1
+				inline void pop()
+				{
+					movapd(1, 0);
+					_asm.emit({0xF2, 0x0F, 0x10, 0x04, 0x24}); // movsd xmm0, [rsp]
+					_asm.emit({0x48, 0x83, 0xC4, 0x10});       // add rsp, 16
+				}
+
+				// gisel numbers are true when they are not 0, NaN included
+				void jump_if_false(assembler::label l)
+				{
+					assembler::label skip = _asm.new_label();
+					xorpd(1, 1);
+					sse(0x66, 0x2E, 0, 1);               // ucomisd xmm0, xmm1
+					_asm.jump_if(jump_parity, skip);
+					_asm.jump_if(jump_equal, l);
+					_asm.bind(skip);
+				}
+
+				void jump_if_true(assembler::label l)
+				{
+					xorpd(1, 1);
+					sse(0x66, 0x2E, 0, 1);               // ucomisd xmm0, xmm1
+					_asm.jump_if(jump_parity, l);
+					_asm.jump_if(jump_not_equal, l);
+				}
+
+				// turns the mask of a comparison into 1 or 0
+				inline void mask_to_number()
+				{
+					load_constant(1.0, 1);
+					andpd(0, 1);
+				}
+
+				// frame
+
+				std::int32_t local_slot(const identifier_info* info)
+				{
+					int idx = int(info->index());
+					if(idx < 0)
+						return std::int32_t(8 * (-idx - 1));
+					if(size_t(idx) > _locals_count)
+						_locals_count = idx;
+					return std::int32_t(8 * (_params_count + idx - 1));
+				}
+
+				std::int32_t local_slot(const node_ptr& np)
+				{
+					if(!np->is_identifier())
+						throw jit_unsupported();
+					const identifier_info* info = _ctx.find(std::string(np->get_identifier()));
+					if(!info || info->get_scope() != identifier_scope::local_variable || info->type_id() != type_registry::get_number_handle())
+						throw jit_unsupported();
+					return local_slot(info);
+				}
+
+				// expressions
+
+				void compile_expression(const node_ptr& np)
+				{
+					if(np->is_number())
+						return load_constant(np->get_number(), 0);
+
+					if(np->is_identifier())
+						return load(local_slot(np), 0);
+
+					if(!np->is_node_operation())
+						throw jit_unsupported();
+
+					if(np->get_node_operation() == node_operation::call)
+						return compile_call(np);
+
+					if(np->get_type_id() != type_registry::get_number_handle())
+						throw jit_unsupported();
+
+					const std::vector<node_ptr>& children = np->get_children();
+
+					switch(np->get_node_operation())
+					{
+						case node_operation::preinc:
+						case node_operation::predec:
+						{
+							std::int32_t disp = local_slot(children[0]);
+							load(disp, 0);
+							load_constant(1.0, 1);
+							if(np->get_node_operation() == node_operation::preinc)
+								addsd(0, 1);
+							else
+								subsd(0, 1);
+							return store(disp, 0);
+						}
+						case node_operation::postinc:
+						case node_operation::postdec:
+						{
+							std::int32_t disp = local_slot(children[0]);
+							load(disp, 0);
+							load_constant(1.0, 1);
+							movapd(2, 0);
+							if(np->get_node_operation() == node_operation::postinc)
+								addsd(2, 1);
+							else
+								subsd(2, 1);
+							return store(disp, 2);
+						}
+						case node_operation::positive:
+							return compile_expression(children[0]);
+						case node_operation::negative:
+							compile_expression(children[0]);
+							load_constant(-0.0, 1);
+							return xorpd(0, 1);
+						case node_operation::lnot:
+							compile_expression(children[0]);
+							xorpd(1, 1);
+							cmpsd(0, 1, cmp_eq);
+							return mask_to_number();
+						case node_operation::add:
+						case node_operation::sub:
+						case node_operation::mul:
+						case node_operation::div:
+						case node_operation::mod:
+						case node_operation::eq:
+						case node_operation::ne:
+						case node_operation::lt:
+						case node_operation::gt:
+						case node_operation::le:
+						case node_operation::ge:
+							compile_expression(children[0]);
+							push();
+							compile_expression(children[1]);
+							pop();
+							return compile_binary_operation(np->get_node_operation());
+						case node_operation::assign:
+						{
+							std::int32_t disp = local_slot(children[0]);
+							compile_expression(children[1]);
+							return store(disp, 0);
+						}
+						case node_operation::add_assign:
+						case node_operation::sub_assign:
+						case node_operation::mul_assign:
+						case node_operation::div_assign:
+						case node_operation::mod_assign:
+						{
+							std::int32_t disp = local_slot(children[0]);
+							compile_expression(children[1]);
+							movapd(1, 0);
+							load(disp, 0);
+							compile_binary_operation(get_assigned_operation(np->get_node_operation()));
+							return store(disp, 0);
+						}
+						case node_operation::comma:
+							for(const node_ptr& child : children)
+								compile_expression(child);
+							return;
+						case node_operation::land:
+						case node_operation::lor:
+						{
+							bool land = np->get_node_operation() == node_operation::land;
+							assembler::label shortcut = _asm.new_label();
+							assembler::label end = _asm.new_label();
+							for(const node_ptr& child : children)
+							{
+								compile_expression(child);
+								if(land)
+									jump_if_false(shortcut);
+								else
+									jump_if_true(shortcut);
+							}
+							load_constant(land ? 1.0 : 0.0, 0);
+							_asm.jump(end);
+							_asm.bind(shortcut);
+							load_constant(land ? 0.0 : 1.0, 0);
+							return _asm.bind(end);
+						}
+						case node_operation::ternary:
+						{
+							assembler::label otherwise = _asm.new_label();
+							assembler::label end = _asm.new_label();
+							compile_expression(children[0]);
+							jump_if_false(otherwise);
+							compile_expression(children[1]);
+							_asm.jump(end);
+							_asm.bind(otherwise);
+							compile_expression(children[2]);
+							return _asm.bind(end);
+						}
+						default: throw jit_unsupported();
+					}
+				}
+
+				static node_operation get_assigned_operation(node_operation op)
+				{
+					switch(op)
+					{
+						case node_operation::add_assign: return node_operation::add;
+						case node_operation::sub_assign: return node_operation::sub;
+						case node_operation::mul_assign: return node_operation::mul;
+						case node_operation::div_assign: return node_operation::div;
+						default: return node_operation::mod;
+					}
+				}
+
+				// comparisons follow the interpreter, which derives all of them from <
+				void compile_binary_operation(node_operation op)
+				{
+					switch(op)
+					{
+						case node_operation::add: return addsd(0, 1);
+						case node_operation::sub: return subsd(0, 1);
+						case node_operation::mul: return mulsd(0, 1);
+						case node_operation::div: return divsd(0, 1);
+						case node_operation::mod:
+							// n1 - n2 * int(n1/n2)
+							movapd(2, 0);
+							divsd(2, 1);
+							_asm.emit({0xF2, 0x0F, 0x2C, 0xC2}); // cvttsd2si eax, xmm2
+							_asm.emit({0xF2, 0x0F, 0x2A, 0xD0}); // cvtsi2sd xmm2, eax
+							mulsd(2, 1);
+							return subsd(0, 2);
+						case node_operation::eq:
+							movapd(2, 0);
+							cmpsd(0, 1, cmp_eq);
+							cmpsd(2, 1, cmp_unord);
+							orpd(0, 2);
+							return mask_to_number();
+						case node_operation::ne:
+							movapd(2, 0);
+							cmpsd(0, 1, cmp_neq);
+							cmpsd(2, 1, cmp_ord);
+							andpd(0, 2);
+							return mask_to_number();
+						case node_operation::lt:
+							cmpsd(0, 1, cmp_lt);
+							return mask_to_number();
+						case node_operation::gt:
+							cmpsd(1, 0, cmp_lt);
+							movapd(0, 1);
+							return mask_to_number();
+						case node_operation::le:
+							cmpsd(1, 0, cmp_nlt);
+							movapd(0, 1);
+							return mask_to_number();
+						case node_operation::ge:
+							cmpsd(0, 1, cmp_nlt);
+							return mask_to_number();
+						default: throw jit_unsupported();
+					}
+				}
+
+				// only direct calls to functions taking numbers by value
+				void compile_call(const node_ptr& np)
+				{
+					const std::vector<node_ptr>& children = np->get_children();
+					if(!children[0]->is_identifier())
+						throw jit_unsupported();
+
+					const identifier_info* info = _ctx.find(std::string(children[0]->get_identifier()));
+					const function_type* ft = std::get_if<function_type>(children[0]->get_type_id());
+					if(!info || info->get_scope() != identifier_scope::function || !ft)
+						throw jit_unsupported();
+					if(ft->return_type_id != type_registry::get_number_handle() && ft->return_type_id != type_registry::get_void_handle())
+						throw jit_unsupported();
+					for(const function_type::param& p : ft->param_type_id)
+						if(p.by_ref || p.type_id != type_registry::get_number_handle())
+							throw jit_unsupported();
+
+					size_t count = children.size() - 1;
+					std::uint32_t args_size = std::uint32_t((8 * count + 15) & ~size_t(15));
+
+					_asm.emit({0x48, 0x81, 0xEC});           // sub rsp, args size
+					_asm.emit32(args_size);
+
+					for(size_t i = 0; i < count; ++i)
+					{
+						// arguments passed by value are wrapped in param nodes
+						const node_ptr& argument = children[i + 1];
+						if(!argument->is_node_operation() || argument->get_node_operation() != node_operation::param)
+							throw jit_unsupported();
+						compile_expression(argument->get_children()[0]);
+						_asm.emit({0xF2, 0x0F, 0x11, 0x84, 0x24}); // movsd [rsp + 8 * i], xmm0
+						_asm.emit32(std::uint32_t(8 * i));
+					}
+
+					_asm.emit({0x4C, 0x89, 0xE7});           // mov rdi, r12
+					_asm.emit({0xBE});                       // mov esi, idx
+					_asm.emit32(std::uint32_t(info->index()));
+					_asm.emit({0x48, 0x89, 0xE2});           // mov rdx, rsp
+					_asm.emit({0xB9});                       // mov ecx, count
+					_asm.emit32(std::uint32_t(count));
+					_asm.emit({0x48, 0xB8});                 // mov rax, call_function
+					_asm.emit64(reinterpret_cast<std::uint64_t>(&call_function));
+					_asm.emit({0xFF, 0xD0});                 // call rax
+					_asm.emit({0x48, 0x81, 0xC4});           // add rsp, args size
+					_asm.emit32(args_size);
+				}
+
+				// statements
+
+				void compile_statement(tk_iterator& it)
+				{
+					if(it->is_keyword())
+					{
+						switch(it->get_token())
+						{
+							case Tokens::kw_var:       return compile_var_statement(it);
+							case Tokens::kw_const:     return compile_const_statement(it);
+							case Tokens::kw_for:       return compile_for_statement(it);
+							case Tokens::kw_parallel:  throw jit_unsupported();
+							case Tokens::kw_while:     return compile_while_statement(it);
+							case Tokens::kw_do:        return compile_do_statement(it);
+							case Tokens::statement_if: return compile_if_statement(it);
+							case Tokens::statement_switch: throw jit_unsupported();
+							case Tokens::kw_break:     return compile_break_statement(it);
+							case Tokens::kw_continue:  return compile_continue_statement(it);
+							case Tokens::kw_return:    return compile_return_statement(it);
+
+							default: break;
+						}
+					}
+					if(it->has_value(Tokens::embrace_b))
+						return compile_block_statement(it);
+
+					node_ptr np = parse_expression(_ctx, it, type_registry::get_void_handle(), true);
+					if(np)
+						compile_expression(np);
+					parse_token_value(_ctx, it, Tokens::semicolon);
+				}
+
+				void compile_block_contents(tk_iterator& it)
+				{
+					if(it->has_value(Tokens::embrace_b))
+					{
+						parse_token_value(_ctx, it, Tokens::embrace_b);
+
+						while(!it->has_value(Tokens::embrace_e))
+							compile_statement(it);
+
+						parse_token_value(_ctx, it, Tokens::embrace_e);
+					}
+					else
+						compile_statement(it);
+				}
+
+				void compile_block_statement(tk_iterator& it)
+				{
+					auto _ = _ctx.scope();
+					compile_block_contents(it);
+				}
+
+				void compile_variable_declaration(tk_iterator& it)
+				{
+					parse_token_value(_ctx, it, Tokens::kw_var);
+					std::string name = parse_declaration_name(_ctx, it);
+
+					if(!it->has_value(Tokens::type_specifier))
+						throw jit_unsupported();
+					parse_token_value(_ctx, it, Tokens::type_specifier);
+
+					type_handle type_id = parse_type(_ctx, it);
+					if(type_id != type_registry::get_number_handle())
+						throw jit_unsupported();
+
+					if(it->has_value(Tokens::assign))
+					{
+						++it;
+						compile_expression(parse_expression(_ctx, it, type_id, false));
+					}
+					else
+						load_constant(0.0, 0);
+
+					store(local_slot(_ctx.create_identifier(std::move(name), type_id)), 0);
+				}
+
+				void compile_var_statement(tk_iterator& it)
+				{
+					compile_variable_declaration(it);
+					parse_token_value(_ctx, it, Tokens::semicolon);
+				}
+
+				void compile_const_statement(tk_iterator& it)
+				{
+					compile_constant_declaration(_ctx, it);
+					parse_token_value(_ctx, it, Tokens::semicolon);
+				}
+
+				void compile_for_statement(tk_iterator& it)
+				{
+					auto _ = _ctx.scope();
+
+					parse_token_value(_ctx, it, Tokens::kw_for);
+					parse_token_value(_ctx, it, Tokens::bracket_b);
+
+					if(it->has_value(Tokens::kw_var))
+						compile_variable_declaration(it);
+					else if(node_ptr init = parse_expression(_ctx, it, type_registry::get_void_handle(), true))
+						compile_expression(init);
+
+					parse_token_value(_ctx, it, Tokens::semicolon);
+
+					loop_labels labels{_asm.new_label(), _asm.new_label()};
+					assembler::label top = _asm.new_label();
+					_asm.bind(top);
+
+					if(node_ptr condition = parse_expression(_ctx, it, type_registry::get_number_handle(), true))
+					{
+						compile_expression(condition);
+						jump_if_false(labels.break_label);
+					}
+
+					parse_token_value(_ctx, it, Tokens::semicolon);
+
+					node_ptr step = parse_expression(_ctx, it, type_registry::get_void_handle(), true);
+
+					parse_token_value(_ctx, it, Tokens::bracket_e);
+
+					compile_loop_body(it, labels);
+
+					_asm.bind(labels.continue_label);
+					if(step)
+						compile_expression(step);
+					_asm.jump(top);
+					_asm.bind(labels.break_label);
+				}
+
+				void compile_while_statement(tk_iterator& it)
+				{
+					parse_token_value(_ctx, it, Tokens::kw_while);
+
+					loop_labels labels{_asm.new_label(), _asm.new_label()};
+					_asm.bind(labels.continue_label);
+
+					parse_token_value(_ctx, it, Tokens::bracket_b);
+					compile_expression(parse_expression(_ctx, it, type_registry::get_number_handle(), true));
+					jump_if_false(labels.break_label);
+					parse_token_value(_ctx, it, Tokens::bracket_e);
+
+					compile_loop_body(it, labels);
+
+					_asm.jump(labels.continue_label);
+					_asm.bind(labels.break_label);
+				}
+
+				void compile_do_statement(tk_iterator& it)
+				{
+					parse_token_value(_ctx, it, Tokens::kw_do);
+
+					loop_labels labels{_asm.new_label(), _asm.new_label()};
+					assembler::label top = _asm.new_label();
+					_asm.bind(top);
+
+					compile_loop_body(it, labels);
+
+					parse_token_value(_ctx, it, Tokens::kw_while);
+
+					_asm.bind(labels.continue_label);
+					parse_token_value(_ctx, it, Tokens::bracket_b);
+					compile_expression(parse_expression(_ctx, it, type_registry::get_number_handle(), true));
+					jump_if_true(top);
+					parse_token_value(_ctx, it, Tokens::bracket_e);
+
+					_asm.bind(labels.break_label);
+				}
+
+				void compile_loop_body(tk_iterator& it, loop_labels labels)
+				{
+					_loops.push_back(labels);
+					compile_block_statement(it);
+					_loops.pop_back();
+				}
+
+				void compile_if_statement(tk_iterator& it)
+				{
+					auto _ = _ctx.scope();
+					assembler::label end = _asm.new_label();
+
+					parse_token_value(_ctx, it, Tokens::statement_if);
+					compile_conditional_block(it, end);
+
+					while(it->has_value(Tokens::statement_elif))
+					{
+						++it;
+						compile_conditional_block(it, end);
+					}
+
+					if(it->has_value(Tokens::statement_else))
+					{
+						++it;
+						compile_block_statement(it);
+					}
+
+					_asm.bind(end);
+				}
+
+				// (condition) block, then jumps to the end of the whole if statement
+				void compile_conditional_block(tk_iterator& it, assembler::label end)
+				{
+					assembler::label next = _asm.new_label();
+
+					parse_token_value(_ctx, it, Tokens::bracket_b);
+					compile_expression(parse_expression(_ctx, it, type_registry::get_number_handle(), true));
+					jump_if_false(next);
+					parse_token_value(_ctx, it, Tokens::bracket_e);
+
+					compile_block_statement(it);
+					_asm.jump(end);
+					_asm.bind(next);
+				}
+
+				void compile_break_statement(tk_iterator& it)
+				{
+					parse_token_value(_ctx, it, Tokens::kw_break);
+
+					size_t break_level = 1;
+					if(it->is_number())
+					{
+						break_level = size_t(it->get_number());
+						++it;
+					}
+
+					parse_token_value(_ctx, it, Tokens::semicolon);
+					_asm.jump(_loops[_loops.size() - break_level].break_label);
+				}
+
+				void compile_continue_statement(tk_iterator& it)
+				{
+					parse_token_value(_ctx, it, Tokens::kw_continue);
+					parse_token_value(_ctx, it, Tokens::semicolon);
+					_asm.jump(_loops.back().continue_label);
+				}
+
+				void compile_return_statement(tk_iterator& it)
+				{
+					parse_token_value(_ctx, it, Tokens::kw_return);
+
+					if(_return_type_id == type_registry::get_void_handle())
+						load_constant(0.0, 0);
+					else
+						compile_expression(parse_expression(_ctx, it, _return_type_id, true));
+
+					parse_token_value(_ctx, it, Tokens::semicolon);
+					_asm.jump(_epilogue);
+				}
+		};
+	}
+#endif
+
+	function jit_compile(compiler_context& ctx, const function_declaration& decl, std::deque<Token> tokens)
+	{
+#ifdef GISEL_JIT
+		const function_type* ft = std::get_if<function_type>(decl.type_id);
+		bool returns_number = ft->return_type_id == type_registry::get_number_handle();
+
+		if(!returns_number && ft->return_type_id != type_registry::get_void_handle())
+			return function();
+		if(ft->param_type_id.size() > max_jit_params)
+			return function();
+		for(const function_type::param& p : ft->param_type_id)
+			if(p.by_ref || p.type_id != type_registry::get_number_handle())
+				return function();
+
+		std::shared_ptr<executable_code> code;
+
+		try
+		{
+			auto _ = ctx.function();
+			for(size_t i = 0; i < decl.params.size(); ++i)
+				ctx.create_param(decl.params[i], ft->param_type_id[i].type_id, ft->param_type_id[i].by_ref);
+
+			function_compiler compiler(ctx, decl.params.size(), ft->return_type_id);
+			tk_iterator it(tokens);
+			compiler.compile_body(it);
+			code = std::make_shared<executable_code>(compiler.finish());
+		}
+		catch(const jit_unsupported&)
+		{
+			return function();
+		}
+
+		if(!*code)
+			return function();
+
+		write_perf_map_entry(*code, decl.name);
+
+		return [code, params_count = decl.params.size(), returns_number] (runtime_context& context)
+		{
+			double args[max_jit_params];
+			for(size_t i = 0; i < params_count; ++i)
+				args[i] = static_cast<const variable_impl<number>&>(*context.local(-1 - int(i))).value;
+
+			double ret = code->entry()(args, &context);
+
+			if(returns_number)
+				context.retval() = context.make_variable<number>(ret);
+		};
+#else
+		return function();
+#endif
+	}
+}
@@ -0,0 +1,39 @@
+/**
+ * This file is a part of the Gisel Interpreter
+ *
+ * Copyright (C) 2022 @kbz_8
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef __JIT__
+#define __JIT__
+
+#include <deque>
+#include "tokens.h"
+#include "function.h"
+
+namespace Gisel
+{
+	class compiler_context;
+	class runtime_context;
+	struct function_declaration;
+
+	using function = func::function<void(runtime_context&)>;
+
+	// compiles a function whose parameters and locals are all numbers to x86-64 machine code;
+	// returns an empty function when the platform or anything in the function body is not supported
+	function jit_compile(compiler_context& ctx, const function_declaration& decl, std::deque<Token> tokens);
+}
+
+#endif // __JIT__
@@ -0,0 +1,162 @@
+/**
+ * This file is a part of the Gisel Interpreter
+ *
+ * Copyright (C) 2022 @kbz_8
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "loop_analysis.h"
+#include "expression_tree.h"
+#include "compiler_context.h"
+#include "optimizer.h"
+#include <algorithm>
+#include <cmath>
+
+namespace Gisel
+{
+	namespace
+	{
+		constexpr const double max_exact_integer = 9007199254740992.0; // 2^53
+
+		std::optional<double> get_step(const node_ptr& step, std::string& name)
+		{
+			if(!step || !step->is_node_operation())
+				return std::nullopt;
+
+			const std::vector<node_ptr>& children = step->get_children();
+			if(!children[0]->is_identifier())
+				return std::nullopt;
+			name = children[0]->get_identifier();
+
+			switch(step->get_node_operation())
+			{
+				case node_operation::preinc:
+				case node_operation::postinc: return 1.0;
+				case node_operation::predec:
+				case node_operation::postdec: return -1.0;
+				case node_operation::add_assign: return get_constant(children[1]);
+				case node_operation::sub_assign:
+					if(std::optional<double> c = get_constant(children[1]))
+						return -*c;
+					return std::nullopt;
+
+				default: return std::nullopt;
+			}
+		}
+
+		std::optional<loop_comparison> get_comparison(node_operation operation, bool swapped)
+		{
+			switch(operation)
+			{
+				case node_operation::lt: return swapped ? loop_comparison::gt : loop_comparison::lt;
+				case node_operation::le: return swapped ? loop_comparison::ge : loop_comparison::le;
+				case node_operation::gt: return swapped ? loop_comparison::lt : loop_comparison::gt;
+				case node_operation::ge: return swapped ? loop_comparison::le : loop_comparison::ge;
+				case node_operation::ne: return loop_comparison::ne;
+
+				default: return std::nullopt;
+			}
+		}
+	}
+
+	std::optional<counted_loop> recognize_counted_loop(compiler_context& context, const node_ptr& condition, const node_ptr& step)
+	{
+		counted_loop ret;
+
+		std::optional<double> increment = get_step(step, ret.name);
+		if(!increment || *increment == 0 || !std::isfinite(*increment))
+			return std::nullopt;
+		ret.step = *increment;
+
+		ret.counter = context.find(ret.name);
+		if(!ret.counter || ret.counter->get_scope() != identifier_scope::local_variable || ret.counter->type_id() != type_registry::get_number_handle() || context.is_reference_param(ret.counter))
+			return std::nullopt;
+
+		if(!condition || !condition->is_node_operation() || condition->get_children().size() != 2)
+			return std::nullopt;
+
+		const std::vector<node_ptr>& operands = condition->get_children();
+		const bool swapped = !(operands[0]->is_identifier() && operands[0]->get_identifier() == ret.name);
+		const node_ptr& counter = operands[swapped ? 1 : 0];
+		const node_ptr& limit = operands[swapped ? 0 : 1];
+		std::optional<loop_comparison> comparison = get_comparison(condition->get_node_operation(), swapped);
+
+		if(!counter->is_identifier() || counter->get_identifier() != ret.name || !comparison)
+			return std::nullopt;
+
+		std::optional<double> bound = get_constant(limit);
+		ret.bound_variable = nullptr;
+
+		if(!bound && limit->is_identifier() && limit->get_identifier() != ret.name)
+		{
+			const identifier_info* info = context.find(std::string(limit->get_identifier()));
+			if(info && info->get_scope() == identifier_scope::local_variable && info->type_id() == type_registry::get_number_handle() && !context.is_reference_param(info))
+			{
+				ret.bound_variable = info;
+				bound = 0.0;
+			}
+		}
+
+		if(!bound || std::isnan(*bound))
+			return std::nullopt;
+
+		ret.bound = *bound;
+		ret.comparison = *comparison;
+
+		return ret;
+	}
+
+	std::optional<size_t> get_trip_count(const counted_loop& loop, size_t limit)
+	{
+		if(!loop.start || loop.bound_variable || *loop.start != std::trunc(*loop.start) || loop.step != std::trunc(loop.step))
+			return std::nullopt;
+
+		double value = *loop.start;
+		for(size_t count = 0; count <= limit; ++count, value += loop.step)
+		{
+			if(std::fabs(value) >= max_exact_integer)
+				return std::nullopt;
+			if(!compare(loop.comparison, value, loop.bound))
+				return count;
+		}
+		return std::nullopt;
+	}
+
+	// the counter moves towards the bound by integral steps and all its values are exact
+	bool is_bounded_integral_loop(loop_comparison comparison, double start, double bound, double step)
+	{
+		if(start != std::trunc(start) || step != std::trunc(step) || !std::isfinite(bound) || std::fabs(start) > max_exact_integer || std::fabs(bound) + std::fabs(step) > max_exact_integer)
+			return false;
+
+		switch(comparison)
+		{
+			case loop_comparison::lt:
+			case loop_comparison::le: return step > 0;
+			case loop_comparison::gt:
+			case loop_comparison::ge: return step < 0;
+			case loop_comparison::ne: return std::fmod(bound - start, step) == 0 && (bound - start) / step >= 0;
+		}
+		return false;
+	}
+
+	std::optional<value_range> get_counter_range(const counted_loop& loop)
+	{
+		if(!loop.start || loop.bound_variable || !is_bounded_integral_loop(loop.comparison, *loop.start, loop.bound, loop.step))
+			return std::nullopt;
+
+		const double start = *loop.start;
+		return value_range{std::min(start, loop.bound), std::max(start, loop.bound), true, start == 0 && std::signbit(start)};
+	}
+}
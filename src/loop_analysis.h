@@ -0,0 +1,78 @@
+/**
+ * This file is a part of the Gisel Interpreter
+ *
+ * Copyright (C) 2022 @kbz_8
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __LOOP_ANALYSIS__
+#define __LOOP_ANALYSIS__
+
+#include <memory>
+#include <optional>
+#include <string>
+#include "range_analysis.h"
+
+namespace Gisel
+{
+	class identifier_info;
+	class compiler_context;
+	struct node;
+
+	using node_ptr = std::unique_ptr<node>;
+
+	enum class loop_comparison
+	{
+		lt,
+		le,
+		gt,
+		ge,
+		ne
+	};
+
+	// for(<counter> = start; <counter> <comparison> bound; <counter> += step)
+	// the bound is either a constant or a local variable that the loop never writes; neither the counter
+	// nor the bound is a parameter passed by reference, which a call in the body could write
+	struct counted_loop
+	{
+		const identifier_info* counter;
+		std::string name;
+		std::optional<double> start;
+		loop_comparison comparison;
+		double bound;
+		const identifier_info* bound_variable;
+		double step;
+	};
+
+	inline bool compare(loop_comparison comparison, double value, double bound)
+	{
+		switch(comparison)
+		{
+			case loop_comparison::lt: return value < bound;
+			case loop_comparison::le: return value <= bound;
+			case loop_comparison::gt: return value > bound;
+			case loop_comparison::ge: return value >= bound;
+			case loop_comparison::ne: return value != bound;
+		}
+		return false;
+	}
+
+	std::optional<counted_loop> recognize_counted_loop(compiler_context& context, const node_ptr& condition, const node_ptr& step);
+	std::optional<size_t> get_trip_count(const counted_loop& loop, size_t limit);
+	bool is_bounded_integral_loop(loop_comparison comparison, double start, double bound, double step);
+	std::optional<value_range> get_counter_range(const counted_loop& loop);
+}
+
+#endif // __LOOP_ANALYSIS__
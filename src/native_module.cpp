@@ -0,0 +1,139 @@
+/**
+ * This file is a part of the Gisel Interpreter
+ *
+ * Copyright (C) 2022 @kbz_8
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "native_module.h"
+#include "gisel_native.h"
+#include "compiler_context.h"
+#include "incomplete_function.h"
+#include "errors.h"
+#include <algorithm>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+namespace Gisel
+{
+	namespace
+	{
+		std::shared_ptr<void> open_library(const char* path)
+		{
+#ifdef _WIN32
+			HMODULE library = LoadLibraryA(path);
+			if(!library)
+				file_not_found(path).expose();
+			return std::shared_ptr<void>(library, [](void* library) { FreeLibrary(static_cast<HMODULE>(library)); });
+#else
+			void* library = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+			if(!library)
+				Error(std::string("cannot load native module : ") + dlerror(), -2).expose();
+			return std::shared_ptr<void>(library, [](void* library) { dlclose(library); });
+#endif
+		}
+
+		void* find_symbol(const std::shared_ptr<void>& library, const char* name)
+		{
+#ifdef _WIN32
+			return reinterpret_cast<void*>(GetProcAddress(static_cast<HMODULE>(library.get()), name));
+#else
+			return dlsym(library.get(), name);
+#endif
+		}
+
+		const native::host_interface host =
+		{
+			[](number value) -> variable_ptr { return std::make_shared<variable_impl<number>>(value); },
+			[](integer value) -> variable_ptr { return std::make_shared<variable_impl<integer>>(value); },
+			[](string value) -> variable_ptr { return std::make_shared<variable_impl<string>>(std::move(value)); },
+			[](runtime_context& context, int idx) -> variable_ptr& { return context.local(idx); },
+			[](runtime_context& context) -> variable_ptr& { return context.retval(); },
+			[](runtime_context& context, int idx, std::vector<variable_ptr> params) { return context.call(context.get_function(idx), std::move(params)); }
+		};
+
+		// the globals live in the shared object, the context only needs to run their initialization
+		class native_initializer : public expression<lvalue>
+		{
+			public:
+				native_initializer(void (*initialize)(runtime_context&)) : _initialize(initialize) {}
+
+				lvalue evaluate(runtime_context& context) const override
+				{
+					_initialize(context);
+					return std::make_shared<variable_impl<number>>(0);
+				}
+
+			private:
+				void (*_initialize)(runtime_context&);
+		};
+	}
+
+	runtime_context load_native_module(const char* path, const std::vector<std::pair<std::string, function> >& external_functions, const std::vector<std::string>& public_declarations, std::shared_ptr<void>& handle)
+	{
+		handle = open_library(path);
+
+		auto entry = reinterpret_cast<native::module_entry>(find_symbol(handle, "gisel_native_module"));
+		if(!entry)
+			Error(std::string("'") + path + "' is not a native gisel module", -2).expose();
+
+		const native::module_info* module = entry(&host);
+		if(module->version != native::abi_version)
+			Error(std::string("'") + path + "' was generated for another version of gisel", -2).expose();
+
+		compiler_context ctx;
+		std::vector<function> functions;
+
+		for(size_t i = 0; i < module->externals_count; ++i)
+		{
+			const native::function_info& imported = module->externals[i];
+			auto it = std::find_if(external_functions.begin(), external_functions.end(), [&](const std::pair<std::string, function>& p) { return parse_function_declaration(ctx, p.first).name == imported.name; });
+
+			if(it == external_functions.end())
+				Error(std::string("external function '") + imported.name + "' required by the native module is not defined", -2).expose();
+			if(std::to_string(parse_function_declaration(ctx, it->first).type_id) != imported.type)
+				Error(std::string("external function '") + imported.name + "' does not have the type the native module was built with", -2).expose();
+
+			functions.push_back(it->second);
+		}
+
+		std::unordered_map<std::string, program::public_function> public_functions;
+
+		for(size_t i = 0; i < module->publics_count; ++i)
+		{
+			public_functions.emplace(module->publics[i].name, program::public_function{functions.size(), module->publics[i].type});
+			functions.push_back(module->publics[i].entry);
+		}
+
+		for(const std::string& declaration : public_declarations)
+		{
+			function_declaration decl = parse_function_declaration(ctx, declaration);
+			auto it = std::find_if(module->publics, module->publics + module->publics_count, [&](const native::function_info& exported) { return exported.name == decl.name; });
+
+			if(it == module->publics + module->publics_count)
+				Error("public function '" + decl.name + "' is not defined by the native module", -2).expose();
+			if(std::to_string(decl.type_id) != it->type)
+				Error("public function '" + decl.name + "' is not of type " + std::to_string(decl.type_id) + " in the native module", -2).expose();
+		}
+
+		std::vector<expression<lvalue>::ptr> initializers;
+		initializers.push_back(std::make_unique<native_initializer>(module->initialize));
+
+		return runtime_context(std::make_shared<const program>(std::move(initializers), std::move(functions), std::move(public_functions)));
+	}
+}
@@ -0,0 +1,35 @@
+/**
+ * This file is a part of the Gisel Interpreter
+ *
+ * Copyright (C) 2022 @kbz_8
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef __NATIVE_MODULE__
+#define __NATIVE_MODULE__
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "runtime_context.h"
+
+namespace Gisel
+{
+	// loads a shared object built from the output of emit_cpp; its imports are bound by name to
+	// the external functions and its exports must match the public declarations. The returned
+	// context must not outlive handle, which keeps the shared object loaded
+	runtime_context load_native_module(const char* path, const std::vector<std::pair<std::string, function> >& external_functions, const std::vector<std::string>& public_declarations, std::shared_ptr<void>& handle);
+}
+
+#endif // __NATIVE_MODULE__
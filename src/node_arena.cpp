@@ -0,0 +1,96 @@
+/**
+ * This file is a part of the Gisel Interpreter
+ *
+ * Copyright (C) 2022 @kbz_8
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "node_arena.h"
+#include <new>
+
+namespace Gisel
+{
+	thread_local node_arena* node_arena::_current = nullptr;
+
+	void* node_arena::allocate(std::size_t size)
+	{
+		if(size > max_block_size)
+			return ::operator new(size);
+
+		const std::size_t sc = size_class(size);
+
+		if(block* b = _free[sc])
+		{
+			_free[sc] = b->next;
+			return b;
+		}
+
+		size = (sc + 1) * granularity;
+
+		if(std::size_t(_end - _cursor) < size)
+		{
+			// the rest of the previous chunk is given up, its blocks are freed with the arena
+			_chunks.emplace_back(new char[chunk_size]);
+			_cursor = _chunks.back().get();
+			_end = _cursor + chunk_size;
+		}
+
+		void* ret = _cursor;
+		_cursor += size;
+		return ret;
+	}
+
+	void node_arena::deallocate(void* p, std::size_t size) noexcept
+	{
+		if(size > max_block_size)
+		{
+			::operator delete(p);
+			return;
+		}
+
+		// a block freed during compilation, like the nodes replaced by the optimizer, is reused by the next one of its size
+		block* b = static_cast<block*>(p);
+		const std::size_t sc = size_class(size);
+		b->next = _free[sc];
+		_free[sc] = b;
+	}
+
+	namespace
+	{
+		// every object is preceded by the arena it was allocated from, null for the heap
+		constexpr const std::size_t header_size = alignof(std::max_align_t);
+	}
+
+	void* arena_object::operator new(std::size_t size)
+	{
+		node_arena* arena = node_arena::current();
+
+		char* p = static_cast<char*>(arena ? arena->allocate(size + header_size) : ::operator new(size + header_size));
+		*reinterpret_cast<node_arena**>(p) = arena;
+		return p + header_size;
+	}
+
+	void arena_object::operator delete(void* p, std::size_t size) noexcept
+	{
+		if(!p)
+			return;
+
+		char* block = static_cast<char*>(p) - header_size;
+
+		if(node_arena* arena = *reinterpret_cast<node_arena**>(block))
+			arena->deallocate(block, size + header_size);
+		else
+			::operator delete(block);
+	}
+}
@@ -0,0 +1,114 @@
+/**
+ * This file is a part of the Gisel Interpreter
+ *
+ * Copyright (C) 2022 @kbz_8
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef __NODE_ARENA__
+#define __NODE_ARENA__
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace Gisel
+{
+	// the memory of the compiled program: nodes, expressions and statements are carved one after the other
+	// out of the chunks of the arena of the module being compiled, and all of it goes away with the module
+	class node_arena
+	{
+		public:
+			node_arena() = default;
+
+			void* allocate(std::size_t size);
+			void deallocate(void* p, std::size_t size) noexcept;
+
+			// the arena of the current thread, null when nothing is being compiled
+			static inline node_arena* current() noexcept { return _current; }
+
+			// makes arena current for the lifetime of the scope
+			class scope
+			{
+				public:
+					explicit scope(node_arena& arena) noexcept : _previous(_current) { _current = &arena; }
+					~scope() { _current = _previous; }
+
+				private:
+					node_arena* _previous;
+
+					scope(const scope&) = delete;
+					void operator=(const scope&) = delete;
+			};
+
+		private:
+			struct block { block* next; };
+
+			static constexpr const std::size_t granularity = alignof(std::max_align_t);
+			static constexpr const std::size_t max_block_size = 32 * granularity;
+			static constexpr const std::size_t chunk_size = 65536;
+
+			static thread_local node_arena* _current;
+
+			block* _free[max_block_size / granularity] = {};
+			std::vector<std::unique_ptr<char[]> > _chunks;
+			char* _cursor = nullptr;
+			char* _end = nullptr;
+
+			static inline std::size_t size_class(std::size_t size) noexcept { return (size - 1) / granularity; }
+
+			node_arena(const node_arena&) = delete;
+			void operator=(const node_arena&) = delete;
+	};
+
+	// base of the objects that are allocated from the current arena; outside of compilation they come from the heap
+	class arena_object
+	{
+		public:
+			static void* operator new(std::size_t size);
+			static void operator delete(void* p, std::size_t size) noexcept;
+	};
+
+	// the allocator of the arrays of the compiled program, from the arena that is current when it is created
+	template <typename T>
+	class arena_allocator
+	{
+		public:
+			using value_type = T;
+
+			arena_allocator() noexcept : _arena(node_arena::current()) {}
+			template <typename U>
+			arena_allocator(const arena_allocator<U>& other) noexcept : _arena(other.arena()) {}
+
+			inline T* allocate(std::size_t n) { return static_cast<T*>(_arena ? _arena->allocate(n * sizeof(T)) : ::operator new(n * sizeof(T))); }
+			inline void deallocate(T* p, std::size_t n) noexcept
+			{
+				if(_arena)
+					_arena->deallocate(p, n * sizeof(T));
+				else
+					::operator delete(p);
+			}
+			inline node_arena* arena() const noexcept { return _arena; }
+
+		private:
+			node_arena* _arena;
+	};
+
+	template <typename T, typename U>
+	inline bool operator==(const arena_allocator<T>& a1, const arena_allocator<U>& a2) noexcept { return a1.arena() == a2.arena(); }
+	template <typename T, typename U>
+	inline bool operator!=(const arena_allocator<T>& a1, const arena_allocator<U>& a2) noexcept { return a1.arena() != a2.arena(); }
+}
+
+#endif // __NODE_ARENA__
@@ -0,0 +1,158 @@
+/**
+ * This file is a part of the Gisel Interpreter
+ *
+ * Copyright (C) 2022 @kbz_8
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "optimizer.h"
+#include "expression_tree.h"
+#include "compiler_context.h"
+#include <cmath>
+
+namespace Gisel
+{
+	namespace
+	{
+		constexpr const int max_expanded_power = 8;
+
+		inline bool is_operation(const node_ptr& np, node_operation operation) { return np->is_node_operation() && np->get_node_operation() == operation; }
+
+		// operands that can be evaluated several times without any visible difference
+		bool is_pure_operand(const node_ptr& np) { return np->is_identifier() || get_constant(np).has_value(); }
+
+		node_ptr clone_operand(compiler_context& context, const node_ptr& np)
+		{
+			if(np->is_identifier())
+				return std::make_unique<node>(context, identifier{std::string(np->get_identifier())}, std::vector<node_ptr>(), np->get_line_number());
+			return std::make_unique<node>(context, *get_constant(np), std::vector<node_ptr>(), np->get_line_number());
+		}
+
+		node_ptr make_node(compiler_context& context, node_operation operation, std::vector<node_ptr> children, size_t line_number) { return std::make_unique<node>(context, operation, std::move(children), line_number); }
+
+		node_ptr make_binary(compiler_context& context, node_operation operation, node_ptr lhs, node_ptr rhs, size_t line_number)
+		{
+			std::vector<node_ptr> children;
+			children.push_back(std::move(lhs));
+			children.push_back(std::move(rhs));
+			return make_node(context, operation, std::move(children), line_number);
+		}
+
+		node_ptr make_constant(compiler_context& context, double value, size_t line_number) { return std::make_unique<node>(context, value, std::vector<node_ptr>(), line_number); }
+
+		const node_ptr& unwrap_param(const node_ptr& np) { return is_operation(np, node_operation::param) ? np->get_children()[0] : np; }
+
+		// pow(x, k) -> x * x * ... with exactly the multiplications (or divisions) the builtin performs
+		bool rewrite_pow(node_ptr& np, compiler_context& context)
+		{
+			const std::vector<node_ptr>& children = np->get_children();
+			if(children.size() != 3 || !children[0]->is_identifier() || children[0]->get_identifier() != "pow")
+				return false;
+
+			const identifier_info* info = context.find(std::string(children[0]->get_identifier()));
+			if(!info || !context.is_external_function(info))
+				return false;
+
+			const node_ptr& x = unwrap_param(children[1]);
+			std::optional<double> p = get_constant(unwrap_param(children[2]));
+
+			if(!p || *p != std::trunc(*p) || std::fabs(*p) > max_expanded_power || !is_pure_operand(x) || x->get_type_id() != type_registry::get_number_handle())
+				return false;
+
+			const size_t line_number = np->get_line_number();
+
+			if(*p == 0)
+			{
+				np = make_constant(context, 1, line_number);
+				return true;
+			}
+
+			node_ptr res = clone_operand(context, x);
+			if(*p > 1)
+			{
+				for(int i = 1; i < int(*p); ++i)
+					res = make_binary(context, node_operation::mul, std::move(res), clone_operand(context, x), line_number);
+			}
+			else
+			{
+				for(int i = int(*p); i < 1; ++i)
+					res = make_binary(context, node_operation::div, std::move(res), clone_operand(context, x), line_number);
+			}
+			np = std::move(res);
+			return true;
+		}
+
+		void rewrite_node(node_ptr& np, compiler_context& context)
+		{
+			// int operations keep their exact semantics
+			if(np->get_type_id() != type_registry::get_number_handle())
+				return;
+
+			std::vector<node_ptr>& children = np->get_children();
+			const size_t line_number = np->get_line_number();
+
+			// x * -1 stays a multiplication: a negation gives a NaN the other sign, which to_str shows
+			switch(np->get_node_operation())
+			{
+				case node_operation::div:
+					if(std::optional<double> c = get_constant(children[1]); c && has_exact_reciprocal(*c))
+						np = make_binary(context, node_operation::mul, std::move(children[0]), make_constant(context, 1 / *c, line_number), line_number);
+					break;
+				case node_operation::div_assign:
+					if(std::optional<double> c = get_constant(children[1]); c && has_exact_reciprocal(*c))
+						np = make_binary(context, node_operation::mul_assign, std::move(children[0]), make_constant(context, 1 / *c, line_number), line_number);
+					break;
+				case node_operation::call: rewrite_pow(np, context); break;
+
+				default: break;
+			}
+		}
+	}
+
+	std::optional<double> get_constant(const node_ptr& np)
+	{
+		if(np->is_number())
+			return np->get_number();
+		if(is_operation(np, node_operation::positive))
+			return get_constant(np->get_children()[0]);
+		if(is_operation(np, node_operation::negative))
+		{
+			if(std::optional<double> c = get_constant(np->get_children()[0]))
+				return -*c;
+		}
+		// int constants
+		if(is_operation(np, node_operation::to_integer))
+		{
+			if(std::optional<double> c = get_constant(np->get_children()[0]); c && *c == std::trunc(*c))
+				return c;
+		}
+		return std::nullopt;
+	}
+
+	bool has_exact_reciprocal(double d)
+	{
+		int exponent;
+		return std::isfinite(d) && std::fabs(std::frexp(d, &exponent)) == 0.5 && std::isfinite(1 / d);
+	}
+
+	void rewrite_arithmetic(node_ptr& np, compiler_context& context)
+	{
+		if(!np || !np->is_node_operation() || np->get_node_operation() == node_operation::import)
+			return;
+		for(node_ptr& child : np->get_children())
+			rewrite_arithmetic(child, context);
+		rewrite_node(np, context);
+	}
+}
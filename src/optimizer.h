@@ -0,0 +1,39 @@
+/**
+ * This file is a part of the Gisel Interpreter
+ *
+ * Copyright (C) 2022 @kbz_8
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __OPTIMIZER__
+#define __OPTIMIZER__
+
+#include <memory>
+#include <optional>
+
+namespace Gisel
+{
+	struct node;
+	class compiler_context;
+
+	using node_ptr = std::unique_ptr<node>;
+
+	std::optional<double> get_constant(const node_ptr& np);
+	bool has_exact_reciprocal(double d);
+
+	void rewrite_arithmetic(node_ptr& np, compiler_context& context);
+}
+
+#endif // __OPTIMIZER__
@@ -38,6 +38,8 @@ namespace Gisel
 			comparison,
 			equality,
 			bitwise_and,
+			bitwise_xor,
+			bitwise_or,
 			logical_and,
 			logical_or,
 			assignment,
@@ -66,24 +68,34 @@ namespace Gisel
 					case node_operation::param: // This will never happen. Used only for the node creation.
 					case node_operation::postinc:
 					case node_operation::postdec:
+					case node_operation::spawn: // This will never happen. Parsed as an operand.
 					case node_operation::call: precedence = operator_precedence::postfix; break;
 					case node_operation::preinc:
 					case node_operation::predec:
 					case node_operation::positive:
 					case node_operation::negative:
 					case node_operation::bnot:
-					case node_operation::lnot: precedence = operator_precedence::prefix; break;
+					case node_operation::lnot:
+					case node_operation::to_integer:
+					case node_operation::to_number: precedence = operator_precedence::prefix; break;
 					case node_operation::mul:
 					case node_operation::div:
 					case node_operation::mod: precedence = operator_precedence::multiplication; break;
 					case node_operation::add:
 					case node_operation::sub: precedence = operator_precedence::addition; break;
+					case node_operation::shl:
+					case node_operation::shr: precedence = operator_precedence::shift; break;
 					case node_operation::lt:
 					case node_operation::gt:
 					case node_operation::le:
 					case node_operation::ge: precedence = operator_precedence::comparison; break;
 					case node_operation::eq:
 					case node_operation::ne: precedence = operator_precedence::equality; break;
+					case node_operation::band: precedence = operator_precedence::bitwise_and; break;
+					case node_operation::bxor: precedence = operator_precedence::bitwise_xor; break;
+					case node_operation::bor: precedence = operator_precedence::bitwise_or; break;
+					case node_operation::land: precedence = operator_precedence::logical_and; break;
+					case node_operation::lor: precedence = operator_precedence::logical_or; break;
 					case node_operation::assign:
 					case node_operation::add_assign:
 					case node_operation::sub_assign:
@@ -113,6 +125,8 @@ namespace Gisel
 					case node_operation::negative:
 					case node_operation::bnot:
 					case node_operation::lnot:
+					case node_operation::to_integer:
+					case node_operation::to_number:
 					case node_operation::import:
 					case node_operation::call: number_of_operands = 1; break;
 					case node_operation::ternary: number_of_operands = 3; break;
@@ -147,13 +161,27 @@ namespace Gisel
 				case Tokens::sub_assign:
 					return operator_info(node_operation::sub_assign, line_number);
 				case Tokens::mul_assign:
-					return operator_info(node_operation::mod_assign, line_number);
+					return operator_info(node_operation::mul_assign, line_number);
 				case Tokens::div_assign:
 					return operator_info(node_operation::div_assign, line_number);
 				case Tokens::mod_assign:
 					return operator_info(node_operation::mod_assign, line_number);
 				case Tokens::bitwise_and:
 					return operator_info(node_operation::band, line_number);
+				case Tokens::bitwise_or:
+					return operator_info(node_operation::bor, line_number);
+				case Tokens::bitwise_xor:
+					return operator_info(node_operation::bxor, line_number);
+				case Tokens::bitwise_not:
+					return operator_info(node_operation::bnot, line_number);
+				case Tokens::shift_left:
+					return operator_info(node_operation::shl, line_number);
+				case Tokens::shift_right:
+					return operator_info(node_operation::shr, line_number);
+				case Tokens::type_int:
+					return operator_info(node_operation::to_integer, line_number);
+				case Tokens::type_number:
+					return operator_info(node_operation::to_number, line_number);
 				case Tokens::logical_not:
 					return operator_info(node_operation::lnot, line_number);
 				case Tokens::logical_and:
@@ -230,6 +258,41 @@ namespace Gisel
 			operator_stack.pop();
 		}
 		
+		node_ptr parse_expression_tree_impl(compiler_context& context, tk_iterator& it, bool allow_comma, bool allow_empty);
+
+		// spawn(f, args...) calls f on another thread and gives the task running it, join(t) waits for the task t
+		// and gives its result; a task is a function value without parameters, so join(t) is the call t()
+		node_ptr parse_task_operation(compiler_context& context, tk_iterator& it)
+		{
+			bool spawn = it->has_value(Tokens::kw_spawn);
+			size_t line_number = it->get_line_number();
+			
+			++it;
+			if(!it->has_value(Tokens::bracket_b))
+				expected_syntax_error("(", it->get_line_number()).expose();
+			++it;
+			
+			std::vector<node_ptr> children;
+			children.push_back(parse_expression_tree_impl(context, it, false, false));
+			
+			while(spawn && it->has_value(Tokens::comma))
+			{
+				++it;
+				if(it->has_value(Tokens::type_specifier))
+					semantic_error("the arguments of a task cannot be passed by reference", it->get_line_number()).expose();
+				node_ptr argument = parse_expression_tree_impl(context, it, false, false);
+				size_t argument_line_number = argument->get_line_number();
+				std::vector<node_ptr> argument_vector;
+				argument_vector.push_back(std::move(argument));
+				children.push_back(std::make_unique<node>(context, node_operation::param, std::move(argument_vector), argument_line_number));
+			}
+			
+			if(!it->has_value(Tokens::bracket_e))
+				syntax_error(spawn ? "expected ',' or closing ')'" : "expected closing ')'", it->get_line_number()).expose();
+			
+			return std::make_unique<node>(context, spawn ? node_operation::spawn : node_operation::call, std::move(children), line_number);
+		}
+		
 		node_ptr parse_expression_tree_impl(compiler_context& context, tk_iterator& it, bool allow_comma, bool allow_empty)
 		{
 			std::stack<node_ptr> operand_stack;
@@ -241,6 +304,15 @@ namespace Gisel
 			{
 				if(it->is_keyword())
 				{
+					if(it->has_value(Tokens::kw_spawn) || it->has_value(Tokens::kw_join))
+					{
+						if(!expected_operand)
+							unexpected_syntax_error(std::to_string(it->get_value()).c_str(), it->get_line_number()).expose();
+						operand_stack.push(parse_task_operation(context, it));
+						expected_operand = false;
+						continue;
+					}
+					
 					operator_info oi = get_operator_info(it->get_token(), expected_operand, it->get_line_number());
 					
 					if(oi.operation == node_operation::call && expected_operand)
@@ -260,7 +332,7 @@ namespace Gisel
 					if((oi.precedence == operator_precedence::prefix) != expected_operand)
 						unexpected_syntax_error(std::to_string(it->get_value()).c_str(), it->get_line_number()).expose();
 					
-					if(!operator_stack.empty() && is_evaluated_before(operator_stack.top(), oi))
+					while(!operator_stack.empty() && is_evaluated_before(operator_stack.top(), oi))
 						pop_one_operator(operator_stack, operand_stack, context, it->get_line_number());
 
 					switch(oi.operation)
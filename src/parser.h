@@ -25,7 +25,7 @@
 
 namespace Gisel
 {
-	class node;
+	struct node;
 	class tk_iterator;
 	class compiler_context;
 
@@ -0,0 +1,106 @@
+/**
+ * This file is a part of the Gisel Interpreter
+ *
+ * Copyright (C) 2022 @kbz_8
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <iomanip>
+#include "passes.h"
+#include "optimizer.h"
+
+namespace Gisel
+{
+	pass_manager::timer::timer(timings* t, size_t index) : _timings(t), _index(index), _outer(t->current)
+	{
+		if(_outer)
+			_outer->pause();
+		_timings->current = this;
+		resume();
+	}
+
+	pass_manager::timer::~timer()
+	{
+		pause();
+		++_timings->passes[_index].runs;
+		_timings->current = _outer;
+		if(_outer)
+			_outer->resume();
+	}
+
+	void pass_manager::timer::pause() { _timings->passes[_index].elapsed += std::chrono::steady_clock::now() - _start; }
+
+	pass_manager::pass_manager() : _level(max_level), _timings(std::make_shared<timings>())
+	{
+		add_node_pass("arithmetic", 1, rewrite_arithmetic);
+		_passes.push_back(entry{"dispatch", 1, true, node_pass()});
+		_passes.push_back(entry{"loops", 2, true, node_pass()});
+		_passes.push_back(entry{"reorder", 2, true, node_pass()});
+		_passes.push_back(entry{"flatten", 2, true, node_pass()});
+		_timings->passes.resize(_passes.size());
+	}
+
+	void pass_manager::add_node_pass(std::string name, int level, node_pass transform)
+	{
+		_passes.push_back(entry{std::move(name), level, level <= _level, std::move(transform)});
+		_timings->passes.resize(_passes.size());
+	}
+
+	void pass_manager::set_level(int level)
+	{
+		_level = level;
+		for(entry& e : _passes)
+			e.enabled = e.level <= level;
+	}
+
+	bool pass_manager::set_enabled(std::string_view name, bool enabled)
+	{
+		for(entry& e : _passes)
+		{
+			if(e.name == name)
+			{
+				e.enabled = enabled;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void pass_manager::run_node_passes(node_ptr& np, compiler_context& context) const
+	{
+		if(!np)
+			return;
+
+		for(size_t i = 0; i < _passes.size(); ++i)
+		{
+			if(_passes[i].enabled && _passes[i].transform)
+			{
+				timer _(_timings.get(), i);
+				_passes[i].transform(np, context);
+			}
+		}
+	}
+
+	void pass_manager::write_timings(std::ostream& out) const
+	{
+		out << std::left << std::setw(16) << "pass" << std::setw(8) << "level" << std::setw(10) << "enabled" << std::setw(10) << "runs" << "time (ms)" << std::endl;
+		for(size_t i = 0; i < _passes.size(); ++i)
+		{
+			const timing& t = _timings->passes[i];
+			out << std::left << std::setw(16) << _passes[i].name << std::setw(8) << _passes[i].level << std::setw(10) << (_passes[i].enabled ? "yes" : "no") << std::setw(10) << t.runs
+				<< std::fixed << std::setprecision(3) << std::chrono::duration<double, std::milli>(t.elapsed).count() << std::endl;
+		}
+	}
+}
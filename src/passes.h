@@ -0,0 +1,127 @@
+/**
+ * This file is a part of the Gisel Interpreter
+ *
+ * Copyright (C) 2022 @kbz_8
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __PASSES__
+#define __PASSES__
+
+#include <chrono>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "function.h"
+
+namespace Gisel
+{
+	struct node;
+	class compiler_context;
+
+	using node_ptr = std::unique_ptr<node>;
+	using node_pass = func::function<void(node_ptr&, compiler_context&)>;
+
+	// the passes built in the compiler, in the order they are registered; dispatch, loops and reorder
+	// are decisions the statement compiler takes as it builds statements, the manager switches and times them
+	enum struct pass
+	{
+		arithmetic, // exact rewrites of arithmetic on constants
+		dispatch,   // elif chains on one variable dispatched through case tables
+		loops,      // counted loops specialized on the range of their counter, short ones unrolled
+		reorder,    // the most taken branches of profiled elif chains tested first
+		flatten,    // arithmetic on numbers evaluated from one array of instructions instead of a tree
+	};
+
+	class pass_manager
+	{
+		public:
+			class timer;
+
+		private:
+			struct timing
+			{
+				std::chrono::steady_clock::duration elapsed{};
+				size_t runs = 0;
+			};
+
+			struct timings
+			{
+				std::vector<timing> passes;
+				timer* current = nullptr;
+			};
+
+		public:
+			// the time spent in a pass, without the time spent in the passes it runs itself
+			class timer
+			{
+				public:
+					timer(timings* t, size_t index);
+					~timer();
+
+				private:
+					timings* _timings;
+					size_t _index;
+					timer* _outer;
+					std::chrono::steady_clock::time_point _start;
+
+					timer(const timer&) = delete;
+					void operator=(const timer&) = delete;
+					void pause();
+					inline void resume() { _start = std::chrono::steady_clock::now(); }
+			};
+
+			static constexpr const int max_level = 2;
+
+			// the built-in passes, enabled as with -O2
+			pass_manager();
+
+			// transforms the typed tree of every expression after the passes registered before;
+			// the pass is enabled from the given optimization level on
+			void add_node_pass(std::string name, int level, node_pass transform);
+
+			// enables exactly the passes of the given level and the levels below
+			void set_level(int level);
+			inline int get_level() const noexcept { return _level; }
+
+			// returns false when there is no pass of that name
+			bool set_enabled(std::string_view name, bool enabled);
+			inline bool is_enabled(pass p) const noexcept { return _passes[size_t(p)].enabled; }
+
+			void run_node_passes(node_ptr& np, compiler_context& context) const;
+
+			// times p until the returned timer is destroyed
+			inline timer time(pass p) const { return timer(_timings.get(), size_t(p)); }
+
+			void write_timings(std::ostream& out) const;
+
+		private:
+			struct entry
+			{
+				std::string name;
+				int level;
+				bool enabled;
+				node_pass transform; // empty for the passes of the statement compiler
+			};
+
+			std::vector<entry> _passes;
+			int _level;
+			std::shared_ptr<timings> _timings; // shared by the copies of a manager
+	};
+}
+
+#endif // __PASSES__
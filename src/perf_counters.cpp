@@ -0,0 +1,117 @@
+/**
+ * This file is a part of the Gisel Interpreter
+ *
+ * Copyright (C) 2022 @kbz_8
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "perf_counters.h"
+
+#ifdef __linux__
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace Gisel
+{
+#ifdef __linux__
+	namespace
+	{
+		int open_counter(std::uint64_t config)
+		{
+			perf_event_attr attr;
+			std::memset(&attr, 0, sizeof(attr));
+			attr.type = PERF_TYPE_HARDWARE;
+			attr.size = sizeof(attr);
+			attr.config = config;
+			attr.disabled = 1;
+			attr.exclude_kernel = 1;
+			attr.exclude_hv = 1;
+			return int(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+		}
+	}
+
+	perf_counters::perf_counters()
+	{
+		const std::uint64_t configs[events_count] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_REFERENCES, PERF_COUNT_HW_CACHE_MISSES};
+		for(std::size_t i = 0; i < events_count; ++i)
+			_fds[i] = open_counter(configs[i]);
+	}
+
+	perf_counters::~perf_counters()
+	{
+		for(int fd : _fds)
+			if(fd >= 0)
+				close(fd);
+	}
+
+	void perf_counters::start()
+	{
+		for(int fd : _fds)
+		{
+			if(fd < 0)
+				continue;
+			ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+			ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+		}
+	}
+
+	void perf_counters::stop()
+	{
+		for(std::size_t i = 0; i < events_count; ++i)
+		{
+			if(_fds[i] < 0)
+				continue;
+			ioctl(_fds[i], PERF_EVENT_IOC_DISABLE, 0);
+			if(read(_fds[i], &_values[i], sizeof(_values[i])) != sizeof(_values[i]))
+			{
+				close(_fds[i]);
+				_fds[i] = -1;
+			}
+		}
+	}
+#else
+	perf_counters::perf_counters()
+	{
+		for(int& fd : _fds)
+			fd = -1;
+	}
+
+	perf_counters::~perf_counters() = default;
+	void perf_counters::start() {}
+	void perf_counters::stop() {}
+#endif
+
+	std::optional<std::uint64_t> perf_counters::get(event e) const
+	{
+		if(_fds[size_t(e)] < 0)
+			return std::nullopt;
+		return _values[size_t(e)];
+	}
+
+	const char* perf_counters::name(event e)
+	{
+		switch(e)
+		{
+			case event::cycles: return "cycles";
+			case event::instructions: return "instructions";
+			case event::cache_references: return "cache references";
+			case event::cache_misses: return "cache misses";
+		}
+		return "";
+	}
+}
@@ -0,0 +1,61 @@
+/**
+ * This file is a part of the Gisel Interpreter
+ *
+ * Copyright (C) 2022 @kbz_8
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef __PERF_COUNTERS__
+#define __PERF_COUNTERS__
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+namespace Gisel
+{
+	// hardware counters of the calling thread between start and stop, read through perf_event_open on linux;
+	// a counter the system does not provide, or does not let the process read, is empty
+	class perf_counters
+	{
+		public:
+			enum struct event
+			{
+				cycles,
+				instructions,
+				cache_references,
+				cache_misses,
+			};
+
+			static constexpr const std::size_t events_count = 4;
+
+			perf_counters();
+			~perf_counters();
+
+			void start();
+			void stop();
+
+			std::optional<std::uint64_t> get(event e) const;
+			static const char* name(event e);
+
+		private:
+			int _fds[events_count];
+			std::uint64_t _values[events_count] = {};
+
+			perf_counters(const perf_counters&) = delete;
+			void operator=(const perf_counters&) = delete;
+	};
+}
+
+#endif // __PERF_COUNTERS__
@@ -0,0 +1,34 @@
+/**
+ * This file is a part of the Gisel Interpreter
+ *
+ * Copyright (C) 2022 @kbz_8
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "program.h"
+
+namespace Gisel
+{
+	program::program(std::vector<expression<lvalue>::ptr> initializers, std::vector<function> functions, std::unordered_map<std::string, public_function> public_functions, bool lazy_globals) : _functions(std::move(functions)), _public_functions(std::move(public_functions)), _initializers(std::move(initializers)), _lazy_globals(lazy_globals), _running_tasks(0) {}
+
+	const function& program::get_public_function(const char* name) const { return _functions[_public_functions.find(name)->second.index]; }
+
+	const function* program::find_public_function(const std::string& name, const std::string& type) const
+	{
+		auto it = _public_functions.find(name);
+		if(it == _public_functions.end() || it->second.type != type)
+			return nullptr;
+		return &_functions[it->second.index];
+	}
+}
@@ -0,0 +1,74 @@
+/**
+ * This file is a part of the Gisel Interpreter
+ *
+ * Copyright (C) 2022 @kbz_8
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef __PROGRAM__
+#define __PROGRAM__
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "variable.h"
+#include "expression.h"
+
+namespace Gisel
+{
+	// what the compilation of a script leaves: its functions, the initializers of its globals and the table of its
+	// public functions; it is not modified once built, so any number of runtime contexts can run it at the same time
+	class program
+	{
+		public:
+			struct public_function
+			{
+				size_t index;
+				std::string type; // as written by std::to_string
+			};
+
+			// lazy globals are initialized on their first access instead of all at once
+			program(std::vector<expression<lvalue>::ptr> initializers, std::vector<function> functions, std::unordered_map<std::string, public_function> public_functions, bool lazy_globals = false);
+
+			inline const function& get_function(int idx) const { return _functions[idx]; }
+			inline const function* functions() const noexcept { return _functions.data(); }
+			inline size_t functions_count() const noexcept { return _functions.size(); }
+			const function& get_public_function(const char* name) const;
+			// null when there is no public function of that name and type
+			const function* find_public_function(const std::string& name, const std::string& type) const;
+
+			inline const expression<lvalue>& initializer(size_t idx) const { return *_initializers[idx]; }
+			inline size_t globals_count() const noexcept { return _initializers.size(); }
+			inline bool lazy_globals() const noexcept { return _lazy_globals; }
+
+			// the tasks spawned by the scripts that are not done, which the functions of the host may run
+			inline void task_started() const noexcept { _running_tasks.fetch_add(1, std::memory_order_relaxed); }
+			inline void task_finished() const noexcept { _running_tasks.fetch_sub(1, std::memory_order_release); }
+			inline size_t running_tasks() const noexcept { return _running_tasks.load(std::memory_order_acquire); }
+
+		private:
+			std::vector<function> _functions;
+			std::unordered_map<std::string, public_function> _public_functions;
+			std::vector<expression<lvalue>::ptr> _initializers;
+			bool _lazy_globals;
+			mutable std::atomic<size_t> _running_tasks;
+
+			program(const program&) = delete;
+			void operator=(const program&) = delete;
+	};
+}
+
+#endif // __PROGRAM__
@@ -0,0 +1,150 @@
+/**
+ * This file is a part of the Gisel Interpreter
+ *
+ * Copyright (C) 2022 @kbz_8
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "range_analysis.h"
+#include "expression_tree.h"
+#include "compiler_context.h"
+#include <algorithm>
+#include <cmath>
+
+namespace Gisel
+{
+	namespace
+	{
+		constexpr const double max_exact_integer = 9007199254740992.0; // 2^53
+
+		value_range boolean_range() { return value_range{0, 1, true, false}; }
+
+		// integers stay integers as long as they are exactly representable
+		value_range make_range(double a, double b, double c, double d, bool integral, bool negative_zero)
+		{
+			value_range ret{std::min({a, b, c, d}), std::max({a, b, c, d}), integral, negative_zero};
+			if(ret.integral && (ret.min < -max_exact_integer || ret.max > max_exact_integer))
+				ret.integral = false;
+			return ret;
+		}
+
+		// ints are integral, even when widened beyond 2^53
+		value_range integer_range() { return value_range{-9223372036854775808.0, 9223372036854775808.0, true, false}; }
+
+		std::optional<value_range> get_operation_range(const node_ptr& np, const compiler_context& context)
+		{
+			const std::vector<node_ptr>& children = np->get_children();
+
+			switch(np->get_node_operation())
+			{
+				case node_operation::positive:
+				case node_operation::to_number:
+				case node_operation::param: return get_range(children[0], context);
+
+				case node_operation::negative:
+					if(std::optional<value_range> r = get_range(children[0], context))
+						return value_range{-r->max, -r->min, r->integral, r->contains(0)};
+					return std::nullopt;
+
+				case node_operation::add:
+				case node_operation::sub:
+				case node_operation::mul:
+				{
+					std::optional<value_range> a = get_range(children[0], context);
+					std::optional<value_range> b = get_range(children[1], context);
+					if(!a || !b)
+						return std::nullopt;
+					const bool integral = a->integral && b->integral;
+
+					switch(np->get_node_operation())
+					{
+						case node_operation::add: return make_range(a->min + b->min, a->max + b->max, a->min + b->min, a->max + b->max, integral, a->negative_zero && b->negative_zero);
+						case node_operation::sub: return make_range(a->min - b->max, a->max - b->min, a->min - b->max, a->max - b->min, integral, a->negative_zero);
+						default:
+						{
+							const bool zero = a->contains(0) || b->contains(0) || a->negative_zero || b->negative_zero;
+							const bool negative = a->min < 0 || b->min < 0 || a->negative_zero || b->negative_zero;
+							return make_range(a->min * b->min, a->min * b->max, a->max * b->min, a->max * b->max, integral, zero && negative);
+						}
+					}
+				}
+
+				case node_operation::mod:
+				{
+					std::optional<value_range> a = get_range(children[0], context);
+					std::optional<value_range> b = get_range(children[1], context);
+					if(!a || !b || !a->is_int32() || !b->is_int32() || b->contains(0))
+						return std::nullopt;
+					const double m = std::max(std::fabs(b->min), std::fabs(b->max)) - 1;
+					return value_range{a->min < 0 ? -std::min(m, -a->min) : 0, a->max > 0 ? std::min(m, a->max) : 0, true, a->negative_zero};
+				}
+
+				case node_operation::lnot:
+				case node_operation::eq:
+				case node_operation::ne:
+				case node_operation::lt:
+				case node_operation::gt:
+				case node_operation::le:
+				case node_operation::ge:
+				case node_operation::land:
+				case node_operation::lor: return boolean_range();
+
+				case node_operation::ternary:
+				{
+					std::optional<value_range> a = get_range(children[1], context);
+					std::optional<value_range> b = get_range(children[2], context);
+					if(!a || !b)
+						return std::nullopt;
+					return value_range{std::min(a->min, b->min), std::max(a->max, b->max), a->integral && b->integral, a->negative_zero || b->negative_zero};
+				}
+
+				case node_operation::to_integer:
+					if(std::optional<value_range> r = get_range(children[0], context); r && r->is_int32())
+						return value_range{std::trunc(r->min), std::trunc(r->max), true, false};
+					return integer_range();
+
+				default: return std::nullopt;
+			}
+		}
+	}
+
+	std::optional<value_range> get_range(const node_ptr& np, const compiler_context& context)
+	{
+		if(np->get_type_id() == type_registry::get_integer_handle() && !(np->is_node_operation() && np->get_node_operation() == node_operation::to_integer))
+			return integer_range();
+		if(np->get_type_id() != type_registry::get_number_handle() && np->get_type_id() != type_registry::get_integer_handle())
+			return std::nullopt;
+
+		if(np->is_number())
+		{
+			const double d = np->get_number();
+			if(std::isnan(d))
+				return std::nullopt;
+			return value_range{d, d, d == std::trunc(d) && std::fabs(d) <= max_exact_integer, d == 0 && std::signbit(d)};
+		}
+
+		if(np->is_identifier())
+		{
+			if(const value_range* r = context.find_range(context.find(std::string(np->get_identifier()))))
+				return *r;
+			return std::nullopt;
+		}
+
+		if(np->is_node_operation())
+			return get_operation_range(np, context);
+
+		return std::nullopt;
+	}
+}
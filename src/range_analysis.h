@@ -0,0 +1,48 @@
+/**
+ * This file is a part of the Gisel Interpreter
+ *
+ * Copyright (C) 2022 @kbz_8
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __RANGE_ANALYSIS__
+#define __RANGE_ANALYSIS__
+
+#include <memory>
+#include <optional>
+
+namespace Gisel
+{
+	struct node;
+	class compiler_context;
+
+	using node_ptr = std::unique_ptr<node>;
+
+	// every value an expression can take lies in [min, max]
+	struct value_range
+	{
+		double min;
+		double max;
+		bool integral;
+		bool negative_zero; // -0 is one of the possible values
+
+		inline bool contains(double d) const noexcept { return min <= d && d <= max; }
+		inline bool is_int32() const noexcept { return integral && min >= -2147483647.0 && max <= 2147483647.0; }
+	};
+
+	std::optional<value_range> get_range(const node_ptr& np, const compiler_context& context);
+}
+
+#endif // __RANGE_ANALYSIS__
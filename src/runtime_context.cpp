@@ -19,59 +19,339 @@
 
 #include "runtime_context.h"
 #include "errors.h"
+#include <algorithm>
 
 namespace Gisel
 {
-	runtime_context::runtime_context(std::vector<expression<lvalue>::ptr> initializers, std::vector<function> functions, std::unordered_map<std::string, size_t> public_functions) : _functions(std::move(functions)), _public_functions(std::move(public_functions)), _initializers(std::move(initializers)), _retval_idx(0)
+	runtime_context::runtime_context(std::shared_ptr<const program> p, bool initialize_globals) : _pool(std::make_unique<value_pool>()), _program(std::move(p)), _functions(_program->functions()), _top(0), _retval_idx(0)
 	{
-		_globals.reserve(_initializers.size());
-		initialize();
+		if(initialize_globals)
+			initialize();
 	}
 
 	void runtime_context::initialize()
 	{
-		_globals.clear();
+		const size_t count = _program->globals_count();
 		
-		for(const auto& initializer : _initializers)
-			_globals.emplace_back(initializer->evaluate(*this));
+		_globals.assign(count, nullptr);
+		_shared.assign(count, false);
+		_written.clear();
+		
+		if(_program->lazy_globals())
+		{
+			_initializing.assign(count, false);
+			return;
+		}
+		
+		for(size_t i = 0; i < count; ++i)
+			_globals[i] = _program->initializer(i).evaluate(*this);
+	}
+
+	// a snapshot outlives the context that captured it, it must not hold values from its pool
+	variable_ptr detach(const variable_ptr& v)
+	{
+		if(!v)
+			return nullptr;
+		if(typeid(*v) == typeid(variable_impl<string>))
+			return std::make_shared<variable_impl<string>>(from_std_string(*static_cast<const variable_impl<string>&>(*v).value));
+		return v->clone();
+	}
+
+	void runtime_context::capture_globals()
+	{
+		auto snapshot = std::make_shared<std::vector<variable_ptr> >();
+		snapshot->reserve(_globals.size());
+		for(const variable_ptr& v : _globals)
+			snapshot->push_back(detach(v));
+		
+		_globals = *snapshot;
+		_snapshot = std::move(snapshot);
+		_shared.assign(_globals.size(), true);
+		_written.clear();
+	}
+
+	void runtime_context::reset_globals()
+	{
+		if(!_snapshot)
+		{
+			initialize();
+			return;
+		}
+		
+		for(size_t idx : _written)
+		{
+			_globals[idx] = (*_snapshot)[idx];
+			_shared[idx] = true;
+		}
+		_written.clear();
+		
+		if(_program->lazy_globals())
+			_initializing.assign(_globals.size(), false);
+	}
+
+	runtime_context runtime_context::clone() const
+	{
+		runtime_assertion(bool(_snapshot), "cloning a context whose globals were not captured");
+		
+		runtime_context ret(_program, false);
+		ret._snapshot = _snapshot;
+		ret._globals = *_snapshot;
+		ret._shared.assign(_globals.size(), true);
+		if(_program->lazy_globals())
+			ret._initializing.assign(_globals.size(), false);
+		return ret;
+	}
+
+	runtime_context runtime_context::fork() const
+	{
+		runtime_context ret(_program, false);
+		ret._globals = _globals;
+		ret._shared.assign(_globals.size(), true);
+		ret._initializing = _initializing;
+		ret._stack.assign(_stack.begin(), _stack.begin() + _top);
+		ret._top = _top;
+		ret._retval_idx = _retval_idx;
+		return ret;
+	}
+
+	runtime_context runtime_context::detached() const
+	{
+		runtime_context ret(_program, false);
+		ret._globals.reserve(_globals.size());
+		for(const variable_ptr& v : _globals)
+			ret._globals.push_back(detach(v));
+		ret._shared.assign(_globals.size(), false);
+		if(_program->lazy_globals())
+			ret._initializing.assign(_globals.size(), false);
+		return ret;
+	}
+
+	// a global whose initializer is running is left as it is, reading it is a cycle whichever context does
+	void runtime_context::initialize_lazy_globals()
+	{
+		if(!_program->lazy_globals())
+			return;
+		for(size_t i = 0; i < _globals.size(); ++i)
+			if(!_globals[i] && !_initializing[i])
+				initialize_global(int(i));
+	}
+
+	namespace
+	{
+		constexpr const char state_magic[8] = {'G', 'I', 'S', 'E', 'L', 'S', 'T', 'A'};
+		constexpr const std::uint32_t state_version = 1;
+
+		enum struct state_tag : std::uint8_t
+		{
+			uninitialized,
+			number,
+			integer,
+			string,
+			function,
+			empty_function,
+		};
+
+		// in the byte order of the machine; a file from another one does not match the hash of the program
+		template <typename T>
+		inline void write_raw(std::ostream& out, const T& value) { out.write(reinterpret_cast<const char*>(&value), sizeof(T)); }
+
+		template <typename T>
+		inline bool read_raw(std::istream& in, T& value) { return bool(in.read(reinterpret_cast<char*>(&value), sizeof(T))); }
+	}
+
+	void runtime_context::save_globals(std::ostream& out, std::uint64_t program_hash) const
+	{
+		out.write(state_magic, sizeof(state_magic));
+		write_raw(out, state_version);
+		write_raw(out, program_hash);
+		write_raw(out, std::uint64_t(_globals.size()));
+		
+		for(const variable_ptr& v : _globals)
+		{
+			if(!v)
+				write_raw(out, state_tag::uninitialized);
+			else if(typeid(*v) == typeid(variable_impl<number>))
+			{
+				write_raw(out, state_tag::number);
+				write_raw(out, static_cast<const variable_impl<number>&>(*v).value);
+			}
+			else if(typeid(*v) == typeid(variable_impl<integer>))
+			{
+				write_raw(out, state_tag::integer);
+				write_raw(out, static_cast<const variable_impl<integer>&>(*v).value);
+			}
+			else if(typeid(*v) == typeid(variable_impl<string>))
+			{
+				const std::string& s = *static_cast<const variable_impl<string>&>(*v).value;
+				write_raw(out, state_tag::string);
+				write_raw(out, std::uint64_t(s.size()));
+				out.write(s.data(), s.size());
+			}
+			else
+			{
+				const function& f = static_cast<const variable_impl<function>&>(*v).value;
+				if(!f)
+					write_raw(out, state_tag::empty_function);
+				else if(const function_reference* ref = f.target<function_reference>())
+				{
+					write_raw(out, state_tag::function);
+					write_raw(out, std::int64_t(ref->index()));
+				}
+				else
+					runtime_error("a global holds a function value that cannot be saved").expose();
+			}
+		}
+	}
+
+	bool runtime_context::restore_globals(std::istream& in, std::uint64_t program_hash)
+	{
+		char magic[sizeof(state_magic)];
+		std::uint32_t version;
+		std::uint64_t hash;
+		std::uint64_t count;
+		
+		if(!in.read(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), state_magic))
+			return false;
+		if(!read_raw(in, version) || version != state_version || !read_raw(in, hash) || hash != program_hash)
+			return false;
+		if(!read_raw(in, count) || count != _program->globals_count())
+			return false;
+		
+		std::vector<variable_ptr> globals(count);
+		
+		for(variable_ptr& v : globals)
+		{
+			state_tag tag;
+			if(!read_raw(in, tag))
+				return false;
+			
+			switch(tag)
+			{
+				case state_tag::uninitialized:
+					if(!_program->lazy_globals())
+						return false;
+				break;
+				case state_tag::number:
+				{
+					number value;
+					if(!read_raw(in, value))
+						return false;
+					v = make_variable<number>(value);
+				}
+				break;
+				case state_tag::integer:
+				{
+					integer value;
+					if(!read_raw(in, value))
+						return false;
+					v = make_variable<integer>(value);
+				}
+				break;
+				case state_tag::string:
+				{
+					std::uint64_t size;
+					if(!read_raw(in, size))
+						return false;
+					std::string value(size, '\0');
+					if(!in.read(value.data(), size))
+						return false;
+					v = make_variable<string>(make_string(std::move(value)));
+				}
+				break;
+				case state_tag::function:
+				{
+					std::int64_t idx;
+					if(!read_raw(in, idx) || idx < 0 || std::uint64_t(idx) >= _program->functions_count())
+						return false;
+					v = make_variable<function>(function(function_reference(int(idx))));
+				}
+				break;
+				case state_tag::empty_function: v = make_variable<function>(function()); break;
+				default: return false;
+			}
+		}
+		
+		_globals = std::move(globals);
+		_shared.assign(count, false);
+		_written.clear();
+		if(_program->lazy_globals())
+			_initializing.assign(count, false);
+		return true;
+	}
+
+	// the first write of a global copies its value out of the snapshot
+	void runtime_context::unshare_global(int idx)
+	{
+		_globals[idx] = _globals[idx]->clone();
+		_shared[idx] = false;
+		_written.push_back(idx);
 	}
 
-	variable_ptr& runtime_context::global(int idx)
+	// the initializers of lazy globals run in the order their values are needed
+	void runtime_context::initialize_global(int idx)
 	{
-		runtime_assertion(idx < _globals.size(), "uninitialized global variable access");
-		return _globals[idx];
+		runtime_assertion(_program->lazy_globals(), "uninitialized global variable access");
+		runtime_assertion(!_initializing[idx], "cyclic initialization of global variables");
+		
+		_initializing[idx] = true;
+		variable_ptr value = _program->initializer(idx).evaluate(*this);
+		_initializing[idx] = false;
+		_globals[idx] = std::move(value);
+		
+		if(_shared[idx])
+		{
+			_shared[idx] = false;
+			_written.push_back(idx);
+		}
 	}
 
 	variable_ptr& runtime_context::retval() { return _stack[_retval_idx]; }
 	variable_ptr& runtime_context::local(int idx) { return _stack[_retval_idx + idx]; }
-	const function& runtime_context::get_function(int idx) const { return _functions[idx]; }
-	const function& runtime_context::get_public_function(const char* name) const { return _functions[_public_functions.find(name)->second]; }
 	runtime_context::scope runtime_context::enter_scope() { return scope(*this); }
-	void runtime_context::push(variable_ptr v) { _stack.push_back(std::move(v)); }
+
+	void runtime_context::push(variable_ptr v)
+	{
+		if(_top == _stack.size())
+			_stack.push_back(std::move(v));
+		else
+			_stack[_top] = std::move(v);
+		++_top;
+	}
 
 	variable_ptr runtime_context::call(const function& f, std::vector<variable_ptr> params)
 	{
-		for(size_t i = params.size(); i > 0; --i)
-			_stack.push_back(std::move(params[i-1]));
+		for(variable_ptr& param : params)
+			push(std::move(param));
+		return call_pushed(f, params.size());
+	}
+
+	variable_ptr runtime_context::call_pushed(const function& f, size_t count)
+	{
+		runtime_assertion(bool(f), "uninitialized function call");
+		return call_defined(f, count);
+	}
+
+	variable_ptr runtime_context::call_defined(const function& f, size_t count)
+	{
+		// the first argument lies just below the return value
+		std::reverse(_stack.begin() + (_top - count), _stack.begin() + _top);
 
 		size_t old_retval_idx = _retval_idx;
 		
-		_retval_idx = _stack.size();
-		_stack.resize(_retval_idx + 1);
-		
-		runtime_assertion(bool(f), "uninitialized function call");
+		_retval_idx = _top;
+		push(nullptr);
 		
 		f(*this);
 		
 		variable_ptr ret = std::move(_stack[_retval_idx]);
 		
-		_stack.resize(_retval_idx - params.size());
+		_top = _retval_idx - count;
 		
 		_retval_idx = old_retval_idx;
 		
 		return ret;
 	}
 
-	runtime_context::scope::scope(runtime_context& context): _context(context), _stack_size(context._stack.size()) {}
-	runtime_context::scope::~scope() { _context._stack.resize(_stack_size); }
+	runtime_context::scope::scope(runtime_context& context): _context(context), _top(context._top) {}
+	runtime_context::scope::~scope() { _context._top = _top; }
 }
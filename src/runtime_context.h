@@ -23,13 +23,32 @@
 #include <variant>
 #include <vector>
 #include <deque>
+#include <cstdint>
+#include <istream>
+#include <ostream>
 #include <stack>
 #include <string>
+#include <typeinfo>
 #include "variable.h"
 #include "expression.h"
+#include "value_pool.h"
+#include "program.h"
 
 namespace Gisel
 {
+	// the value of a function of the program: it runs the function of the context it is called in,
+	// and is known by its index, so that it can be saved
+	class function_reference
+	{
+		public:
+			explicit function_reference(int idx) noexcept : _idx(idx) {}
+			inline int index() const noexcept { return _idx; }
+			void operator()(runtime_context& context) const;
+
+		private:
+			int _idx;
+	};
+
 	class runtime_context
 	{
 		class scope
@@ -40,33 +59,124 @@ namespace Gisel
 
 			private:
 				runtime_context& _context;
-				size_t _stack_size;
+				size_t _top;
 		};
 
 		public:
-			runtime_context(std::vector<expression<lvalue>::ptr> initializers, std::vector<function> functions, std::unordered_map<std::string, size_t> public_functions);
+			// a context has its own stack and globals, and shares the program it runs with the other contexts;
+			// the globals of a context that does not initialize them are left to initialize or restore_globals
+			explicit runtime_context(std::shared_ptr<const program> p, bool initialize_globals = true);
+			
+			inline const std::shared_ptr<const program>& get_program() const noexcept { return _program; }
 			
 			void initialize();
-			variable_ptr& global(int idx);
+			
+			// the globals as they are now become the state reset_globals goes back to and clones start from; their
+			// values are shared with the snapshot until written, so a reset only restores the globals written since
+			void capture_globals();
+			inline bool has_snapshot() const noexcept { return bool(_snapshot); }
+			// initializes the globals again when none were captured
+			void reset_globals();
+			// a context with the functions of this one, and the globals of its snapshot
+			runtime_context clone() const;
+			// a context for another thread, which goes on with the frame this one is running: it reads the locals
+			// and the globals of this one as they are, and writes the globals into copies of its own
+			runtime_context fork() const;
+			// a context for a task that another thread runs: it starts from copies of the globals of this one
+			// as they are now, and its writes to them are its own
+			runtime_context detached() const;
+			// runs the initializers of the lazy globals not initialized yet, so that the contexts forked or detached
+			// from this one start from their values instead of running the initializers again in copies of their own
+			void initialize_lazy_globals();
+			
+			// writes the globals for the program of the given hash; function values are saved as the index of their function
+			void save_globals(std::ostream& out, std::uint64_t program_hash) const;
+			// reads back what save_globals wrote for the same program, and returns false without
+			// touching the globals when the stream was written by another program or version
+			bool restore_globals(std::istream& in, std::uint64_t program_hash);
+			
+			inline variable_ptr& global(int idx)
+			{
+				variable_ptr& slot = _globals[idx];
+				if(!slot)
+					initialize_global(idx);
+				return slot;
+			}
+			// the slots of the globals are allocated once and for all, an initialized one is read without any check
+			inline variable_ptr& initialized_global(int idx) noexcept { return _globals[idx]; }
+			// the same, for an access that may write the global
+			inline variable_ptr& writable_global(int idx)
+			{
+				variable_ptr& slot = global(idx);
+				if(_shared[idx])
+					unshare_global(idx);
+				return slot;
+			}
+			inline variable_ptr& writable_initialized_global(int idx)
+			{
+				if(_shared[idx])
+					unshare_global(idx);
+				return _globals[idx];
+			}
 			variable_ptr& retval();
 			variable_ptr& local(int idx);
 
-			const function& get_function(int idx) const;
-			const function& get_public_function(const char* name) const;
+			inline const function& get_function(int idx) const { return _functions[idx]; }
+			inline const function& get_public_function(const char* name) const { return _program->get_public_function(name); }
 
 			scope enter_scope();
 			void push(variable_ptr v);
+			template <typename T>
+			void push_value(T value);
+			
+			// the values of a context are allocated from its pool
+			template <typename T>
+			inline std::shared_ptr<variable_impl<T> > make_variable(T value) { return std::allocate_shared<variable_impl<T> >(pool_allocator<variable_impl<T> >(_pool.get()), std::move(value)); }
+			inline string make_string(std::string value) { return std::allocate_shared<std::string>(pool_allocator<std::string>(_pool.get()), std::move(value)); }
 			
 			variable_ptr call(const function& f, std::vector<variable_ptr> params);
+			// calls f with the last count values pushed as its arguments, in the order they were pushed
+			variable_ptr call_pushed(const function& f, size_t count);
+			// the same, for an f known to be defined
+			variable_ptr call_defined(const function& f, size_t count);
 
 		private:
-			std::vector<function> _functions;
-			std::unordered_map<std::string, size_t> _public_functions;
-			std::vector<expression<lvalue>::ptr> _initializers;
+			std::unique_ptr<value_pool> _pool; // outlives every value of the context, and stays in place when it is moved
+			std::shared_ptr<const program> _program;
+			const function* _functions; // those of the program
 			std::vector<variable_ptr> _globals;
+			std::vector<bool> _initializing; // the lazy globals whose initializer is running
+			std::shared_ptr<const std::vector<variable_ptr> > _snapshot;
+			std::vector<bool> _shared; // the globals whose value is still the one of the snapshot
+			std::vector<size_t> _written; // the globals no longer shared, restored by reset_globals
 			std::deque<variable_ptr> _stack;
+			size_t _top;
 			size_t _retval_idx;
+			
+			void initialize_global(int idx);
+			void unshare_global(int idx);
 	};
+
+	// a copy of v which does not belong to the pool of any context, so that any thread can own it
+	variable_ptr detach(const variable_ptr& v);
+
+	inline void function_reference::operator()(runtime_context& context) const { context.get_function(_idx)(context); }
+
+	// slots above the top of the stack keep their variables alive, so that
+	// locals which are never referenced elsewhere can reuse the same box
+	template <typename T>
+	void runtime_context::push_value(T value)
+	{
+		if(_top == _stack.size())
+			_stack.emplace_back();
+
+		variable_ptr& slot = _stack[_top++];
+
+		if(slot && slot.use_count() == 1 && typeid(*slot) == typeid(variable_impl<T>))
+			static_cast<variable_impl<T>&>(*slot).value = std::move(value);
+		else
+			slot = make_variable<T>(std::move(value));
+	}
 }
 
 #endif // __RUNTIME_CONTEXT__
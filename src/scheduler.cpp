@@ -0,0 +1,373 @@
+/**
+ * This file is a part of the Gisel Interpreter
+ *
+ * Copyright (C) 2022 @kbz_8
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+#include "scheduler.h"
+#include "sleepers.h"
+
+namespace Gisel
+{
+	namespace
+	{
+		// set in the workers, and in a thread while it runs a loop
+		thread_local bool in_loop = false;
+		// the participant number of a worker, 0 in the other threads
+		thread_local size_t worker = 0;
+		
+		constexpr const size_t initial_deque_capacity = 64;
+
+		// the iterations a loop splits among its participants at once
+		constexpr const size_t max_trips = 0xffffffff;
+
+		inline std::uint64_t pack(size_t begin, size_t end) noexcept { return std::uint64_t(end) << 32 | std::uint64_t(begin); }
+		inline size_t range_begin(std::uint64_t range) noexcept { return size_t(range & 0xffffffff); }
+		inline size_t range_end(std::uint64_t range) noexcept { return size_t(range >> 32); }
+	}
+
+	scheduler& scheduler::instance()
+	{
+		// never destroyed: a runtime error exits the process from any thread, the workers included
+		static scheduler* s = new scheduler();
+		return *s;
+	}
+
+	scheduler::task_deque::task_deque() : _top(0), _bottom(0)
+	{
+		_buffers.push_back(std::make_unique<buffer>(initial_deque_capacity));
+		_buffer.store(_buffers.back().get(), std::memory_order_relaxed);
+	}
+
+	void scheduler::task_deque::push(task* t)
+	{
+		const std::int64_t b = _bottom.load(std::memory_order_relaxed);
+		const std::int64_t top = _top.load(std::memory_order_acquire);
+		buffer* a = _buffer.load(std::memory_order_relaxed);
+		
+		if(size_t(b - top) >= a->capacity())
+		{
+			auto grown = std::make_unique<buffer>(a->capacity() * 2);
+			for(std::int64_t i = top; i < b; ++i)
+				grown->put(i, a->get(i));
+			a = grown.get();
+			_buffers.push_back(std::move(grown));
+			_buffer.store(a, std::memory_order_release);
+		}
+		
+		a->put(b, t);
+		std::atomic_thread_fence(std::memory_order_release);
+		_bottom.store(b + 1, std::memory_order_relaxed);
+	}
+
+	scheduler::task* scheduler::task_deque::pop()
+	{
+		const std::int64_t b = _bottom.load(std::memory_order_relaxed) - 1;
+		buffer* a = _buffer.load(std::memory_order_relaxed);
+		_bottom.store(b, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		std::int64_t top = _top.load(std::memory_order_relaxed);
+		
+		if(top > b)
+		{
+			_bottom.store(b + 1, std::memory_order_relaxed);
+			return nullptr;
+		}
+		
+		task* t = a->get(b);
+		if(top == b)
+		{
+			// the last task, which a thief may take at the same time
+			if(!_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+				t = nullptr;
+			_bottom.store(b + 1, std::memory_order_relaxed);
+		}
+		return t;
+	}
+
+	scheduler::task* scheduler::task_deque::steal()
+	{
+		std::int64_t top = _top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		const std::int64_t b = _bottom.load(std::memory_order_acquire);
+		
+		if(top >= b)
+			return nullptr;
+		
+		task* t = _buffer.load(std::memory_order_acquire)->get(top);
+		if(!_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			return nullptr;
+		return t;
+	}
+
+	scheduler::scheduler() : _loop(nullptr), _generation(0), _running(0), _busy(false), _stopping(false), _queued(0), _idle_workers(0), _waiting_threads(0)
+	{
+		const size_t threads = std::thread::hardware_concurrency();
+		start(threads > 1 ? threads - 1 : 0);
+	}
+
+	void scheduler::set_threads(size_t threads)
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_finished.wait(lock, [this]() { return !_busy; });
+		_busy = true;
+		lock.unlock();
+		
+		stop();
+		start(threads > 1 ? threads - 1 : 0);
+		
+		lock.lock();
+		_busy = false;
+		lock.unlock();
+		_finished.notify_all();
+	}
+
+	bool scheduler::parallel_for(size_t trips, const range_body& body)
+	{
+		if(in_loop)
+			return false;
+		
+		std::unique_lock<std::mutex> lock(_mutex);
+		if(_busy || _workers.empty())
+			return false;
+		_busy = true;
+		const size_t participants = _workers.size() + 1;
+		lock.unlock();
+		
+		in_loop = true;
+		for(size_t offset = 0; offset < trips; offset += max_trips)
+		{
+			const size_t count = std::min(trips - offset, max_trips);
+			
+			// the iterations are shared evenly, and taken by small chunks so that there are some left to steal
+			loop l{&body, offset, std::max<size_t>(1, count / (participants * 16)), std::vector<range_slot>(participants)};
+			for(size_t p = 0; p < participants; ++p)
+				l.slots[p].range.store(pack(count * p / participants, count * (p + 1) / participants), std::memory_order_relaxed);
+			
+			lock.lock();
+			_loop = &l;
+			++_generation;
+			_running = participants - 1;
+			lock.unlock();
+			_started.notify_all();
+			
+			run(l, 0);
+			
+			lock.lock();
+			_finished.wait(lock, [this]() { return _running == 0; });
+			_loop = nullptr;
+			lock.unlock();
+		}
+		in_loop = false;
+		
+		lock.lock();
+		_busy = false;
+		lock.unlock();
+		_finished.notify_all();
+		return true;
+	}
+
+	void scheduler::spawn(task t)
+	{
+		task* queued = new task(std::move(t));
+		
+		// counted first, so that the count is never short of the tasks that can be taken
+		_queued.fetch_add(1, std::memory_order_seq_cst);
+		if(worker != 0)
+			_deques[worker - 1]->push(queued);
+		else
+		{
+			std::lock_guard<std::mutex> lock(_queue_mutex);
+			_queue.push_back(queued);
+		}
+		
+		wake_all(_mutex, _started, _idle_workers);
+		wake_all(_mutex, _progress, _waiting_threads);
+	}
+
+	void scheduler::help_until(const func::function<bool()>& done)
+	{
+		while(!done())
+		{
+			if(task* t = take(worker))
+			{
+				run_task(t);
+				continue;
+			}
+			
+			// the task waited for runs on another thread
+			std::unique_lock<std::mutex> lock(_mutex);
+			sleep_until(lock, _progress, _waiting_threads, [&]() { return _queued.load(std::memory_order_relaxed) != 0 || done(); });
+		}
+	}
+
+	// the own deque first, for the tasks whose data are the most likely in cache, then the shared queue, then the other deques;
+	// a thread out of the workers takes the newest task of the shared queue, its own last spawn, so that its joins nest
+	// no deeper than the calls would
+	scheduler::task* scheduler::take(size_t p)
+	{
+		task* t = p != 0 ? _deques[p - 1]->pop() : nullptr;
+		
+		if(!t && _queued.load(std::memory_order_relaxed) != 0)
+		{
+			std::lock_guard<std::mutex> lock(_queue_mutex);
+			if(!_queue.empty())
+			{
+				if(p != 0)
+				{
+					t = _queue.front();
+					_queue.pop_front();
+				}
+				else
+				{
+					t = _queue.back();
+					_queue.pop_back();
+				}
+			}
+		}
+		
+		for(size_t i = 0; !t && i < _deques.size(); ++i)
+		{
+			const size_t q = (p + i) % _deques.size();
+			if(q + 1 != p)
+				t = _deques[q]->steal();
+		}
+		
+		if(t)
+			_queued.fetch_sub(1, std::memory_order_relaxed);
+		return t;
+	}
+
+	// the loops of a task run serially, the workers may be waiting for the task instead of taking part in them
+	void scheduler::run_task(task* t)
+	{
+		const bool was_in_loop = in_loop;
+		in_loop = true;
+		(*t)();
+		in_loop = was_in_loop;
+		delete t;
+		wake_all(_mutex, _progress, _waiting_threads);
+	}
+
+	void scheduler::start(size_t workers)
+	{
+		for(size_t p = 1; p <= workers; ++p)
+			_deques.push_back(std::make_unique<task_deque>());
+		for(size_t p = 1; p <= workers; ++p)
+			_workers.emplace_back(&scheduler::run_worker, this, p, _generation);
+	}
+
+	void scheduler::stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_stopping = true;
+		}
+		_started.notify_all();
+		for(std::thread& t : _workers)
+			t.join();
+		_workers.clear();
+		_stopping = false;
+		
+		// the tasks left to the workers go to the threads that wait for them
+		for(const std::unique_ptr<task_deque>& d : _deques)
+			while(task* t = d->pop())
+				_queue.push_back(t);
+		_deques.clear();
+	}
+
+	// the workers start between loops, and take part in the loops after the given generation;
+	// they run the queued tasks in between
+	void scheduler::run_worker(size_t p, std::uint64_t generation)
+	{
+		in_loop = true;
+		worker = p;
+		
+		std::unique_lock<std::mutex> lock(_mutex);
+		
+		for(;;)
+		{
+			if(_stopping)
+				return;
+			
+			if(_generation != generation)
+			{
+				generation = _generation;
+				
+				loop& l = *_loop;
+				lock.unlock();
+				run(l, p);
+				lock.lock();
+				
+				if(--_running == 0)
+					_finished.notify_all();
+				continue;
+			}
+			
+			lock.unlock();
+			task* t = take(p);
+			if(t)
+				run_task(t);
+			lock.lock();
+			
+			if(!t)
+				sleep_until(lock, _started, _idle_workers, [&]() { return _stopping || _generation != generation || _queued.load(std::memory_order_relaxed) != 0; });
+		}
+	}
+
+	void scheduler::run(loop& l, size_t p)
+	{
+		std::atomic<std::uint64_t>& own = l.slots[p].range;
+		const size_t participants = l.slots.size();
+		
+		for(;;)
+		{
+			std::uint64_t range = own.load(std::memory_order_acquire);
+			
+			while(range_begin(range) < range_end(range))
+			{
+				const size_t begin = range_begin(range);
+				const size_t end = std::min(range_end(range), begin + l.grain);
+				if(own.compare_exchange_weak(range, pack(end, range_end(range)), std::memory_order_acq_rel))
+				{
+					(*l.body)(p, l.offset + begin, l.offset + end);
+					range = own.load(std::memory_order_acquire);
+				}
+			}
+			
+			// out of iterations: the upper half of the largest range left is stolen, and the loop
+			// is over for this participant once there is none; a range being stolen is run by its thief
+			size_t victim = p;
+			std::uint64_t stolen = 0;
+			for(size_t i = 1; i < participants; ++i)
+			{
+				const size_t q = (p + i) % participants;
+				const std::uint64_t r = l.slots[q].range.load(std::memory_order_acquire);
+				if(range_end(r) - range_begin(r) > range_end(stolen) - range_begin(stolen))
+				{
+					victim = q;
+					stolen = r;
+				}
+			}
+			if(victim == p)
+				return;
+			
+			const size_t middle = range_begin(stolen) + (range_end(stolen) - range_begin(stolen)) / 2;
+			if(l.slots[victim].range.compare_exchange_strong(stolen, pack(range_begin(stolen), middle), std::memory_order_acq_rel))
+				own.store(pack(middle, range_end(stolen)), std::memory_order_release);
+		}
+	}
+}
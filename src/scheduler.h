@@ -0,0 +1,140 @@
+/**
+ * This file is a part of the Gisel Interpreter
+ *
+ * Copyright (C) 2022 @kbz_8
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef __SCHEDULER__
+#define __SCHEDULER__
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "function.h"
+
+namespace Gisel
+{
+	// the threads that run the iterations of parallel loops and the tasks spawned by the scripts, shared by
+	// every context of the process; the thread running a loop takes part in it, and the ones that run out of
+	// iterations steal half of the iterations left to another
+	class scheduler
+	{
+		public:
+			// runs the iterations [begin, end) as participant p, numbered from 0 for the thread running the loop
+			using range_body = func::function<void(size_t p, size_t begin, size_t end)>;
+			using task = func::function<void()>;
+
+			static scheduler& instance();
+
+			// the threads taking part in a loop, the one running it included; no loop or task may run meanwhile
+			void set_threads(size_t threads);
+			inline size_t participants() const noexcept { return _workers.size() + 1; }
+
+			// false without running anything when there is no other thread, or when they are
+			// busy with another loop, including a loop running from one of its iterations
+			bool parallel_for(size_t trips, const range_body& body);
+
+			// queues t to run once on any thread: a worker queues it on a deque of its own, which the others
+			// steal from when they run out of tasks, and the other threads on a queue shared by the workers
+			void spawn(task t);
+			// runs the queued tasks until done returns true, and sleeps while there is none; the thread
+			// waiting for a task runs it itself when no worker took it, there may be none
+			void help_until(const func::function<bool()>& done);
+
+		private:
+			// the deque of Chase and Lev, with the memory orders of Lê et al.: its worker pushes and pops
+			// tasks at the bottom, and the other threads steal them from the top
+			class task_deque
+			{
+				public:
+					task_deque();
+					void push(task* t);
+					task* pop();
+					// null when the deque is empty, or when another thread took the task first
+					task* steal();
+
+				private:
+					struct buffer
+					{
+						explicit buffer(size_t capacity) : mask(capacity - 1), slots(new std::atomic<task*>[capacity]) {}
+						inline size_t capacity() const noexcept { return mask + 1; }
+						inline task* get(std::int64_t i) const noexcept { return slots[size_t(i) & mask].load(std::memory_order_relaxed); }
+						inline void put(std::int64_t i, task* t) noexcept { slots[size_t(i) & mask].store(t, std::memory_order_relaxed); }
+
+						size_t mask;
+						std::unique_ptr<std::atomic<task*>[]> slots;
+					};
+
+					alignas(64) std::atomic<std::int64_t> _top;
+					alignas(64) std::atomic<std::int64_t> _bottom;
+					std::atomic<buffer*> _buffer;
+					std::vector<std::unique_ptr<buffer> > _buffers; // the ones outgrown too, which thieves may still read
+
+					task_deque(const task_deque&) = delete;
+					void operator=(const task_deque&) = delete;
+			};
+
+			// a range of iterations [begin, end), packed in the low and high halves of a word
+			struct alignas(64) range_slot
+			{
+				std::atomic<std::uint64_t> range;
+			};
+
+			struct loop
+			{
+				const range_body* body;
+				size_t offset;
+				size_t grain;
+				std::vector<range_slot> slots; // one for every participant
+			};
+
+			std::mutex _mutex;
+			std::condition_variable _started;
+			std::condition_variable _finished;
+			std::vector<std::thread> _workers;
+			loop* _loop;
+			std::uint64_t _generation;
+			size_t _running; // the workers yet to leave the current loop
+			bool _busy;
+			bool _stopping;
+			
+			std::vector<std::unique_ptr<task_deque> > _deques; // the one of worker p at p - 1
+			std::mutex _queue_mutex;
+			std::deque<task*> _queue;
+			std::atomic<size_t> _queued; // the tasks not taken yet
+			std::atomic<size_t> _idle_workers;
+			std::atomic<size_t> _waiting_threads; // in help_until
+			std::condition_variable _progress; // a task was queued or is done
+
+			scheduler();
+			void start(size_t workers);
+			void stop();
+			void run_worker(size_t p, std::uint64_t generation);
+			static void run(loop& l, size_t p);
+			
+			task* take(size_t p);
+			void run_task(task* t);
+
+			scheduler(const scheduler&) = delete;
+			void operator=(const scheduler&) = delete;
+	};
+}
+
+#endif // __SCHEDULER__
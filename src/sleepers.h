@@ -0,0 +1,67 @@
+/**
+ * This file is a part of the Gisel Interpreter
+ *
+ * Copyright (C) 2022 @kbz_8
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef __SLEEPERS__
+#define __SLEEPERS__
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+namespace Gisel
+{
+	// the threads sleeping on a condition variable count themselves under its mutex before they check what
+	// they wait for, so either they see what was done before the wake up, or the wake up sees them; a wake
+	// up takes no lock when nobody sleeps
+
+	// sleeps on cv until ready, with lock held on the mutex of cv
+	template <class P>
+	inline void sleep_until(std::unique_lock<std::mutex>& lock, std::condition_variable& cv, std::atomic<size_t>& sleepers, P ready)
+	{
+		sleepers.fetch_add(1, std::memory_order_seq_cst);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		cv.wait(lock, ready);
+		sleepers.fetch_sub(1, std::memory_order_relaxed);
+	}
+
+	// true once the sleepers, if any, are waiting on the condition variable of mutex
+	inline bool reach_sleepers(std::mutex& mutex, const std::atomic<size_t>& sleepers)
+	{
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if(sleepers.load(std::memory_order_relaxed) == 0)
+			return false;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+		}
+		return true;
+	}
+
+	inline void wake_one(std::mutex& mutex, std::condition_variable& cv, const std::atomic<size_t>& sleepers)
+	{
+		if(reach_sleepers(mutex, sleepers))
+			cv.notify_one();
+	}
+
+	inline void wake_all(std::mutex& mutex, std::condition_variable& cv, const std::atomic<size_t>& sleepers)
+	{
+		if(reach_sleepers(mutex, sleepers))
+			cv.notify_all();
+	}
+}
+
+#endif // __SLEEPERS__
@@ -18,9 +18,17 @@
  */
 
 #include <unordered_map>
+#include <algorithm>
+#include <optional>
+#include <cstdint>
+#include <cmath>
+#include <cassert>
 #include "statement.h"
 #include "expression.h"
 #include "runtime_context.h"
+#include "compiler_context.h"
+#include "loop_analysis.h"
+#include "scheduler.h"
 
 namespace Gisel
 {
@@ -45,7 +53,7 @@ namespace Gisel
 				
 				flow execute(runtime_context& context) override 
 				{
-					context.enter_scope();
+					auto _ = context.enter_scope();
 					for(const statement_ptr& statement : _statements)
 					{
 						if(flow f = statement->execute(context); f.type() != flow_type::f_normal)
@@ -61,17 +69,17 @@ namespace Gisel
 		class local_declaration_statement: public statement
 		{
 			public:
-				local_declaration_statement(std::vector<expression<lvalue>::ptr> decls) : _decls(std::move(decls)) {}
+				local_declaration_statement(std::vector<expression<void>::ptr> decls) : _decls(std::move(decls)) {}
 				
 				flow execute(runtime_context& context) override
 				{
-					for(const expression<lvalue>::ptr& decl : _decls)
-						context.push(decl->evaluate(context));
+					for(const expression<void>::ptr& decl : _decls)
+						decl->evaluate(context);
 					return flow::normal_flow();
 				}
 
 			private:
-				std::vector<expression<lvalue>::ptr> _decls;
+				std::vector<expression<void>::ptr> _decls;
 		};
 		
 		class break_statement: public statement
@@ -113,9 +121,53 @@ namespace Gisel
 			public:
 				if_statement(std::vector<expression<number>::ptr> exprs, std::vector<statement_ptr> statements) : _exprs(std::move(exprs)), _statements(std::move(statements)) {}
 				
-				flow execute(runtime_context& context) override
+				flow execute(runtime_context& context) override { return _statements[select(context)]->execute(context); }
+
+			protected:
+				std::vector<expression<number>::ptr> _exprs;
+				std::vector<statement_ptr> _statements;
+				
+				// the branch to run, the last one when no condition holds
+				inline size_t select(runtime_context& context) const
 				{
 					for(size_t i = 0; i < _exprs.size(); ++i)
+					{
+						if(_exprs[i]->evaluate(context))
+							return i;
+					}
+					return _exprs.size();
+				}
+		};
+		
+		class profiled_if_statement: public if_statement
+		{
+			public:
+				profiled_if_statement(std::vector<expression<number>::ptr> exprs, std::vector<statement_ptr> statements, std::vector<size_t>& hits) : if_statement(std::move(exprs), std::move(statements)), _hits(hits) {}
+				
+				flow execute(runtime_context& context) override
+				{
+					size_t i = select(context);
+					++_hits[i];
+					return _statements[i]->execute(context);
+				}
+
+			private:
+				std::vector<size_t>& _hits;
+		};
+		
+		// a chain of disjoint conditions tested from the most taken branch
+		class reordered_if_statement: public if_statement
+		{
+			public:
+				reordered_if_statement(std::vector<expression<number>::ptr> exprs, std::vector<statement_ptr> statements, std::vector<size_t> order, expression<number>::ptr discriminant) : if_statement(std::move(exprs), std::move(statements)), _order(std::move(order)), _discriminant(std::move(discriminant)) {}
+				
+				flow execute(runtime_context& context) override
+				{
+					// NaN is equal to everything, so the first branch is the one taken
+					if(_discriminant && std::isnan(_discriminant->evaluate(context)))
+						return _statements.front()->execute(context);
+					
+					for(size_t i : _order)
 					{
 						if(_exprs[i]->evaluate(context))
 							return _statements[i]->execute(context);
@@ -124,29 +176,184 @@ namespace Gisel
 				}
 
 			private:
-				std::vector<expression<number>::ptr> _exprs;
+				std::vector<size_t> _order;
+				expression<number>::ptr _discriminant;
+		};
+		
+		// the branches are chosen by the case of the value of expr equal to it, in a vector
+		// when the cases are close enough integers, by a binary search when there are few of them
+		template <typename T>
+		class case_table
+		{
+			using key = typename std::conditional<std::is_same<T, string>::value, std::string, T>::type;
+			
+			public:
+				case_table(std::unordered_map<key, size_t> cases, size_t dflt) : _first(), _dflt(dflt)
+				{
+					if constexpr(!std::is_same<T, string>::value)
+					{
+						if(is_dense(cases))
+						{
+							_dense.assign(size_t(distance(_first, max_key(cases)) + 1), dflt);
+							for(const auto& [k, branch] : cases)
+								_dense[size_t(distance(_first, k))] = branch;
+							return;
+						}
+						if(cases.size() <= max_sorted_cases)
+						{
+							_sorted.assign(cases.begin(), cases.end());
+							std::sort(_sorted.begin(), _sorted.end());
+							return;
+						}
+					}
+					_sparse = std::move(cases);
+				}
+				
+				inline size_t find(const key& k) const
+				{
+					if constexpr(std::is_same<T, number>::value)
+					{
+						if(!_dense.empty())
+						{
+							number i = k - _first;
+							return i >= 0 && i < _dense.size() && i == std::floor(i) ? _dense[size_t(i)] : _dflt;
+						}
+					}
+					else if constexpr(std::is_same<T, integer>::value)
+					{
+						if(!_dense.empty())
+						{
+							std::uint64_t i = std::uint64_t(k) - std::uint64_t(_first);
+							return i < _dense.size() ? _dense[i] : _dflt;
+						}
+					}
+					
+					if constexpr(!std::is_same<T, string>::value)
+					{
+						if(!_sorted.empty())
+						{
+							auto it = std::lower_bound(_sorted.begin(), _sorted.end(), k, [](const auto& c, const key& k) { return c.first < k; });
+							return it != _sorted.end() && it->first == k ? it->second : _dflt;
+						}
+					}
+					
+					auto it = _sparse.find(k);
+					return it == _sparse.end() ? _dflt : it->second;
+				}
+			
+			private:
+				std::unordered_map<key, size_t> _sparse;
+				std::vector<size_t> _dense;
+				std::vector<std::pair<key, size_t>> _sorted;
+				key _first;
+				size_t _dflt;
+				
+				static constexpr const size_t max_holes_per_case = 3;
+				static constexpr const size_t max_sorted_cases = 32;
+				
+				// the keys of a dense table are integral
+				static inline std::uint64_t distance(key k1, key k2) { return std::uint64_t(integer(k2)) - std::uint64_t(integer(k1)); }
+				
+				static key max_key(const std::unordered_map<key, size_t>& cases)
+				{
+					return std::max_element(cases.begin(), cases.end(), [](const auto& c1, const auto& c2) { return c1.first < c2.first; })->first;
+				}
+				
+				bool is_dense(const std::unordered_map<key, size_t>& cases)
+				{
+					if(cases.empty())
+						return false;
+					
+					for(const auto& c : cases)
+					{
+						if constexpr(std::is_same<T, number>::value)
+						{
+							if(c.first != std::trunc(c.first) || std::fabs(c.first) >= 0x1p53)
+								return false;
+						}
+					}
+					
+					_first = std::min_element(cases.begin(), cases.end(), [](const auto& c1, const auto& c2) { return c1.first < c2.first; })->first;
+					return distance(_first, max_key(cases)) < (max_holes_per_case + 1) * cases.size();
+				}
+		};
+		
+		template <typename T>
+		class switch_statement: public statement
+		{
+			public:
+				switch_statement(typename expression<T>::ptr expr, std::vector<statement_ptr> statements, case_table<T> cases, size_t nan) : _expr(std::move(expr)), _statements(std::move(statements)), _cases(std::move(cases)), _nan(nan) {}
+				
+				flow execute(runtime_context& context) override { return _statements[select(context)]->execute(context); }
+			
+			protected:
+				typename expression<T>::ptr _expr;
 				std::vector<statement_ptr> _statements;
+				case_table<T> _cases;
+				size_t _nan;
+				
+				inline size_t select(runtime_context& context) const
+				{
+					if constexpr(std::is_same<T, string>::value)
+						return _cases.find(*_expr->evaluate(context));
+					else if constexpr(std::is_same<T, number>::value)
+					{
+						number n = _expr->evaluate(context);
+						return std::isnan(n) ? _nan : _cases.find(n);
+					}
+					else
+						return _cases.find(_expr->evaluate(context));
+				}
+		};
+		
+		// the statements run from the one of the case on, until a break leaves the switch
+		template <typename T>
+		class fallthrough_switch_statement: public switch_statement<T>
+		{
+			public:
+				using switch_statement<T>::switch_statement;
+				
+				flow execute(runtime_context& context) override
+				{
+					for(size_t i = this->select(context); i < this->_statements.size(); ++i)
+					{
+						if(flow f = this->_statements[i]->execute(context); f.type() != flow_type::f_normal)
+							return f.type() == flow_type::f_break ? f.consume_break() : f;
+					}
+					return flow::normal_flow();
+				}
 		};
 		
-		class if_declare_statement: public if_statement
+		template <typename S>
+		class declaring_statement: public S
 		{
 			public:
-				if_declare_statement(std::vector<expression<lvalue>::ptr> decls, std::vector<expression<number>::ptr> exprs, std::vector<statement_ptr> statements) : if_statement(std::move(exprs), std::move(statements)), _decls(std::move(decls)) {}
+				template <typename... Args>
+				declaring_statement(std::vector<expression<void>::ptr> decls, Args&&... args) : S(std::forward<Args>(args)...), _decls(std::move(decls)) {}
 				
 				flow execute(runtime_context& context) override
 				{
-					context.enter_scope();
+					auto _ = context.enter_scope();
 					
-					for(const expression<lvalue>::ptr& decl : _decls)
-						context.push(decl->evaluate(context));
+					for(const expression<void>::ptr& decl : _decls)
+						decl->evaluate(context);
 					
-					return if_statement::execute(context);
+					return S::execute(context);
 				}
 
 			private:
-				std::vector<expression<lvalue>::ptr> _decls;
+				std::vector<expression<void>::ptr> _decls;
 		};
 		
+		// the statement runs in a scope of its own when it declares variables
+		template <typename S, typename... Args>
+		statement_ptr make_declaring_statement(std::vector<expression<void>::ptr> decls, Args&&... args)
+		{
+			if(!decls.empty())
+				return std::make_unique<declaring_statement<S>>(std::move(decls), std::forward<Args>(args)...);
+			return std::make_unique<S>(std::forward<Args>(args)...);
+		}
+		
 		class while_statement: public statement
 		{
 			public:
@@ -237,25 +444,261 @@ namespace Gisel
 		class for_declare_statement: public for_statement_base
 		{
 			public:
-				for_declare_statement(std::vector<expression<lvalue>::ptr> decls, expression<number>::ptr expr2, expression<void>::ptr expr3, statement_ptr statement) : for_statement_base(std::move(expr2), std::move(expr3), std::move(statement)), _decls(std::move(decls)) {}
+				for_declare_statement(std::vector<expression<void>::ptr> decls, expression<number>::ptr expr2, expression<void>::ptr expr3, statement_ptr statement) : for_statement_base(std::move(expr2), std::move(expr3), std::move(statement)), _decls(std::move(decls)) {}
 				
 				flow execute(runtime_context& context) override
 				{
-					context.enter_scope();
+					auto _ = context.enter_scope();
 					
-					for(const expression<lvalue>::ptr& decl : _decls)
-						context.push(decl->evaluate(context));
+					for(const expression<void>::ptr& decl : _decls)
+						decl->evaluate(context);
 
 					return for_statement_base::execute(context);
 				}
 
 			private:
-				std::vector<expression<lvalue>::ptr> _decls;
+				std::vector<expression<void>::ptr> _decls;
 				expression<number>::ptr _expr2;
 				expression<void>::ptr _expr3;
 				statement_ptr _statement;
 		};
 
+		inline number& counter_value(runtime_context& context, int idx) { return static_cast<variable_impl<number>*>(context.local(idx).get())->value; }
+
+		template<loop_comparison C, typename T>
+		inline bool compare_counter(T value, T bound)
+		{
+			if constexpr(C == loop_comparison::lt) return value < bound;
+			else if constexpr(C == loop_comparison::le) return value <= bound;
+			else if constexpr(C == loop_comparison::gt) return value > bound;
+			else if constexpr(C == loop_comparison::ge) return value >= bound;
+			else return value != bound;
+		}
+
+		// the counter is only written by the step, so the condition and the step are evaluated natively,
+		// in int64 when the counter provably takes exact integral values only
+		template<loop_comparison C>
+		class counted_for_statement: public statement
+		{
+			public:
+				counted_for_statement(int counter, std::optional<int> bound_variable, number bound, number step, statement_ptr statement) : _counter(counter), _bound_variable(bound_variable), _bound(bound), _step(step), _statement(std::move(statement)) {}
+				
+				flow execute(runtime_context& context) override
+				{
+					number& i = counter_value(context, _counter);
+					const number bound = _bound_variable ? counter_value(context, *_bound_variable) : _bound;
+					
+					if(!(i == 0 && std::signbit(i)) && is_bounded_integral_loop(C, i, bound, _step))
+					{
+						std::int64_t k = std::int64_t(i);
+						const std::int64_t limit = std::int64_t(C == loop_comparison::lt || C == loop_comparison::ge ? std::ceil(bound) : std::floor(bound));
+						
+						for(const std::int64_t step = std::int64_t(_step); compare_counter<C>(k, limit); k += step)
+						{
+							i = number(k);
+							switch (flow f = _statement->execute(context); f.type())
+							{
+								case flow_type::f_normal:
+								case flow_type::f_continue: break;
+								case flow_type::f_break: return f.consume_break();
+								case flow_type::f_return: return f;
+							}
+						}
+						i = number(k);
+						return flow::normal_flow();
+					}
+					
+					for(; compare_counter<C>(i, bound); i += _step)
+					{
+						switch (flow f = _statement->execute(context); f.type())
+						{
+							case flow_type::f_normal:
+							case flow_type::f_continue: break;
+							case flow_type::f_break: return f.consume_break();
+							case flow_type::f_return: return f;
+						}
+					}
+					return flow::normal_flow();
+				}
+			
+			private:
+				int _counter;
+				std::optional<int> _bound_variable;
+				number _bound;
+				number _step;
+				statement_ptr _statement;
+		};
+		
+		// one copy of the body for each value of the counter
+		class unrolled_for_statement: public statement
+		{
+			public:
+				unrolled_for_statement(int counter, std::vector<number> values, number end, std::vector<statement_ptr> statements) : _counter(counter), _values(std::move(values)), _end(end), _statements(std::move(statements)) {}
+				
+				flow execute(runtime_context& context) override
+				{
+					number& i = counter_value(context, _counter);
+					
+					for(size_t k = 0; k < _statements.size(); ++k)
+					{
+						i = _values[k];
+						switch (flow f = _statements[k]->execute(context); f.type())
+						{
+							case flow_type::f_normal:
+							case flow_type::f_continue: break;
+							case flow_type::f_break: return f.consume_break();
+							case flow_type::f_return: return f;
+						}
+					}
+					i = _end;
+					return flow::normal_flow();
+				}
+			
+			private:
+				int _counter;
+				std::vector<number> _values;
+				number _end;
+				std::vector<statement_ptr> _statements;
+		};
+		
+		// the iterations of a counted loop, run by the threads of the scheduler in contexts forked from the one
+		// running the loop; the body writes none of the variables declared before it, but the reductions, which
+		// every participant adds to from 0 in its own context and which are added together once the loop is over
+		template<loop_comparison C>
+		class parallel_for_statement: public statement
+		{
+			public:
+				parallel_for_statement(int counter, std::optional<int> bound_variable, number bound, number step, std::vector<std::pair<int, bool> > reductions, statement_ptr statement) : _counter(counter), _bound_variable(bound_variable), _bound(bound), _step(step), _reductions(std::move(reductions)), _statement(std::move(statement)) {}
+				
+				flow execute(runtime_context& context) override
+				{
+					number& i = counter_value(context, _counter);
+					const number bound = _bound_variable ? counter_value(context, *_bound_variable) : _bound;
+					
+					if((i == 0 && std::signbit(i)) || !is_bounded_integral_loop(C, i, bound, _step))
+					{
+						for(; compare_counter<C>(i, bound); i += _step)
+							_statement->execute(context);
+						return flow::normal_flow();
+					}
+					
+					const std::int64_t start = std::int64_t(i);
+					const std::int64_t step = std::int64_t(_step);
+					const size_t trips = trip_count(start, std::int64_t(C == loop_comparison::lt || C == loop_comparison::ge ? std::ceil(bound) : std::floor(bound)), step);
+					
+					// the participants fork the context on their own threads, the lazy globals cannot be initialized then
+					context.initialize_lazy_globals();
+					scheduler& s = scheduler::instance();
+					std::vector<std::optional<runtime_context> > contexts(s.participants());
+					
+					auto body = [&](size_t p, size_t begin, size_t end)
+					{
+						std::optional<runtime_context>& c = contexts[p];
+						if(!c)
+						{
+							c.emplace(context.fork());
+							c->local(_counter) = c->make_variable<number>(0);
+							for(const auto& [idx, integral] : _reductions)
+								c->local(idx) = integral ? variable_ptr(c->make_variable<integer>(0)) : variable_ptr(c->make_variable<number>(0));
+						}
+						
+						number& k = counter_value(*c, _counter);
+						for(size_t j = begin; j < end; ++j)
+						{
+							k = number(start + std::int64_t(j) * step);
+							_statement->execute(*c);
+						}
+					};
+					
+					if(trips < 2 || !s.parallel_for(trips, body))
+					{
+						for(size_t j = 0; j < trips; ++j)
+						{
+							i = number(start + std::int64_t(j) * step);
+							_statement->execute(context);
+						}
+					}
+					
+					for(std::optional<runtime_context>& c : contexts)
+					{
+						if(!c)
+							continue;
+						for(const auto& [idx, integral] : _reductions)
+						{
+							if(integral)
+								static_cast<variable_impl<integer>&>(*context.local(idx)).value += static_cast<const variable_impl<integer>&>(*c->local(idx)).value;
+							else
+								static_cast<variable_impl<number>&>(*context.local(idx)).value += static_cast<const variable_impl<number>&>(*c->local(idx)).value;
+						}
+					}
+					
+					i = number(start + std::int64_t(trips) * step);
+					return flow::normal_flow();
+				}
+			
+			private:
+				int _counter;
+				std::optional<int> _bound_variable;
+				number _bound;
+				number _step;
+				std::vector<std::pair<int, bool> > _reductions; // the local index of every reduction, and whether it is an int
+				statement_ptr _statement;
+				
+				static inline size_t trip_count(std::int64_t start, std::int64_t limit, std::int64_t step) noexcept
+				{
+					switch(C)
+					{
+						case loop_comparison::lt: return start < limit ? size_t((limit - start + step - 1) / step) : 0;
+						case loop_comparison::le: return start <= limit ? size_t((limit - start) / step + 1) : 0;
+						case loop_comparison::gt: return start > limit ? size_t((start - limit - step - 1) / -step) : 0;
+						case loop_comparison::ge: return start >= limit ? size_t((start - limit) / -step + 1) : 0;
+						case loop_comparison::ne: assert((limit - start) % step == 0); return size_t((limit - start) / step); // is_bounded_integral_loop let no other through
+					}
+					return 0;
+				}
+		};
+		
+		class for_init_statement: public statement
+		{
+			public:
+				for_init_statement(std::vector<expression<void>::ptr> decls, expression<void>::ptr expr, statement_ptr statement) : _decls(std::move(decls)), _expr(std::move(expr)), _statement(std::move(statement)) {}
+				
+				flow execute(runtime_context& context) override
+				{
+					auto _ = context.enter_scope();
+					
+					for(const expression<void>::ptr& decl : _decls)
+						decl->evaluate(context);
+					if(_expr)
+						_expr->evaluate(context);
+
+					return _statement->execute(context);
+				}
+
+			private:
+				std::vector<expression<void>::ptr> _decls;
+				expression<void>::ptr _expr;
+				statement_ptr _statement;
+		};
+
+		// the body of a loop of a function being profiled; the contexts of several threads may count at the
+		// same time, an iteration lost to a race only delays the rebuild a little
+		class counting_statement: public statement
+		{
+			public:
+				counting_statement(statement_ptr statement, std::atomic<size_t>& counter) : _statement(std::move(statement)), _counter(counter) {}
+
+				inline flow execute(runtime_context& context) override
+				{
+					_counter.store(_counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+					return _statement->execute(context);
+				}
+
+			private:
+				statement_ptr _statement;
+				std::atomic<size_t>& _counter;
+		};
+
 		class import_statement : public statement
 		{
 			public:
@@ -268,24 +711,80 @@ namespace Gisel
 	}
 
 	statement_ptr create_simple_statement(expression<void>::ptr expr) { return std::make_unique<simple_statement>(std::move(expr)); }
-	statement_ptr create_local_declaration_statement(std::vector<expression<lvalue>::ptr> decls) { return std::make_unique<local_declaration_statement>(std::move(decls)); }
+	statement_ptr create_local_declaration_statement(std::vector<expression<void>::ptr> decls) { return std::make_unique<local_declaration_statement>(std::move(decls)); }
 	statement_ptr create_block_statement(std::vector<statement_ptr> statements) { return std::make_unique<block_statement>(std::move(statements)); }
-	shared_statement_ptr create_shared_block_statement(std::vector<statement_ptr> statements) { return std::make_shared<block_statement>(std::move(statements)); }
+	shared_statement_ptr create_shared_block_statement(std::vector<statement_ptr> statements) { return shared_statement_ptr(create_block_statement(std::move(statements))); }
 	statement_ptr create_break_statement(int break_level) { return std::make_unique<break_statement>(break_level); }
 	statement_ptr create_continue_statement() { return std::make_unique<continue_statement>(); }
 	statement_ptr create_return_statement(expression<lvalue>::ptr expr) { return std::make_unique<return_statement>(std::move(expr)); }
 	statement_ptr create_return_void_statement() { return std::make_unique<return_void_statement>(); }
 
-	statement_ptr create_if_statement(std::vector<expression<lvalue>::ptr> decls, std::vector<expression<number>::ptr> exprs, std::vector<statement_ptr> statements)
-	{
-		if(!decls.empty())
-			return std::make_unique<if_declare_statement>(std::move(decls), std::move(exprs), std::move(statements));
-		return std::make_unique<if_statement>(std::move(exprs), std::move(statements));
-	}
+	statement_ptr create_if_statement(std::vector<expression<void>::ptr> decls, std::vector<expression<number>::ptr> exprs, std::vector<statement_ptr> statements) { return make_declaring_statement<if_statement>(std::move(decls), std::move(exprs), std::move(statements)); }
+	statement_ptr create_profiled_if_statement(std::vector<expression<void>::ptr> decls, std::vector<expression<number>::ptr> exprs, std::vector<statement_ptr> statements, std::vector<size_t>& hits) { return make_declaring_statement<profiled_if_statement>(std::move(decls), std::move(exprs), std::move(statements), hits); }
+	statement_ptr create_reordered_if_statement(std::vector<expression<void>::ptr> decls, std::vector<expression<number>::ptr> exprs, std::vector<statement_ptr> statements, std::vector<size_t> order, expression<number>::ptr discriminant) { return make_declaring_statement<reordered_if_statement>(std::move(decls), std::move(exprs), std::move(statements), std::move(order), std::move(discriminant)); }
 
+	statement_ptr create_switch_statement(std::vector<expression<void>::ptr> decls, expression<number>::ptr expr, std::vector<statement_ptr> statements, std::unordered_map<number, size_t> cases, size_t dflt, size_t nan) { return make_declaring_statement<switch_statement<number>>(std::move(decls), std::move(expr), std::move(statements), case_table<number>(std::move(cases), dflt), nan); }
+	statement_ptr create_switch_statement(std::vector<expression<void>::ptr> decls, expression<integer>::ptr expr, std::vector<statement_ptr> statements, std::unordered_map<integer, size_t> cases, size_t dflt) { return make_declaring_statement<switch_statement<integer>>(std::move(decls), std::move(expr), std::move(statements), case_table<integer>(std::move(cases), dflt), dflt); }
+	statement_ptr create_switch_statement(std::vector<expression<void>::ptr> decls, expression<string>::ptr expr, std::vector<statement_ptr> statements, std::unordered_map<std::string, size_t> cases, size_t dflt) { return make_declaring_statement<switch_statement<string>>(std::move(decls), std::move(expr), std::move(statements), case_table<string>(std::move(cases), dflt), dflt); }
+	statement_ptr create_fallthrough_switch_statement(expression<number>::ptr expr, std::vector<statement_ptr> statements, std::unordered_map<number, size_t> cases, size_t dflt) { return std::make_unique<fallthrough_switch_statement<number>>(std::move(expr), std::move(statements), case_table<number>(std::move(cases), dflt), dflt); }
+	statement_ptr create_fallthrough_switch_statement(expression<integer>::ptr expr, std::vector<statement_ptr> statements, std::unordered_map<integer, size_t> cases, size_t dflt) { return std::make_unique<fallthrough_switch_statement<integer>>(std::move(expr), std::move(statements), case_table<integer>(std::move(cases), dflt), dflt); }
+	statement_ptr create_fallthrough_switch_statement(expression<string>::ptr expr, std::vector<statement_ptr> statements, std::unordered_map<std::string, size_t> cases, size_t dflt) { return std::make_unique<fallthrough_switch_statement<string>>(std::move(expr), std::move(statements), case_table<string>(std::move(cases), dflt), dflt); }
 	statement_ptr create_while_statement(expression<number>::ptr expr, statement_ptr statement) { return std::make_unique<while_statement>(std::move(expr), std::move(statement)); }
 	statement_ptr create_do_statement(expression<number>::ptr expr, statement_ptr statement) { return std::make_unique<do_statement>(std::move(expr), std::move(statement)); }
 	statement_ptr create_for_statement(expression<void>::ptr expr1, expression<number>::ptr expr2, expression<void>::ptr expr3, statement_ptr statement) { return std::make_unique<for_statement>(std::move(expr1), std::move(expr2), std::move(expr3), std::move(statement)); }
-	statement_ptr create_for_statement(std::vector<expression<lvalue>::ptr> decls, expression<number>::ptr expr2, expression<void>::ptr expr3, statement_ptr statement) { return std::make_unique<for_declare_statement>(std::move(decls), std::move(expr2), std::move(expr3), std::move(statement)); }
+	statement_ptr create_for_statement(std::vector<expression<void>::ptr> decls, expression<number>::ptr expr2, expression<void>::ptr expr3, statement_ptr statement) { return std::make_unique<for_declare_statement>(std::move(decls), std::move(expr2), std::move(expr3), std::move(statement)); }
+
+	statement_ptr create_counted_for_statement(std::vector<expression<void>::ptr> decls, expression<void>::ptr expr1, const counted_loop& loop, statement_ptr statement)
+	{
+		const int counter = int(loop.counter->index());
+		const std::optional<int> bound_variable = loop.bound_variable ? std::optional<int>(int(loop.bound_variable->index())) : std::nullopt;
+		statement_ptr ret;
+		
+		switch(loop.comparison)
+		{
+			case loop_comparison::lt: ret = std::make_unique<counted_for_statement<loop_comparison::lt>>(counter, bound_variable, loop.bound, loop.step, std::move(statement)); break;
+			case loop_comparison::le: ret = std::make_unique<counted_for_statement<loop_comparison::le>>(counter, bound_variable, loop.bound, loop.step, std::move(statement)); break;
+			case loop_comparison::gt: ret = std::make_unique<counted_for_statement<loop_comparison::gt>>(counter, bound_variable, loop.bound, loop.step, std::move(statement)); break;
+			case loop_comparison::ge: ret = std::make_unique<counted_for_statement<loop_comparison::ge>>(counter, bound_variable, loop.bound, loop.step, std::move(statement)); break;
+			case loop_comparison::ne: ret = std::make_unique<counted_for_statement<loop_comparison::ne>>(counter, bound_variable, loop.bound, loop.step, std::move(statement)); break;
+		}
+		
+		return std::make_unique<for_init_statement>(std::move(decls), std::move(expr1), std::move(ret));
+	}
+
+	statement_ptr create_unrolled_for_statement(std::vector<expression<void>::ptr> decls, expression<void>::ptr expr1, const counted_loop& loop, std::vector<statement_ptr> statements)
+	{
+		std::vector<number> values;
+		number value = *loop.start;
+		
+		for(size_t k = 0; k < statements.size(); ++k, value += loop.step)
+			values.push_back(value);
+		
+		statement_ptr ret = std::make_unique<unrolled_for_statement>(int(loop.counter->index()), std::move(values), value, std::move(statements));
+		return std::make_unique<for_init_statement>(std::move(decls), std::move(expr1), std::move(ret));
+	}
+
+	statement_ptr create_parallel_for_statement(std::vector<expression<void>::ptr> decls, const counted_loop& loop, const std::vector<const identifier_info*>& reductions, statement_ptr statement)
+	{
+		const int counter = int(loop.counter->index());
+		const std::optional<int> bound_variable = loop.bound_variable ? std::optional<int>(int(loop.bound_variable->index())) : std::nullopt;
+		std::vector<std::pair<int, bool> > indices;
+		for(const identifier_info* info : reductions)
+			indices.emplace_back(int(info->index()), info->type_id() == type_registry::get_integer_handle());
+		statement_ptr ret;
+		
+		switch(loop.comparison)
+		{
+			case loop_comparison::lt: ret = std::make_unique<parallel_for_statement<loop_comparison::lt>>(counter, bound_variable, loop.bound, loop.step, std::move(indices), std::move(statement)); break;
+			case loop_comparison::le: ret = std::make_unique<parallel_for_statement<loop_comparison::le>>(counter, bound_variable, loop.bound, loop.step, std::move(indices), std::move(statement)); break;
+			case loop_comparison::gt: ret = std::make_unique<parallel_for_statement<loop_comparison::gt>>(counter, bound_variable, loop.bound, loop.step, std::move(indices), std::move(statement)); break;
+			case loop_comparison::ge: ret = std::make_unique<parallel_for_statement<loop_comparison::ge>>(counter, bound_variable, loop.bound, loop.step, std::move(indices), std::move(statement)); break;
+			case loop_comparison::ne: ret = std::make_unique<parallel_for_statement<loop_comparison::ne>>(counter, bound_variable, loop.bound, loop.step, std::move(indices), std::move(statement)); break;
+		}
+		
+		return std::make_unique<for_init_statement>(std::move(decls), nullptr, std::move(ret));
+	}
+
+	statement_ptr create_counting_statement(statement_ptr statement, std::atomic<size_t>& counter) { return std::make_unique<counting_statement>(std::move(statement), counter); }
 	statement_ptr create_import_statement(expression<string>::ptr expr) { return std::make_unique<import_statement>(std::move(expr)); }
 }
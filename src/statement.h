@@ -20,13 +20,18 @@
 #ifndef __STATEMENT__
 #define __STATEMENT__
 
+#include <atomic>
 #include <memory>
 #include <vector>
+#include <string>
 #include <unordered_map>
 #include "expression.h"
 
 namespace Gisel
 {
+	struct counted_loop;
+	class identifier_info;
+
 	enum struct flow_type
 	{
 		f_normal,
@@ -52,7 +57,7 @@ namespace Gisel
 			flow(flow_type type, int break_level);
 	};
 
-	class statement
+	class statement : public arena_object
 	{
 		public:
 			virtual flow execute(class runtime_context& context) = 0;
@@ -70,19 +75,34 @@ namespace Gisel
 	using shared_statement_ptr = std::shared_ptr<statement>;
 
 	statement_ptr create_simple_statement(expression<void>::ptr expr);
-	statement_ptr create_local_declaration_statement(std::vector<expression<lvalue>::ptr> decls);
+	statement_ptr create_local_declaration_statement(std::vector<expression<void>::ptr> decls);
 	statement_ptr create_block_statement(std::vector<statement_ptr> statements);
 	shared_statement_ptr create_shared_block_statement(std::vector<statement_ptr> statements);
 	statement_ptr create_break_statement(int break_level);
 	statement_ptr create_continue_statement();
 	statement_ptr create_return_statement(expression<lvalue>::ptr expr);
 	statement_ptr create_return_void_statement();
-	statement_ptr create_if_statement(std::vector<expression<lvalue>::ptr> decls, std::vector<expression<number>::ptr> exprs, std::vector<statement_ptr> statements);
-	statement_ptr create_switch_statement(std::vector<expression<lvalue>::ptr> decls, expression<number>::ptr expr, std::vector<statement_ptr> statements, std::unordered_map<number, size_t> cases, size_t dflt);
+	statement_ptr create_if_statement(std::vector<expression<void>::ptr> decls, std::vector<expression<number>::ptr> exprs, std::vector<statement_ptr> statements);
+	statement_ptr create_profiled_if_statement(std::vector<expression<void>::ptr> decls, std::vector<expression<number>::ptr> exprs, std::vector<statement_ptr> statements, std::vector<size_t>& hits);
+	// conditions are tested in the given order; the discriminant, when given, is NaN exactly when all of them hold
+	statement_ptr create_reordered_if_statement(std::vector<expression<void>::ptr> decls, std::vector<expression<number>::ptr> exprs, std::vector<statement_ptr> statements, std::vector<size_t> order, expression<number>::ptr discriminant);
+	// runs statements[cases[value of expr]], or statements[dflt] when there is no such case; a NaN number runs statements[nan]
+	statement_ptr create_switch_statement(std::vector<expression<void>::ptr> decls, expression<number>::ptr expr, std::vector<statement_ptr> statements, std::unordered_map<number, size_t> cases, size_t dflt, size_t nan);
+	statement_ptr create_switch_statement(std::vector<expression<void>::ptr> decls, expression<integer>::ptr expr, std::vector<statement_ptr> statements, std::unordered_map<integer, size_t> cases, size_t dflt);
+	statement_ptr create_switch_statement(std::vector<expression<void>::ptr> decls, expression<string>::ptr expr, std::vector<statement_ptr> statements, std::unordered_map<std::string, size_t> cases, size_t dflt);
+	// runs statements[cases[value of expr]] and the ones after it up to a break, or from statements[dflt] when there is no such case, NaN included
+	statement_ptr create_fallthrough_switch_statement(expression<number>::ptr expr, std::vector<statement_ptr> statements, std::unordered_map<number, size_t> cases, size_t dflt);
+	statement_ptr create_fallthrough_switch_statement(expression<integer>::ptr expr, std::vector<statement_ptr> statements, std::unordered_map<integer, size_t> cases, size_t dflt);
+	statement_ptr create_fallthrough_switch_statement(expression<string>::ptr expr, std::vector<statement_ptr> statements, std::unordered_map<std::string, size_t> cases, size_t dflt);
 	statement_ptr create_while_statement(expression<number>::ptr expr, statement_ptr statement);
 	statement_ptr create_do_statement(expression<number>::ptr expr, statement_ptr statement);
 	statement_ptr create_for_statement(expression<void>::ptr expr1, expression<number>::ptr expr2, expression<void>::ptr expr3, statement_ptr statement);
-	statement_ptr create_for_statement(std::vector<expression<lvalue>::ptr> decls, expression<number>::ptr expr2, expression<void>::ptr expr3, statement_ptr statement);
+	statement_ptr create_for_statement(std::vector<expression<void>::ptr> decls, expression<number>::ptr expr2, expression<void>::ptr expr3, statement_ptr statement);
+	statement_ptr create_counted_for_statement(std::vector<expression<void>::ptr> decls, expression<void>::ptr expr1, const counted_loop& loop, statement_ptr statement);
+	statement_ptr create_unrolled_for_statement(std::vector<expression<void>::ptr> decls, expression<void>::ptr expr1, const counted_loop& loop, std::vector<statement_ptr> statements);
+	// runs the iterations of a counted loop declaring its counter on several threads, the reductions being local num or int variables
+	statement_ptr create_parallel_for_statement(std::vector<expression<void>::ptr> decls, const counted_loop& loop, const std::vector<const identifier_info*>& reductions, statement_ptr statement);
+	statement_ptr create_counting_statement(statement_ptr statement, std::atomic<size_t>& counter);
 	statement_ptr create_import_statement(expression<string>::ptr expr);
 }
 
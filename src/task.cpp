@@ -0,0 +1,78 @@
+/**
+ * This file is a part of the Gisel Interpreter
+ *
+ * Copyright (C) 2022 @kbz_8
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <atomic>
+#include "task.h"
+#include "scheduler.h"
+#include "errors.h"
+
+namespace Gisel
+{
+	namespace
+	{
+		struct task_state
+		{
+			task_state(runtime_context context, function f, std::vector<variable_ptr> args) : context(std::make_unique<runtime_context>(std::move(context))), code(this->context->get_program()), f(std::move(f)), args(std::move(args)), done(false) {}
+
+			std::unique_ptr<runtime_context> context; // released once the call is done
+			std::shared_ptr<const program> code;
+			function f;
+			std::vector<variable_ptr> args;
+			variable_ptr result;
+			std::atomic<bool> done;
+		};
+
+		void run(task_state& state)
+		{
+			{
+				variable_ptr result = state.context->call(state.f, std::move(state.args));
+				// the context and its pool are gone when the task is joined
+				state.result = detach(result);
+			}
+			state.context.reset();
+			
+			// not the last reference to the program, whose module waits for its tasks before releasing it
+			const program& p = *state.code;
+			state.code.reset();
+			state.done.store(true, std::memory_order_release);
+			p.task_finished();
+		}
+	}
+
+	function spawn_task(runtime_context& context, const function& f, std::vector<variable_ptr> args)
+	{
+		runtime_assertion(bool(f), "uninitialized function call");
+		
+		// the arguments of the caller may come from its pool, or be shared with its variables
+		for(variable_ptr& arg : args)
+			arg = detach(arg);
+		
+		// the task copies the globals, the lazy ones it would initialize again in its copy
+		context.initialize_lazy_globals();
+		auto state = std::make_shared<task_state>(context.detached(), f, std::move(args));
+		state->code->task_started();
+		scheduler::instance().spawn([state]() { run(*state); });
+		
+		return [state](runtime_context& context)
+		{
+			scheduler::instance().help_until([&]() { return state->done.load(std::memory_order_acquire); });
+			context.retval() = state->result ? state->result->clone() : nullptr;
+		};
+	}
+}
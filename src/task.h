@@ -0,0 +1,34 @@
+/**
+ * This file is a part of the Gisel Interpreter
+ *
+ * Copyright (C) 2022 @kbz_8
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef __TASK__
+#define __TASK__
+
+#include <vector>
+#include "variable.h"
+#include "runtime_context.h"
+
+namespace Gisel
+{
+	// queues a call of f with the given arguments, run by the scheduler in a context of its own, which starts
+	// from copies of the globals of the context spawning it, lazy ones initialized first; the task returned is a function without parameters,
+	// which returns the result of the call once it is done, and runs queued tasks until then
+	function spawn_task(runtime_context& context, const function& f, std::vector<variable_ptr> args);
+}
+
+#endif // __TASK__
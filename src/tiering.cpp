@@ -0,0 +1,114 @@
+/**
+ * This file is a part of the Gisel Interpreter
+ *
+ * Copyright (C) 2022 @kbz_8
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "tiering.h"
+#include "compiler_context.h"
+#include "runtime_context.h"
+
+namespace Gisel
+{
+	namespace
+	{
+		class tiered_function
+		{
+			public:
+				tiered_function(std::shared_ptr<tier_compiler> compiler, incomplete_function f) : _compiler(std::move(compiler)), _source(std::move(f)), _hot_calls(_compiler->context().get_options().hot_calls), _hot_back_edges(_compiler->context().get_options().hot_back_edges), _calls(0), _back_edges(0), _published(nullptr) {}
+
+				inline incomplete_function& source() noexcept { return _source; }
+				inline std::atomic<size_t>& back_edges() noexcept { return _back_edges; }
+
+				// the rebuild runs on the thread that crosses the threshold, the contexts of the other threads keep
+				// running the first tier meanwhile; counts lost to a race between them only delay it
+				inline const function* optimized()
+				{
+					if(const function* f = _published.load(std::memory_order_acquire))
+						return f;
+
+					size_t calls = _calls.load(std::memory_order_relaxed) + 1;
+					_calls.store(calls, std::memory_order_relaxed);
+					if(calls >= _hot_calls || _back_edges.load(std::memory_order_relaxed) >= _hot_back_edges)
+						rebuild();
+
+					return nullptr;
+				}
+
+			private:
+				std::shared_ptr<tier_compiler> _compiler;
+				incomplete_function _source;
+				size_t _hot_calls;
+				size_t _hot_back_edges;
+				std::atomic<size_t> _calls;
+				std::atomic<size_t> _back_edges;
+				function _optimized;
+				std::atomic<const function*> _published; // _optimized, once built
+
+				void rebuild()
+				{
+					std::lock_guard<std::mutex> lock(_compiler->mutex());
+					if(_published.load(std::memory_order_relaxed))
+						return;
+					_optimized = _compiler->compile_optimized(_source);
+					_published.store(&_optimized, std::memory_order_release);
+				}
+		};
+	}
+
+	tier_compiler::tier_compiler(const compiler_options& optimized_options) : _ctx(std::make_unique<compiler_context>(optimized_options)), _optimized_options(optimized_options)
+	{
+		if(!optimized_options.tiering)
+			return;
+
+		// the first tier keeps the cheap passes, its loops count their iterations instead of being specialized
+		compiler_options first_tier = optimized_options;
+		_first_tier_passes = _ctx->passes();
+		_first_tier_passes.set_enabled("loops", false);
+		first_tier.jit = false;
+		first_tier.passes = &_first_tier_passes;
+		_ctx->set_options(first_tier);
+	}
+
+	function tier_compiler::compile_optimized(incomplete_function& f)
+	{
+		compiler_options options = _ctx->get_options();
+		_ctx->set_options(_optimized_options);
+		function ret = f.compile(*_ctx);
+		_ctx->set_options(options);
+		return ret;
+	}
+
+	function compile_tiered(const std::shared_ptr<tier_compiler>& compiler, incomplete_function f, storage_stats* storage)
+	{
+		auto tiered = std::make_shared<tiered_function>(compiler, std::move(f));
+		compiler_context& ctx = compiler->context();
+
+		ctx.set_back_edge_counter(&tiered->back_edges());
+		function tree = tiered->source().compile(ctx);
+		ctx.set_back_edge_counter(nullptr);
+
+		if(storage)
+			*storage = tiered->source().get_storage_stats();
+
+		return [tiered, tree = std::move(tree)] (runtime_context& context)
+		{
+			if(const function* f = tiered->optimized())
+				(*f)(context);
+			else
+				tree(context);
+		};
+	}
+}
@@ -0,0 +1,55 @@
+/**
+ * This file is a part of the Gisel Interpreter
+ *
+ * Copyright (C) 2022 @kbz_8
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef __TIERING__
+#define __TIERING__
+
+#include <memory>
+#include <mutex>
+#include "incomplete_function.h"
+#include "compiler_context.h"
+#include "passes.h"
+
+namespace Gisel
+{
+	// keeps the compiler context of a loaded program alive, so that its functions
+	// can be rebuilt with every optimization once they turn out to be hot
+	class tier_compiler
+	{
+		public:
+			// with tiering enabled by the options, the context first builds plain trees
+			tier_compiler(const compiler_options& optimized_options);
+			inline compiler_context& context() noexcept { return *_ctx; }
+			// held by the rebuilds, the functions of a program share the compiler context
+			inline std::mutex& mutex() noexcept { return _mutex; }
+			function compile_optimized(incomplete_function& f);
+
+		private:
+			std::mutex _mutex;
+			pass_manager _first_tier_passes;
+			std::unique_ptr<compiler_context> _ctx;
+			compiler_options _optimized_options;
+	};
+
+	// builds the first tier of f, which counts its calls and the iterations of its loops; the counts are
+	// checked when f is called, so once either has crossed its threshold the next call rebuilds f with every
+	// optimization and runs the new version. tier-up is per call: a call stays in the tier it started in
+	function compile_tiered(const std::shared_ptr<tier_compiler>& compiler, incomplete_function f, storage_stats* storage = nullptr);
+}
+
+#endif // __TIERING__
@@ -34,4 +34,16 @@ namespace Gisel
 			return ret;
 		})
 	{ ++(*this); }
+
+	void tk_iterator::start_recording(std::deque<Token>& tape)
+	{
+		tape.push_back(_current);
+		_tapes.push_back(&tape);
+	}
+
+	void tk_iterator::stop_recording()
+	{
+		_tapes.back()->pop_back();
+		_tapes.pop_back();
+	}
 }
@@ -23,6 +23,7 @@
 #include "tokens.h"
 #include "streamstack.h"
 #include <deque>
+#include <vector>
 
 namespace Gisel
 {
@@ -34,7 +35,13 @@ namespace Gisel
 
 			inline const Token& operator*() const noexcept { return _current; }
 			inline const Token* operator->() const noexcept { return &_current; }
-			inline tk_iterator& operator++() noexcept { _current = _get_next_token(); return *this; }
+			inline tk_iterator& operator++() noexcept
+			{
+				_current = _get_next_token();
+				for(std::deque<Token>* tape : _tapes)
+					tape->push_back(_current);
+				return *this;
+			}
 			inline tk_iterator operator++(int) noexcept
 			{
 				tk_iterator old = *this;
@@ -43,9 +50,14 @@ namespace Gisel
 			}
 			inline bool operator()() const noexcept { return !_current.is_eof(); }
 
+			// copies every token read from the current one until the matching stop_recording, excluded
+			void start_recording(std::deque<Token>& tape);
+			void stop_recording();
+
 		private:
 			Token _current;
 			func::function<Token()> _get_next_token;
+			std::vector<std::deque<Token>*> _tapes;
 	};
 }
 
@@ -34,17 +34,22 @@ namespace Gisel
 		kw_fn,
 		kw_import,
 		kw_var,
+		kw_const,
 		kw_for,
+		kw_parallel,
 		kw_while,
 		kw_do,
 		kw_break,
 		kw_continue,
 		kw_return,
+		kw_spawn,
+		kw_join,
 		kw_public,
 
 		type_void,
 		type_number,
 		type_string,
+		type_int,
 
 		semicolon,
 		type_specifier,
@@ -60,6 +65,9 @@ namespace Gisel
 		statement_if,
 		statement_else,
 		statement_elif,
+		statement_switch,
+		statement_case,
+		statement_default,
 
 		inc,
 		dec,
@@ -78,6 +86,11 @@ namespace Gisel
 		assign,
 
 		bitwise_and,
+		bitwise_or,
+		bitwise_xor,
+		bitwise_not,
+		shift_left,
+		shift_right,
 
 		eq,
 		ne,
@@ -124,20 +137,28 @@ namespace Gisel
 				{Tokens::kw_import, "import"},
 				{Tokens::kw_public, "export"},
 				{Tokens::kw_var, "var"},
+				{Tokens::kw_const, "const"},
 				{Tokens::kw_for, "for"},
+				{Tokens::kw_parallel, "parallel"},
 				{Tokens::kw_while, "while"},
 				{Tokens::kw_do, "do"},
 				{Tokens::kw_break, "break"},
 				{Tokens::kw_continue, "continue"},
 				{Tokens::kw_return, "return"},
+				{Tokens::kw_spawn, "spawn"},
+				{Tokens::kw_join, "join"},
 
 				{Tokens::type_void, "void"},
 				{Tokens::type_number, "num"},
 				{Tokens::type_string, "str"},
+				{Tokens::type_int, "int"},
 
 				{Tokens::statement_if, "if"},
 				{Tokens::statement_else, "else"},
-				{Tokens::statement_elif, "elif"}
+				{Tokens::statement_elif, "elif"},
+				{Tokens::statement_switch, "switch"},
+				{Tokens::statement_case, "case"},
+				{Tokens::statement_default, "default"}
 			};
 
 			static inline duets_array<Tokens, std::string> operators_token
@@ -147,6 +168,11 @@ namespace Gisel
 				{Tokens::dot, "."},
 				{Tokens::type_specifier, ":"},
 				{Tokens::bitwise_and, "&"},
+				{Tokens::bitwise_or, "|"},
+				{Tokens::bitwise_xor, "^"},
+				{Tokens::bitwise_not, "~"},
+				{Tokens::shift_left, "<<"},
+				{Tokens::shift_right, ">>"},
 				{Tokens::bracket_b, "("},
 				{Tokens::bracket_e, ")"},
 				{Tokens::embrace_b, "{"},
@@ -67,6 +67,7 @@ namespace Gisel
 					case simple_type::nothing: return type_registry::get_void_handle();
 					case simple_type::number:  return type_registry::get_number_handle();
 					case simple_type::string:  return type_registry::get_string_handle();
+					case simple_type::integer: return type_registry::get_integer_handle();
 				}
 			},
 			[this](const auto& t) { return &(*(_types.insert(t).first)); }
@@ -76,6 +77,7 @@ namespace Gisel
 	type type_registry::void_type = simple_type::nothing;
 	type type_registry::number_type = simple_type::number;
 	type type_registry::string_type = simple_type::string;
+	type type_registry::integer_type = simple_type::integer;
 }
 
 namespace std
@@ -90,6 +92,7 @@ namespace std
 					case Gisel::simple_type::nothing: return std::string("void");
 					case Gisel::simple_type::number:  return std::string("number");
 					case Gisel::simple_type::string: return std::string("string");
+					case Gisel::simple_type::integer: return std::string("int");
 				}
 			},
 			[](const Gisel::function_type& ft)
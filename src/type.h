@@ -31,7 +31,8 @@ namespace Gisel
 	{
 		nothing,
 		number,
-		string
+		string,
+		integer
 	};
 
 	struct function_type;
@@ -60,6 +61,7 @@ namespace Gisel
 			inline static type_handle get_void_handle() { return &void_type; }
 			inline static type_handle get_number_handle() { return &number_type; }
 			inline static type_handle get_string_handle() { return &string_type; }
+			inline static type_handle get_integer_handle() { return &integer_type; }
 
 		private:
 			struct types_less { bool operator()(const type& t1, const type& t2) const; };
@@ -68,6 +70,7 @@ namespace Gisel
 			static type void_type;
 			static type number_type;
 			static type string_type;
+			static type integer_type;
 	};
 }
 
@@ -0,0 +1,40 @@
+/**
+ * This file is a part of the Gisel Interpreter
+ *
+ * Copyright (C) 2022 @kbz_8
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "value_pool.h"
+
+namespace Gisel
+{
+	void* value_pool::carve(std::size_t size_class)
+	{
+		const std::size_t size = (size_class + 1) * granularity;
+
+		if(std::size_t(_end - _cursor) < size)
+		{
+			// new char[] is aligned for any type, and so are the blocks of a chunk
+			_chunks.emplace_back(new char[chunk_size]);
+			_cursor = _chunks.back().get();
+			_end = _cursor + chunk_size;
+		}
+
+		void* ret = _cursor;
+		_cursor += size;
+		return ret;
+	}
+}
@@ -0,0 +1,107 @@
+/**
+ * This file is a part of the Gisel Interpreter
+ *
+ * Copyright (C) 2022 @kbz_8
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __VALUE_POOL__
+#define __VALUE_POOL__
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace Gisel
+{
+	// the small blocks of the values of a runtime context, carved out of chunks it keeps; a freed block goes
+	// back to the free list of its size, so a context reuses the memory of its previous calls without the heap
+	class value_pool
+	{
+		public:
+			value_pool() = default;
+
+			inline void* allocate(std::size_t size)
+			{
+				if(size > max_block_size)
+					return ::operator new(size);
+
+				block*& free = _free[size_class(size)];
+				if(block* b = free)
+				{
+					free = b->next;
+					return b;
+				}
+				return carve(size_class(size));
+			}
+
+			inline void deallocate(void* p, std::size_t size) noexcept
+			{
+				if(size > max_block_size)
+				{
+					::operator delete(p);
+					return;
+				}
+
+				block* b = static_cast<block*>(p);
+				block*& free = _free[size_class(size)];
+				b->next = free;
+				free = b;
+			}
+
+		private:
+			struct block { block* next; };
+
+			static constexpr const std::size_t granularity = alignof(std::max_align_t);
+			static constexpr const std::size_t max_block_size = 8 * granularity;
+			static constexpr const std::size_t chunk_size = 16384;
+
+			block* _free[max_block_size / granularity] = {};
+			std::vector<std::unique_ptr<char[]> > _chunks;
+			char* _cursor = nullptr;
+			char* _end = nullptr;
+
+			static inline std::size_t size_class(std::size_t size) noexcept { return (size - 1) / granularity; }
+			void* carve(std::size_t size_class);
+
+			value_pool(const value_pool&) = delete;
+			void operator=(const value_pool&) = delete;
+	};
+
+	template <typename T>
+	class pool_allocator
+	{
+		public:
+			using value_type = T;
+
+			pool_allocator(value_pool* pool) noexcept : _pool(pool) {}
+			template <typename U>
+			pool_allocator(const pool_allocator<U>& other) noexcept : _pool(other.pool()) {}
+
+			inline T* allocate(std::size_t n) { return static_cast<T*>(_pool->allocate(n * sizeof(T))); }
+			inline void deallocate(T* p, std::size_t n) noexcept { _pool->deallocate(p, n * sizeof(T)); }
+			inline value_pool* pool() const noexcept { return _pool; }
+
+		private:
+			value_pool* _pool;
+	};
+
+	template <typename T, typename U>
+	inline bool operator==(const pool_allocator<T>& a1, const pool_allocator<U>& a2) noexcept { return a1.pool() == a2.pool(); }
+	template <typename T, typename U>
+	inline bool operator!=(const pool_allocator<T>& a1, const pool_allocator<U>& a2) noexcept { return a1.pool() != a2.pool(); }
+}
+
+#endif // __VALUE_POOL__
@@ -25,6 +25,7 @@ namespace Gisel
 	variable_impl<T>::variable_impl(T value) : value(std::move(value)) {}
 
 	template class variable_impl<number>;
+	template class variable_impl<integer>;
 	template class variable_impl<string>;
 	template class variable_impl<function>;
 }
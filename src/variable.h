@@ -24,6 +24,7 @@
 #include <deque>
 #include "function.h"
 #include <string>
+#include <cstdint>
 
 namespace Gisel
 {
@@ -37,15 +38,18 @@ namespace Gisel
 	class runtime_context;
 
 	using number = double;
+	using integer = std::int64_t;
 	using string = std::shared_ptr<std::string>;
 	using function = func::function<void(runtime_context&)>;
 
 	using lvalue = variable_ptr;
 	using lnumber = std::shared_ptr<variable_impl<number>>;
+	using linteger = std::shared_ptr<variable_impl<integer>>;
 	using lstring = std::shared_ptr<variable_impl<string>>;
 	using lfunction = std::shared_ptr<variable_impl<function>>;
 
 	inline number clone_variable_value(number value) { return value; }
+	inline integer clone_variable_value(integer value) { return value; }
 	inline string clone_variable_value(const string& value) { return value; }
 	inline function clone_variable_value(const function& value) { return value; }
 
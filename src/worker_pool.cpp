@@ -0,0 +1,86 @@
+/**
+ * This file is a part of the Gisel Interpreter
+ *
+ * Copyright (C) 2022 @kbz_8
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "worker_pool.h"
+#include <algorithm>
+
+namespace Gisel
+{
+	worker_pool::worker_pool(const runtime_context& prototype, size_t threads, size_t queue_capacity) : _capacity(queue_capacity), _stopping(false)
+	{
+		for(size_t i = 0; i < threads; ++i)
+			_contexts.push_back(std::make_unique<runtime_context>(prototype.clone()));
+		for(const std::unique_ptr<runtime_context>& context : _contexts)
+			_threads.emplace_back([this, &context = *context]() { run(context); });
+	}
+
+	worker_pool::~worker_pool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_stopping = true;
+		}
+		_not_empty.notify_all();
+		for(std::thread& t : _threads)
+			t.join();
+	}
+
+	void worker_pool::submit(std::vector<task> tasks)
+	{
+		auto next = tasks.begin();
+
+		while(next != tasks.end())
+		{
+			{
+				std::unique_lock<std::mutex> lock(_mutex);
+				_not_full.wait(lock, [this]() { return _queue.size() < _capacity; });
+				for(; next != tasks.end() && _queue.size() < _capacity; ++next)
+					_queue.push_back(std::move(*next));
+			}
+			_not_empty.notify_all();
+		}
+	}
+
+	void worker_pool::run(runtime_context& context)
+	{
+		std::vector<task> batch;
+		batch.reserve(max_batch);
+
+		for(;;)
+		{
+			{
+				std::unique_lock<std::mutex> lock(_mutex);
+				_not_empty.wait(lock, [this]() { return _stopping || !_queue.empty(); });
+				if(_queue.empty())
+					return;
+				// a share of the queue, so that the calls of a batch queued at once spread over the workers
+				const size_t share = std::min(max_batch, (_queue.size() + _contexts.size() - 1) / _contexts.size());
+				while(batch.size() < share)
+				{
+					batch.push_back(std::move(_queue.front()));
+					_queue.pop_front();
+				}
+			}
+			_not_full.notify_all();
+
+			for(task& t : batch)
+				t(context);
+			batch.clear();
+		}
+	}
+}
@@ -0,0 +1,67 @@
+/**
+ * This file is a part of the Gisel Interpreter
+ *
+ * Copyright (C) 2022 @kbz_8
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef __WORKER_POOL__
+#define __WORKER_POOL__
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "function.h"
+#include "runtime_context.h"
+
+namespace Gisel
+{
+	// threads that run the calls they are given, each one in a context of its own cloned from a prototype;
+	// the calls wait in a bounded queue, and submitting to a full queue blocks until the workers catch up
+	class worker_pool
+	{
+		public:
+			using task = func::function<void(runtime_context&)>;
+
+			worker_pool(const runtime_context& prototype, size_t threads, size_t queue_capacity);
+			// runs the queued calls before joining the workers
+			~worker_pool();
+
+			// the calls of a batch are queued together as long as there is room for them
+			void submit(std::vector<task> tasks);
+
+		private:
+			// a worker takes its share of the queued calls at once, and never more than that many
+			static constexpr const size_t max_batch = 16;
+
+			std::mutex _mutex;
+			std::condition_variable _not_empty;
+			std::condition_variable _not_full;
+			std::deque<task> _queue;
+			size_t _capacity;
+			bool _stopping;
+			std::vector<std::unique_ptr<runtime_context> > _contexts;
+			std::vector<std::thread> _threads;
+
+			void run(runtime_context& context);
+
+			worker_pool(const worker_pool&) = delete;
+			void operator=(const worker_pool&) = delete;
+	};
+}
+
+#endif // __WORKER_POOL__
@@ -7,6 +7,9 @@ target("gisel")
     set_kind("static")
     add_files("src/*.cpp")
     add_includedirs("API", "src")
+    if is_plat("linux", "bsd") then
+        add_syslinks("dl", {public = true})
+    end
 target_end()
 
 target("giseli")